@@ -0,0 +1,150 @@
+#include "batchrender.h"
+#include "sceneexporter.h"
+#include "sceneloader.h"
+#include "scenestore.h"
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <cstring>
+
+namespace {
+
+struct RenderOptions {
+    QStringList formats;  // 输出格式（pdf / png / svg）
+    QString outputDir;    // 输出目录，为空时与输入文件同目录
+    qreal scale = 1.0;    // PNG 缩放倍数
+    int width = 0;        // PNG 宽度（像素），非 0 时按场景宽度换算缩放倍数
+};
+
+// 渲染单个文件，返回错误信息（成功时为空）
+QString renderFile(const QString &input, const RenderOptions &options)
+{
+    SceneData data;
+    QString error;
+    if (!SceneLoader::load(input, &data, &error)) {
+        return error;
+    }
+
+    SceneStore scene;
+    scene.append(data);
+    const QFileInfo info(input);
+    const QDir dir(options.outputDir.isEmpty() ? info.absolutePath() : options.outputDir);
+    const QRectF fallback(0, 0, 800, 600);
+
+    for (const QString &format : options.formats) {
+        const QString output = dir.filePath(info.completeBaseName() + '.' + format);
+        bool ok = false;
+        if (format == QLatin1String("pdf")) {
+            ok = SceneExporter::exportPdf(output, scene, fallback, &error);
+        } else if (format == QLatin1String("png")) {
+            const qreal scale = options.width > 0
+                ? options.width / SceneExporter::sceneBounds(scene, fallback).width()
+                : options.scale;
+            ok = SceneExporter::exportPng(output, scene, scale, fallback, &error);
+        } else if (format == QLatin1String("svg")) {
+            ok = SceneExporter::exportSvg(output, scene, fallback, &error);
+        }
+        if (!ok) return error;
+    }
+    return QString();
+}
+
+} // namespace
+
+bool BatchRender::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--render") == 0) return true;
+    }
+    return false;
+}
+
+int BatchRender::run(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("矩形树图批量渲染"));
+    parser.addHelpOption();
+    parser.addOption({QStringLiteral("render"), QStringLiteral("以无界面模式批量渲染输入文件")});
+    parser.addOption({{QStringLiteral("f"), QStringLiteral("format")},
+                      QStringLiteral("输出格式，逗号分隔（pdf, png, svg）"), QStringLiteral("formats"),
+                      QStringLiteral("pdf")});
+    parser.addOption({{QStringLiteral("o"), QStringLiteral("output")},
+                      QStringLiteral("输出目录（默认与输入文件相同）"), QStringLiteral("dir")});
+    parser.addOption({QStringLiteral("scale"), QStringLiteral("PNG 缩放倍数"),
+                      QStringLiteral("factor"), QStringLiteral("1")});
+    parser.addOption({QStringLiteral("width"), QStringLiteral("PNG 宽度（像素，例如 7680；指定时忽略 --scale）"),
+                      QStringLiteral("pixels")});
+    parser.addOption({{QStringLiteral("j"), QStringLiteral("jobs")},
+                      QStringLiteral("并行线程数（默认使用全部核心）"), QStringLiteral("n")});
+    parser.addPositionalArgument(QStringLiteral("files"), QStringLiteral("场景文件（.txt / .tmap）"),
+                                 QStringLiteral("文件..."));
+    parser.process(arguments);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    RenderOptions options;
+    options.outputDir = parser.value(QStringLiteral("output"));
+    options.formats = parser.value(QStringLiteral("format")).toLower()
+                          .split(',', Qt::SkipEmptyParts);
+    for (const QString &format : qAsConst(options.formats)) {
+        if (format != QLatin1String("pdf") && format != QLatin1String("png")
+            && format != QLatin1String("svg")) {
+            err << "不支持的输出格式: " << format << Qt::endl;
+            return 2;
+        }
+    }
+    bool ok = false;
+    options.scale = parser.value(QStringLiteral("scale")).toDouble(&ok);
+    if (!ok || options.scale <= 0) {
+        err << "无效的缩放倍数" << Qt::endl;
+        return 2;
+    }
+    if (parser.isSet(QStringLiteral("width"))) {
+        options.width = parser.value(QStringLiteral("width")).toInt(&ok);
+        if (!ok || options.width < 1) {
+            err << "无效的图像宽度" << Qt::endl;
+            return 2;
+        }
+    }
+    if (parser.isSet(QStringLiteral("jobs"))) {
+        const int jobs = parser.value(QStringLiteral("jobs")).toInt(&ok);
+        if (!ok || jobs < 1) {
+            err << "无效的线程数" << Qt::endl;
+            return 2;
+        }
+        QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+    }
+    if (!options.outputDir.isEmpty() && !QDir().mkpath(options.outputDir)) {
+        err << "无法创建输出目录: " << options.outputDir << Qt::endl;
+        return 2;
+    }
+
+    const QStringList files = parser.positionalArguments();
+    if (files.isEmpty()) {
+        parser.showHelp(2);
+    }
+
+    // 各文件相互独立，在线程池中并行处理
+    QElapsedTimer timer;
+    timer.start();
+    const QStringList errors = QtConcurrent::blockingMapped<QStringList>(
+        files, [&options](const QString &file) { return renderFile(file, options); });
+
+    int failures = 0;
+    for (int i = 0; i < files.size(); ++i) {
+        if (errors[i].isEmpty()) {
+            out << "OK   " << files[i] << Qt::endl;
+        } else {
+            err << "FAIL " << files[i] << ": " << errors[i] << Qt::endl;
+            failures++;
+        }
+    }
+    out << files.size() - failures << "/" << files.size() << " 个文件渲染完成，用时 "
+        << timer.elapsed() << " ms" << Qt::endl;
+    return failures == 0 ? 0 : 1;
+}
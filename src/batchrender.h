@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QStringList>
+
+/**
+ * @brief 无界面批量渲染（命令行模式）
+ *
+ * 用法：test --render [--format pdf,png,svg] [--output 目录] [--scale 倍数]
+ *                     [--width 像素] [--jobs 线程数] 文件...
+ *
+ * 在 offscreen 平台上运行，不创建 MainWindow / CanvasWidget；
+ * 各输入文件在线程池中并行加载和渲染，绘制代码与画布导出共用。
+ */
+namespace BatchRender
+{
+    /// argv 中是否请求了批量渲染（需在创建应用对象之前判断）
+    bool isRequested(int argc, char *argv[]);
+
+    /**
+     * @brief 执行批量渲染
+     * @param arguments 完整的命令行参数（含程序名）
+     * @return 进程退出码：全部成功为 0
+     */
+    int run(const QStringList &arguments);
+}
@@ -0,0 +1,345 @@
+// 画布热点路径基准测试（CMake 选项 TREEMAP_BUILD_BENCHMARKS 开启时构建）
+//
+// 覆盖绘制（含层次细节聚合）、命中检测、连接线更新、保存、加载和 PDF / SVG / PNG 导出，
+// 场景规模从 10^2 到 10^6 个节点。结果可按 QTest 的机器可读格式输出，
+// 便于在版本之间比较，例如：
+//   canvas_bench -o results.xml,xml
+//   canvas_bench -o results.csv,csv
+//   canvas_bench findNodeAt -o -,junitxml
+
+#include "canvaswidget.h"
+#include "sceneexporter.h"
+#include "scenefile.h"
+#include "sceneloader.h"
+#include "treemaplayout.h"
+#include <QtTest>
+#include <QImage>
+#include <QRandomGenerator>
+#include <QtMath>
+#include <QTemporaryDir>
+
+class CanvasBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void paint_data();
+    void paint();
+    void paintHierarchy_data();
+    void paintHierarchy();
+    void findNodeAt_data();
+    void findNodeAt();
+    void updateConnectionPositions_data();
+    void updateConnectionPositions();
+    void saveToFile_data();
+    void saveToFile();
+    void load_data();
+    void load();
+    void savetopdf_data();
+    void savetopdf();
+    void exportImage_data();
+    void exportImage();
+
+private:
+    static void addSizes();                 // 添加规模数据列
+    static void addSizesAndFormats();       // 规模 x 文件格式
+    const SceneData& scene(int nodes);      // 按规模缓存的合成场景
+    QString scenePath(int nodes, const QString& suffix); // 预先保存的场景文件
+
+    static const QSize VIEWPORT;
+    QTemporaryDir m_dir;
+    QHash<int, SceneData> m_scenes;
+};
+
+const QSize CanvasBenchmark::VIEWPORT(1920, 1080);
+
+void CanvasBenchmark::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+void CanvasBenchmark::addSizes()
+{
+    QTest::addColumn<int>("nodes");
+    for (int nodes : {100, 1000, 10000, 100000, 1000000}) {
+        QTest::addRow("%d", nodes) << nodes;
+    }
+}
+
+void CanvasBenchmark::addSizesAndFormats()
+{
+    QTest::addColumn<int>("nodes");
+    QTest::addColumn<QString>("suffix");
+    for (int nodes : {100, 1000, 10000, 100000, 1000000}) {
+        QTest::addRow("%d/txt", nodes) << nodes << QStringLiteral(".txt");
+        QTest::addRow("%d/tmap", nodes) << nodes << QString::fromLatin1(SceneFile::BINARY_SUFFIX);
+    }
+}
+
+const SceneData& CanvasBenchmark::scene(int nodes)
+{
+    auto it = m_scenes.find(nodes);
+    if (it != m_scenes.end()) return *it;
+
+    // 正方形网格排列的 120x80 节点，每个节点连接右侧和下方的邻居
+    SceneData data;
+    const int columns = qCeil(qSqrt(nodes));
+    data.reserve(nodes, 2 * nodes);
+    for (int i = 0; i < nodes; ++i) {
+        const int row = i / columns, column = i % columns;
+        data.addNode(QRect(column * 160, row * 120, 120, 80),
+                     QStringLiteral("节点 %1").arg(i));
+    }
+    for (int i = 0; i < nodes; ++i) {
+        if ((i + 1) % columns != 0 && i + 1 < nodes) data.addEdge(i, i + 1);
+        if (i + columns < nodes) data.addEdge(i, i + columns);
+    }
+    return *m_scenes.insert(nodes, data);
+}
+
+QString CanvasBenchmark::scenePath(int nodes, const QString& suffix)
+{
+    const QString path = m_dir.filePath(QStringLiteral("scene_%1%2").arg(nodes).arg(suffix));
+    if (!QFile::exists(path)) {
+        SceneFile::save(scene(nodes), path);
+    }
+    return path;
+}
+
+// === 绘制：1:1 视图（只绘制可见部分）与缩放到整个场景（细节层次生效）===
+void CanvasBenchmark::paint_data()
+{
+    QTest::addColumn<int>("nodes");
+    QTest::addColumn<bool>("fit");
+    for (int nodes : {100, 1000, 10000, 100000, 1000000}) {
+        QTest::addRow("%d/1:1", nodes) << nodes << false;
+        QTest::addRow("%d/fit", nodes) << nodes << true;
+    }
+}
+
+void CanvasBenchmark::paint()
+{
+    QFETCH(int, nodes);
+    QFETCH(bool, fit);
+
+    const SceneData& data = scene(nodes);
+    CanvasWidget canvas;
+    canvas.resize(VIEWPORT);
+    canvas.setScene(data);
+    if (fit) {
+        // 网格场景的范围由第一个和最后一个节点确定
+        const QRect bounds = data.rect(0) | data.rect(nodes - 1);
+        canvas.m_viewScale = qMin(qreal(VIEWPORT.width()) / bounds.right(),
+                                  qreal(VIEWPORT.height()) / bounds.bottom());
+    }
+
+    QImage image(VIEWPORT, QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        image.fill(Qt::white);
+        canvas.render(&image);
+    }
+}
+
+// === 层次细节：整棵树图缩放到视口，比较逐个绘制叶节点与聚合子树 ===
+void CanvasBenchmark::paintHierarchy_data()
+{
+    QTest::addColumn<int>("leaves");
+    QTest::addColumn<bool>("lod");
+    for (int leaves : {1000, 10000, 100000, 1000000}) {
+        QTest::addRow("%d/flat", leaves) << leaves << false;
+        QTest::addRow("%d/lod", leaves) << leaves << true;
+    }
+}
+
+void CanvasBenchmark::paintHierarchy()
+{
+    QFETCH(int, leaves);
+    QFETCH(bool, lod);
+
+    // 每个内部节点 10 个子节点，叶节点均匀挂在最下层内部节点上，权重随机
+    TreemapHierarchy hierarchy;
+    QRandomGenerator random(42);
+    QVector<int> level{hierarchy.addNode(-1, 0, QStringLiteral("根"))};
+    while (level.size() * 10 < leaves) {
+        QVector<int> next;
+        for (int parent : qAsConst(level)) {
+            for (int i = 0; i < 10; ++i) {
+                next.append(hierarchy.addNode(parent, 0, QStringLiteral("目录 %1").arg(hierarchy.count())));
+            }
+        }
+        level = next;
+    }
+    for (int i = 0; i < leaves; ++i) {
+        hierarchy.addNode(level[i % level.size()], random.bounded(1, 100), QStringLiteral("叶 %1").arg(i));
+    }
+
+    // 场景是视口的 8 倍，缩放到整棵树可见
+    TreemapLayout layout;
+    TreemapLayout::Options options;
+    options.padding = 1;
+    layout.setOptions(options);
+    QVERIFY(layout.setHierarchy(hierarchy));
+    layout.layout(QRectF(QPointF(0, 0), QSizeF(VIEWPORT) * 8));
+    SceneData data;
+    layout.writeTo(&data);
+
+    CanvasWidget canvas;
+    canvas.resize(VIEWPORT);
+    const QVector<NodeId> nodes = canvas.setScene(data);
+    if (lod) QVERIFY(canvas.setHierarchy(nodes, hierarchy.parent, hierarchy.weight));
+    canvas.m_viewScale = 1.0 / 8;
+
+    QImage image(VIEWPORT, QImage::Format_ARGB32_Premultiplied);
+    QBENCHMARK {
+        image.fill(Qt::white);
+        canvas.render(&image);
+    }
+}
+
+// === 命中检测：每次迭代 1000 个随机点 ===
+void CanvasBenchmark::findNodeAt_data()
+{
+    addSizes();
+}
+
+void CanvasBenchmark::findNodeAt()
+{
+    QFETCH(int, nodes);
+
+    CanvasWidget canvas;
+    canvas.setScene(scene(nodes));
+    const int columns = qCeil(qSqrt(nodes));
+    const int rows = (nodes + columns - 1) / columns;
+
+    QRandomGenerator random(42);
+    QVector<QPoint> points(1000);
+    for (QPoint& p : points) {
+        p = QPoint(random.bounded(columns * 160), random.bounded(rows * 120));
+    }
+
+    int hits = 0;
+    QBENCHMARK {
+        for (const QPoint& p : qAsConst(points)) {
+            hits += canvas.findNodeAt(p) != INVALID_ID;
+        }
+    }
+    QVERIFY(hits > 0);
+}
+
+// === 连接线更新：每次迭代 1000 个节点（各有最多 4 条连接线）===
+void CanvasBenchmark::updateConnectionPositions_data()
+{
+    addSizes();
+}
+
+void CanvasBenchmark::updateConnectionPositions()
+{
+    QFETCH(int, nodes);
+
+    CanvasWidget canvas;
+    const QVector<NodeId> ids = canvas.setScene(scene(nodes));
+    const int step = qMax(1, nodes / 1000);
+
+    QBENCHMARK {
+        for (int i = 0; i < nodes; i += step) {
+            canvas.updateConnectionPositions(ids[i]);
+        }
+    }
+}
+
+// === 保存（文本 / 二进制）===
+void CanvasBenchmark::saveToFile_data()
+{
+    addSizesAndFormats();
+}
+
+void CanvasBenchmark::saveToFile()
+{
+    QFETCH(int, nodes);
+    QFETCH(QString, suffix);
+
+    CanvasWidget canvas;
+    canvas.setScene(scene(nodes));
+    const QString path = m_dir.filePath(QStringLiteral("save") + suffix);
+
+    QBENCHMARK {
+        canvas.saveToFile(path);
+    }
+    QVERIFY(QFile::exists(path));
+}
+
+// === 加载（与“打开”菜单相同的并行解析路径）===
+void CanvasBenchmark::load_data()
+{
+    addSizesAndFormats();
+}
+
+void CanvasBenchmark::load()
+{
+    QFETCH(int, nodes);
+    QFETCH(QString, suffix);
+
+    const QString path = scenePath(nodes, suffix);
+    SceneData loaded;
+    QBENCHMARK {
+        QVERIFY(SceneLoader::load(path, &loaded));
+    }
+    QCOMPARE(loaded.nodeCount(), nodes);
+}
+
+// === PDF 导出 ===
+void CanvasBenchmark::savetopdf_data()
+{
+    addSizes();
+}
+
+void CanvasBenchmark::savetopdf()
+{
+    QFETCH(int, nodes);
+
+    CanvasWidget canvas;
+    canvas.resize(VIEWPORT);
+    canvas.setScene(scene(nodes));
+    const QString path = m_dir.filePath(QStringLiteral("export.pdf"));
+
+    QBENCHMARK {
+        canvas.savetopdf(path);
+    }
+    QVERIFY(QFile::exists(path));
+}
+
+// === SVG / PNG 导出 ===
+void CanvasBenchmark::exportImage_data()
+{
+    QTest::addColumn<int>("nodes");
+    QTest::addColumn<QString>("format");
+    for (int nodes : {100, 1000, 10000, 100000, 1000000}) {
+        QTest::addRow("%d/svg", nodes) << nodes << QStringLiteral("svg");
+        QTest::addRow("%d/png", nodes) << nodes << QStringLiteral("png");
+    }
+}
+
+void CanvasBenchmark::exportImage()
+{
+    QFETCH(int, nodes);
+    QFETCH(QString, format);
+
+    SceneStore store;
+    store.append(scene(nodes));
+    const QRectF fallback(QPointF(0, 0), VIEWPORT);
+    const QString path = m_dir.filePath(QStringLiteral("export.") + format);
+
+    // PNG 按 8K 宽度输出
+    const qreal scale = 7680 / SceneExporter::sceneBounds(store, fallback).width();
+    QBENCHMARK {
+        QVERIFY(format == QLatin1String("svg")
+                    ? SceneExporter::exportSvg(path, store, fallback)
+                    : SceneExporter::exportPng(path, store, scale, fallback));
+    }
+    QVERIFY(QFile::exists(path));
+}
+
+QTEST_MAIN(CanvasBenchmark)
+#include "canvas_bench.moc"
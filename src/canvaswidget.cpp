@@ -1,17 +1,199 @@
 #include "canvaswidget.h"
 #include "treenode.h"
 #include "connection.h"
+#include "scenefile.h"
+#include "sceneexporter.h"
+#include "tracing.h"
+#include "undostack.h"
+#include "scenejournal.h"
+#include "tilerenderer.h"
 #include <QPainter>
 #include <QMouseEvent>
 #include <QKeyEvent>
+#include <QWheelEvent>
+#include <QtMath>
 #include <QMessageBox>
-#include <Qfile>
-#include <QtPrintSupport/QPrinter>
-#include <QPdfWriter>
-#include <QPageSize>
+#include <QFile>
+#include <QElapsedTimer>
+#include <algorithm>
+
+namespace {
+
+// 可合并命令的类型
+enum CommandId {
+    GeometryCommandId = 1
+};
+
+} // namespace
+
+// === 撤销命令 ===
+
+// 节点移动/缩放：同一次拖拽中的多次移动合并为一条（interaction 为 0 时不合并）
+class CanvasWidget::GeometryCommand : public UndoCommand
+{
+public:
+    GeometryCommand(CanvasWidget *canvas, NodeId node, const QRect &before, const QRect &after,
+                    quint32 interaction)
+        : m_canvas(canvas), m_node(node), m_before(before), m_after(after), m_interaction(interaction) {}
+
+    void undo() override { m_canvas->applyGeometry(m_node, m_before); }
+    void redo() override { m_canvas->applyGeometry(m_node, m_after); }
+    int id() const override { return GeometryCommandId; }
+    bool mergeWith(const UndoCommand *next) override
+    {
+        const auto *other = static_cast<const GeometryCommand*>(next);
+        if (m_interaction == 0 || other->m_interaction != m_interaction || other->m_node != m_node) {
+            return false;
+        }
+        m_after = other->m_after;
+        return true;
+    }
+    qsizetype memoryCost() const override { return sizeof(*this); }
+
+private:
+    CanvasWidget *m_canvas;
+    NodeId m_node;
+    QRect m_before;
+    QRect m_after;
+    quint32 m_interaction;
+};
+
+// 文本修改
+class CanvasWidget::TextCommand : public UndoCommand
+{
+public:
+    TextCommand(CanvasWidget *canvas, NodeId node, const QString &before, const QString &after)
+        : m_canvas(canvas), m_node(node), m_before(before), m_after(after) {}
+
+    void undo() override { m_canvas->applyText(m_node, m_before); }
+    void redo() override { m_canvas->applyText(m_node, m_after); }
+    qsizetype memoryCost() const override
+    {
+        return sizeof(*this) + (m_before.capacity() + m_after.capacity()) * qsizetype(sizeof(QChar));
+    }
+
+private:
+    CanvasWidget *m_canvas;
+    NodeId m_node;
+    QString m_before;
+    QString m_after;
+};
+
+// 节点的添加或删除（只保存该节点的几何和文本；相连的连接线由各自的命令处理）
+class CanvasWidget::NodeCommand : public UndoCommand
+{
+public:
+    // 在添加之后或删除之前创建，记录节点当前的内容
+    NodeCommand(CanvasWidget *canvas, NodeId node, bool added)
+        : m_canvas(canvas), m_node(node), m_added(added),
+          m_rect(canvas->m_store.rect(node)), m_text(canvas->m_store.text(node).toString()) {}
+
+    void undo() override
+    {
+        if (m_added) m_canvas->eraseNode(m_node, true); // 撤销添加时该节点一定是最后一个槽位
+        else m_canvas->reviveNode(m_node, m_rect, m_text);
+    }
+    void redo() override
+    {
+        if (m_added) {
+            const NodeId node = m_canvas->insertNode(m_rect, m_text);
+            Q_ASSERT(node == m_node);
+            Q_UNUSED(node)
+        } else {
+            m_canvas->eraseNode(m_node, false);
+        }
+    }
+    qsizetype memoryCost() const override
+    {
+        return sizeof(*this) + m_text.capacity() * qsizetype(sizeof(QChar));
+    }
+
+private:
+    CanvasWidget *m_canvas;
+    NodeId m_node;
+    bool m_added;
+    QRect m_rect;
+    QString m_text;
+};
+
+// 连接线的添加或删除
+class CanvasWidget::EdgeCommand : public UndoCommand
+{
+public:
+    EdgeCommand(CanvasWidget *canvas, EdgeId conn, bool added)
+        : m_canvas(canvas), m_conn(conn), m_added(added),
+          m_start(canvas->m_store.edgeFrom(conn)), m_end(canvas->m_store.edgeTo(conn)) {}
+
+    void undo() override
+    {
+        if (m_added) m_canvas->eraseEdge(m_conn, true);
+        else m_canvas->reviveEdge(m_conn, m_start, m_end);
+    }
+    void redo() override
+    {
+        if (m_added) {
+            const EdgeId conn = m_canvas->insertEdge(m_start, m_end);
+            Q_ASSERT(conn == m_conn);
+            Q_UNUSED(conn)
+        } else {
+            m_canvas->eraseEdge(m_conn, false);
+        }
+    }
+    qsizetype memoryCost() const override { return sizeof(*this); }
+
+private:
+    CanvasWidget *m_canvas;
+    EdgeId m_conn;
+    bool m_added;
+    NodeId m_start;
+    NodeId m_end;
+};
+
+// 清空：被清空的场景（及其层次结构）本身就是增量，整体移交给命令而不复制
+class CanvasWidget::ClearCommand : public UndoCommand
+{
+public:
+    ClearCommand(CanvasWidget *canvas, SceneStore &&scene, SceneHierarchy &&hierarchy)
+        : m_canvas(canvas), m_scene(std::move(scene)), m_hierarchy(std::move(hierarchy)) {}
+
+    void undo() override { m_canvas->restoreScene(std::move(m_scene), std::move(m_hierarchy)); }
+    void redo() override { m_scene = m_canvas->takeScene(&m_hierarchy); }
+    qsizetype memoryCost() const override
+    {
+        return sizeof(*this) + m_scene.memoryUsage() + m_hierarchy.memoryUsage();
+    }
+
+private:
+    CanvasWidget *m_canvas;
+    SceneStore m_scene;
+    SceneHierarchy m_hierarchy;
+};
+
+// 多个节点同时移动/缩放（整体拖拽、整体缩放）
+class CanvasWidget::GroupGeometryCommand : public UndoCommand
+{
+public:
+    GroupGeometryCommand(CanvasWidget *canvas, const QVector<NodeId> &nodes,
+                         const QVector<QRect> &before, const QVector<QRect> &after)
+        : m_canvas(canvas), m_nodes(nodes), m_before(before), m_after(after) {}
+
+    void undo() override { m_canvas->applyGeometries(m_nodes, m_before); }
+    void redo() override { m_canvas->applyGeometries(m_nodes, m_after); }
+    qsizetype memoryCost() const override
+    {
+        return sizeof(*this) + m_nodes.size() * qsizetype(sizeof(NodeId) + 2 * sizeof(QRect));
+    }
+
+private:
+    CanvasWidget *m_canvas;
+    QVector<NodeId> m_nodes;
+    QVector<QRect> m_before;
+    QVector<QRect> m_after;
+};
 
 CanvasWidget::CanvasWidget(QWidget *parent)
     : QWidget(parent)
+    , m_undoStack(new UndoStack(this))
 {
     setMouseTracking(true); // 启用鼠标跟踪
     setFocusPolicy(Qt::StrongFocus); // 允许接收键盘事件
@@ -19,207 +201,855 @@ CanvasWidget::CanvasWidget(QWidget *parent)
 
 CanvasWidget::~CanvasWidget()
 {
-    // 释放所有节点和连接线内存
-    qDeleteAll(m_nodes);
-    qDeleteAll(m_connections);
+    // 节点和连接线由 SceneStore 按列存放，随之释放
 }
 
 // 清空所有元素
 void CanvasWidget::clear()
 {
-    qDeleteAll(m_nodes);
-    qDeleteAll(m_connections);
-    m_nodes.clear();
-    m_connections.clear();
-    update();
+    // 旧场景整体移交给撤销命令（不复制）
+    SceneHierarchy hierarchy;
+    SceneStore scene = takeScene(&hierarchy);
+    if (scene.nodeSlots() > 0 || scene.edgeSlots() > 0) {
+        m_undoStack->push(new ClearCommand(this, std::move(scene), std::move(hierarchy)));
+    }
 }
 
 // 添加新节点
-TreeNode* CanvasWidget::addTreeNode(const QRect &rect, const QString &text) {
-    // 创建节点时传入 this 指针（即所属 CanvasWidget）
-    TreeNode* node = new TreeNode(this, rect, text);
-    m_nodes.append(node);
-    update();
+NodeId CanvasWidget::addTreeNode(const QRect &rect, const QString &text) {
+    const NodeId node = insertNode(rect, text);
+    m_undoStack->push(new NodeCommand(this, node, true));
     return node;
 }
 
-void CanvasWidget::addConnection(TreeNode *start,TreeNode *end){
-    m_connections.append(new Connection(start,end));
-    update();
+NodeId CanvasWidget::insertNode(const QRect &rect, QStringView text)
+{
+    // 节点写入列式存储，不单独分配内存
+    const NodeId node = m_store.addNode(rect, text);
+    if (m_journal) m_journal->nodeAdded(node, rect, text);
+    if (m_batchDepth > 0) {
+        m_pendingIndex.append(node); // 批量操作中推迟到提交时统一建索引
+    } else {
+        m_spatialIndex.insert(node, rect);
+    }
+    sceneModified(nodeDirtyRect(node));
+    return node;
 }
 
-// === 事件处理 ===
-void CanvasWidget::paintEvent(QPaintEvent*)
+EdgeId CanvasWidget::addConnection(NodeId start, NodeId end){
+    const EdgeId conn = insertEdge(start, end);
+    m_undoStack->push(new EdgeCommand(this, conn, true));
+    return conn;
+}
+
+EdgeId CanvasWidget::insertEdge(NodeId start, NodeId end)
 {
-    QPainter painter(this);
-    painter.setRenderHint(QPainter::Antialiasing);
+    const EdgeId conn = m_store.addEdge(start, end);
+    if (m_journal) m_journal->edgeAdded(conn, start, end);
+    sceneModified(Connection::boundingRect(m_store.edgeLine(conn)));
+    return conn;
+}
+
+QVector<NodeId> CanvasWidget::addScene(const SceneData &scene)
+{
+    Batch batch(this, scene.nodeCount(), scene.edgeCount());
+
+    // 整体导入不记录历史：撤销命令依赖槽位顺序，导入后旧的历史记录失效
+    m_undoStack->clear();
+
+    // 整体追加到列式存储，新节点在提交时统一建索引，整个区域重绘一次
+    const QVector<NodeId> created = m_store.append(scene);
+    m_pendingIndex += created;
+    if (m_journal) m_journal->sceneReset();
+    sceneModified(QRect());
+    return created;
+}
+
+// === 批量修改 ===
+void CanvasWidget::beginBatch(int nodeHint, int edgeHint)
+{
+    m_undoStack->beginGroup(); // 事务内的修改作为一步撤销
+    if (m_batchDepth++ == 0) {
+        m_batchDirty = QRect();
+        m_batchFullRepaint = false;
+        m_batchModified = false;
+    }
+    m_store.reserve(nodeHint, edgeHint);
+    m_pendingIndex.reserve(m_pendingIndex.size() + nodeHint);
+}
+
+void CanvasWidget::endBatch()
+{
+    m_undoStack->endGroup();
+    if (--m_batchDepth > 0) return;
+
+    flushPendingIndex();
+
+    // 整个事务只请求一次重绘、发出一次变更通知
+    if (m_batchFullRepaint) {
+        updateAll();
+    } else if (!m_batchDirty.isNull()) {
+        updateScene(m_batchDirty);
+    }
+    if (m_batchModified) {
+        emit sceneChanged();
+    }
+}
+
+void CanvasWidget::flushPendingIndex()
+{
+    m_spatialIndex.reserve(m_pendingIndex.size());
+    for (NodeId node : qAsConst(m_pendingIndex)) {
+        // 层次结构中的节点由 m_hierarchy 负责查询
+        if (m_store.isAlive(node) && !m_hierarchy.contains(node)) {
+            m_spatialIndex.insert(node, m_store.rect(node));
+        }
+    }
+    m_pendingIndex.clear();
+}
+
+void CanvasWidget::sceneModified(const QRect &sceneRect)
+{
+    if (m_batchDepth > 0) {
+        if (sceneRect.isNull()) m_batchFullRepaint = true;
+        else m_batchDirty |= sceneRect;
+        m_batchModified = true;
+        return;
+    }
+
+    if (sceneRect.isNull()) updateAll();
+    else updateScene(sceneRect);
+    emit sceneChanged();
+}
+
+void CanvasWidget::removeConnection(EdgeId conn)
+{
+    UndoCommand *command = new EdgeCommand(this, conn, false);
+    eraseEdge(conn, false);
+    m_undoStack->push(command);
+}
+
+void CanvasWidget::reviveEdge(EdgeId conn, NodeId start, NodeId end)
+{
+    m_store.reviveEdge(conn, start, end);
+    if (m_journal) m_journal->edgeRevived(conn, start, end);
+    sceneModified(Connection::boundingRect(m_store.edgeLine(conn)));
+}
+
+void CanvasWidget::eraseEdge(EdgeId conn, bool discardSlot)
+{
+    Q_ASSERT(!discardSlot || conn == EdgeId(m_store.edgeSlots() - 1));
+    sceneModified(Connection::boundingRect(m_store.edgeLine(conn)));
+    if (discardSlot) m_store.discardLastEdge();
+    else m_store.removeEdge(conn);
+    if (m_journal) {
+        if (discardSlot) m_journal->edgeDiscarded();
+        else m_journal->edgeRemoved(conn);
+    }
+}
 
-    // 绘制所有连接线
-    for (Connection* conn : qAsConst(m_connections)) {
-        conn->draw(&painter);
+void CanvasWidget::removeTreeNode(NodeId node)
+{
+    if (!m_store.isAlive(node)) return;
+
+    // 节点与连接线的删除合并为一次重绘、一次变更通知和一步撤销
+    Batch batch(this);
+
+    // 先删除所有相连的连接线
+    const QVector<EdgeId> edges = m_store.edgesOf(node);
+    for (EdgeId conn : edges) {
+        removeConnection(conn);
+    }
+
+    UndoCommand *command = new NodeCommand(this, node, false);
+    eraseNode(node, false);
+    m_undoStack->push(command);
+}
+
+void CanvasWidget::reviveNode(NodeId node, const QRect &rect, QStringView text)
+{
+    m_store.reviveNode(node, rect, text);
+    if (m_journal) m_journal->nodeRevived(node, rect, text);
+    QRect dirty = nodeDirtyRect(node);
+    if (m_hierarchy.contains(node)) {
+        dirty |= m_hierarchy.refresh(node, m_store); // 祖先的汇总信息随之变化
+    } else if (m_batchDepth > 0) {
+        m_pendingIndex.append(node);
+    } else {
+        m_spatialIndex.insert(node, rect);
+    }
+    sceneModified(dirty);
+}
+
+void CanvasWidget::eraseNode(NodeId node, bool discardSlot)
+{
+    Q_ASSERT(!discardSlot || node == NodeId(m_store.nodeSlots() - 1));
+
+    // 清理引用该节点的交互状态
+    if (node == m_editingNode && m_textEdit) {
+        m_textEdit->disconnect();
+        m_textEdit->deleteLater();
+        m_textEdit = nullptr;
+    }
+    if (node == m_editingNode) m_editingNode = INVALID_ID;
+    if (node == m_hoveredNode) m_hoveredNode = INVALID_ID;
+    if (node == m_connectionStartNode) m_connectionStartNode = INVALID_ID;
+    if (node == m_draggingNode || node == m_resizeNode) {
+        m_draggingNode = m_resizeNode = INVALID_ID;
+        m_currentAction = None;
+    }
+    if (m_store.hasFlag(node, SceneStore::Selected)) {
+        // 整体变换进行中：先按当前几何结束变换并记录撤销（此时仍包含该节点，
+        // 撤销删除后再撤销变换可回到变换前的位置），再从选择中移除
+        if (m_currentAction == DraggingSelection || m_currentAction == ScalingSelection) {
+            endSelectionTransform();
+            m_currentAction = None;
+        }
+        m_selection.removeOne(node);
+    }
+
+    emit nodeRemoved(node);
+    sceneModified(nodeDirtyRect(node));
+    m_spatialIndex.remove(node); // 尚未建索引的节点在提交时按存活状态跳过
+    if (discardSlot) m_store.discardLastNode();
+    else m_store.removeNode(node);
+    if (m_journal) {
+        if (discardSlot) m_journal->nodeDiscarded();
+        else m_journal->nodeRemoved(node);
+    }
+
+    // 层次结构保留该节点作为容器，只更新祖先的外接矩形和汇总信息
+    const QRect summaryDirty = m_hierarchy.refresh(node, m_store);
+    if (!summaryDirty.isNull()) sceneModified(summaryDirty);
+}
+
+void CanvasWidget::setNodeGeometry(NodeId node, const QRect &rect)
+{
+    const QRect before = m_store.rect(node);
+    if (before == rect) return;
+
+    applyGeometry(node, rect);
+    m_undoStack->push(new GeometryCommand(this, node, before, rect, 0));
+}
+
+void CanvasWidget::applyGeometry(NodeId node, const QRect &rect)
+{
+    // 重绘范围 = 修改前后节点及其连接线所占区域的并集
+    const QRect before = nodeAreaWithEdges(node);
+    m_store.setRect(node, rect);
+    if (m_journal) m_journal->geometryChanged(node, rect);
+    indexGeometry(node, rect);
+    updateConnectionPositions(node);
+    sceneModified(before | nodeAreaWithEdges(node));
+}
+
+void CanvasWidget::applyGeometries(const QVector<NodeId> &nodes, const QVector<QRect> &rects)
+{
+    // 只重新裁剪与这些节点相连的连接线（去重后一次批量计算）
+    QRect dirty;
+    QVector<EdgeId> edges;
+    for (NodeId node : nodes) {
+        dirty |= nodeAreaWithEdges(node);
+        m_store.forEachEdgeOf(node, [&edges](EdgeId e) { edges.append(e); });
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    for (int i = 0; i < nodes.size(); ++i) {
+        m_store.setRect(nodes[i], rects[i]);
+        indexGeometry(nodes[i], rects[i]);
+        if (m_journal) m_journal->geometryChanged(nodes[i], rects[i]);
+    }
+    m_store.recomputeEdgeLines(edges);
+
+    for (NodeId node : nodes) dirty |= nodeDirtyRect(node);
+    for (EdgeId e : qAsConst(edges)) dirty |= Connection::boundingRect(m_store.edgeLine(e));
+    sceneModified(dirty);
+}
+
+void CanvasWidget::applyNodeGeometries(const QVector<NodeId> &nodes, const QVector<QRect> &rects)
+{
+    Q_ASSERT(nodes.size() == rects.size());
+    if (!nodes.isEmpty()) applyGeometries(nodes, rects);
+}
+
+void CanvasWidget::applyText(NodeId node, const QString &text)
+{
+    m_store.setText(node, text);
+    if (m_journal) m_journal->textChanged(node, text);
+    sceneModified(nodeDirtyRect(node) | m_hierarchy.refresh(node, m_store, true));
+}
+
+void CanvasWidget::indexGeometry(NodeId node, const QRect &rect)
+{
+    m_spatialIndex.update(node, rect); // 批量添加中尚未建索引的节点会在提交时按新几何插入
+    m_hierarchy.refresh(node, m_store); // 只有外接矩形变化，汇总信息不变
+}
+
+SceneStore CanvasWidget::takeScene(SceneHierarchy *hierarchy)
+{
+    // 结束正在进行的交互，避免引用已删除的节点
+    resetInteraction();
+
+    SceneStore scene = std::move(m_store);
+    m_store.clear();
+    if (hierarchy) *hierarchy = std::move(m_hierarchy);
+    m_hierarchy.clear();
+    m_spatialIndex.clear();
+    m_pendingIndex.clear();
+    if (m_journal) m_journal->sceneReset();
+    sceneModified(QRect());
+    emit cleared();
+    return scene;
+}
+
+void CanvasWidget::restoreScene(SceneStore &&store, SceneHierarchy &&hierarchy)
+{
+    Q_ASSERT(m_store.nodeSlots() == 0 && m_store.edgeSlots() == 0);
+    resetInteraction();
+
+    // 节点句柄与取出前相同，只需重建空间索引（层次结构中的节点在提交时跳过）
+    Batch batch(this);
+    m_store = std::move(store);
+    store.clear();
+    m_hierarchy = std::move(hierarchy);
+    hierarchy.clear();
+    for (NodeId node = 0; node < NodeId(m_store.nodeSlots()); ++node) {
+        if (m_store.isAlive(node)) m_pendingIndex.append(node);
     }
+    if (m_journal) m_journal->sceneReset();
+    sceneModified(QRect());
+}
 
-    // 绘制所有节点
-    for (TreeNode* node : qAsConst(m_nodes)) {
-        node->draw(&painter, CONTROL_POINT_SIZE, PLUS_ICON_SIZE);
+void CanvasWidget::resetInteraction()
+{
+    if (m_textEdit) {
+        m_textEdit->disconnect();
+        m_textEdit->deleteLater();
+        m_textEdit = nullptr;
+    }
+    if (m_hoveredNode != INVALID_ID) {
+        m_store.setFlag(m_hoveredNode, SceneStore::Hovered, false);
+    }
+    clearSelection();
+    m_currentAction = None;
+    m_hoveredNode = m_editingNode = m_connectionStartNode = INVALID_ID;
+    m_draggingNode = m_resizeNode = INVALID_ID;
+}
 
-        // 高亮当前操作节点
-        if (node == m_draggingNode || node == m_resizeNode) {
+void CanvasWidget::recordGeometry(NodeId node, const QRect &before)
+{
+    const QRect after = m_store.rect(node);
+    if (after != before) {
+        if (m_journal) m_journal->geometryChanged(node, after);
+        m_undoStack->push(new GeometryCommand(this, node, before, after, m_interactionSerial));
+    }
+}
+
+// === 撤销/重做 ===
+void CanvasWidget::undo()
+{
+    // 正在创建连接线时只取消创建
+    if (m_currentAction == CreatingConnection) {
+        updateOverlay(tempConnectionRect());
+        m_currentAction = None;
+        return;
+    }
+    if (m_currentAction != None) return; // 拖拽或缩放过程中不撤销
+
+    // 一步撤销可能包含多条命令，合并为一次重绘
+    Batch batch(this);
+    m_undoStack->undo();
+}
+
+void CanvasWidget::redo()
+{
+    if (m_currentAction != None) return;
+
+    Batch batch(this);
+    m_undoStack->redo();
+}
+
+// === 事件处理 ===
+void CanvasWidget::paintEvent(QPaintEvent* event)
+{
+    TRACE_SCOPE("CanvasWidget::paintEvent");
+    QElapsedTimer frameTimer;
+    if (m_statsOverlay) frameTimer.start();
+
+    // 脏区域换算到场景坐标，后续裁剪全部在场景坐标中进行
+    const QRect dirty = mapToScene(event->rect());
+    QPainter painter(this);
+    if (m_tileRenderer) {
+        // 只贴已完成的分块，缺失或过期的分块交给线程池，完成后再局部重绘
+        m_tileRenderer->paint(&painter, event->rect(), rect(), m_viewScale, m_viewOffset,
+                              devicePixelRatioF(), m_store, m_spatialIndex, m_hierarchy);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setTransform(viewTransform());
+    } else {
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setTransform(viewTransform());
+        m_lastNodesDrawn = drawContent(&painter, m_store, m_spatialIndex, m_hierarchy, dirty, m_viewScale);
+    }
+
+    // 以下叠加内容变化频繁，始终在界面线程绘制
+    // 高亮当前操作节点
+    for (NodeId node : {m_draggingNode, m_resizeNode}) {
+        if (node != INVALID_ID && nodeDirtyRect(node).intersects(dirty)) {
             painter.setPen(Qt::blue);
-            painter.drawRect(node->geometry().adjusted(-1, -1, 1, 1));
+            painter.drawRect(m_store.rect(node).adjusted(-1, -1, 1, 1));
         }
     }
 
     // 绘制临时连接线
-    if (m_currentAction == CreatingConnection) {
+    if (m_currentAction == CreatingConnection && tempConnectionRect().intersects(dirty)) {
         painter.setPen(Qt::black);
-        painter.drawLine(m_connectionStartNode->center(), m_tempConnectionEnd);
+        painter.drawLine(m_store.center(m_connectionStartNode), m_tempConnectionEnd);
     }
+
+    // 绘制框选区域
+    if (m_currentAction == SelectingArea && m_rubberBand.intersects(dirty)) {
+        painter.setPen(QPen(Qt::blue, 0, Qt::DashLine));
+        painter.setBrush(QColor(0, 0, 255, 32));
+        painter.drawRect(m_rubberBand);
+        painter.setBrush(Qt::NoBrush);
+    }
+
+    if (m_statsOverlay) {
+        m_lastNodesCulled = m_store.nodeCount() - m_lastNodesDrawn;
+        drawStatsOverlay(&painter);
+        m_lastFrameNs = frameTimer.nsecsElapsed();
+    }
+}
+
+int CanvasWidget::drawContent(QPainter *painter, const SceneStore &store, const SpatialIndex &index,
+                              const SceneHierarchy &hierarchy, const QRect &sceneRect, qreal scale)
+{
+    // 只绘制与区域相交的连接线（通过线段的空间索引查找，收集后一次提交）
+    thread_local QVector<QLineF> lines; // 每个线程复用容量
+    lines.clear();
+    for (EdgeId conn : store.edgesIn(sceneRect)) lines.append(store.edgeLine(conn));
+    Connection::drawLines(painter, lines.constData(), lines.size());
+
+    // 节点的绘制范围超出几何区域（控制点、高亮框），查询时扩展区域
+    const int margin = TreeNode::CONTROL_POINT_SIZE + 2;
+    const QRect queryRect = sceneRect.adjusted(-margin, -margin, margin, margin);
+    int drawn = 0;
+    auto draw = [&](NodeId node, bool collapsed) {
+        const QRect rect = store.rect(node);
+        if (collapsed) hierarchy.drawAggregate(painter, node, store, TreeNode::detailFor(rect, scale));
+        else store.drawNode(painter, node, TreeNode::CONTROL_POINT_SIZE, TreeNode::PLUS_ICON_SIZE,
+                            TreeNode::detailFor(rect, scale));
+
+        // 高亮选中的节点
+        if (store.hasFlag(node, SceneStore::Selected)) {
+            painter->setPen(Qt::blue);
+            painter->drawRect(rect.adjusted(-1, -1, 1, 1));
+        }
+        drawn++;
+    };
+
+    // 层次结构从根向下遍历，屏幕上过小的子树只绘制一个聚合矩形，不访问其子节点
+    hierarchy.forEachVisible(queryRect, scale, LOD_AGGREGATE_PIXELS, store, draw);
+
+    // 其余节点绘制在层次结构之上
+    const QVector<NodeId> visibleNodes = index.query(queryRect);
+    for (NodeId node : visibleNodes) draw(node, false);
+    return drawn;
 }
 
 void CanvasWidget::mousePressEvent(QMouseEvent* event)
 {
-    QPoint pos = event->pos();
-    TreeNode* node = findNodeAt(pos);
+    TRACE_SCOPE("CanvasWidget::mousePressEvent");
+    // 中键拖拽平移视图
+    if (event->button() == Qt::MiddleButton) {
+        m_currentAction = Panning;
+        m_panStartPos = event->pos();
+        m_panStartOffset = m_viewOffset;
+        setCursor(Qt::ClosedHandCursor);
+        return;
+    }
+
+    m_interactionSerial++; // 本次按下到松开之间的移动合并为一步撤销
+    QPoint pos = mapToScene(event->pos()).toPoint();
+    NodeId node = findNodeAt(pos);
 
     if (event->button() == Qt::LeftButton) {
-        if (node) {
-            // 检查是否点击调整控制点
-            QRect resizeArea(node->geometry().bottomRight() - QPoint(CONTROL_POINT_SIZE, CONTROL_POINT_SIZE),
-                             QSize(CONTROL_POINT_SIZE * 2, CONTROL_POINT_SIZE * 2));
-            if (resizeArea.contains(pos)) {
-                m_currentAction = Resizing;
-                m_resizeNode = node;
-                m_dragStartPos = pos;
-                return;
-            }
+        const bool shift = event->modifiers() & Qt::ShiftModifier;
 
-            // 检查是否点击加号图标
-            QRect plusArea(node->geometry().right() - PLUS_ICON_SIZE,
-                           node->geometry().center().y() - PLUS_ICON_SIZE/2,
-                           PLUS_ICON_SIZE, PLUS_ICON_SIZE);
-            if (plusArea.contains(pos)) {
-                m_currentAction = CreatingConnection;
-                m_connectionStartNode = node;
-                m_tempConnectionEnd = pos;
-                return;
-            }
+        // 空白处开始框选（按住 Shift 时追加到现有选择）
+        if (node == INVALID_ID) {
+            if (!shift) clearSelection();
+            m_currentAction = SelectingArea;
+            m_rubberBandStart = pos;
+            m_rubberBand = QRect(pos, QSize(1, 1));
+            return;
+        }
 
-            //检查是否点击文本框
-            int delta1 = node->m_rect.height()/4;
-            int delta2 = node->m_rect.width()/4;
-            QRect textArea = node->m_rect.adjusted(delta2,delta1,-delta2,-delta1);
-            if (textArea.contains(pos)) {
-                m_currentAction = EditingText;
-                m_editingNode = node;
-                return;
-            }
+        // Shift+单击切换节点的选中状态
+        if (shift) {
+            setSelected(node, !m_store.hasFlag(node, SceneStore::Selected));
+            return;
+        }
+
+        // 单击未选中的节点时取消多选；点中已选中的节点时整体操作
+        const bool group = m_store.hasFlag(node, SceneStore::Selected) && m_selection.size() > 1;
+        if (!m_store.hasFlag(node, SceneStore::Selected)) clearSelection();
 
-            // 普通拖拽
-            m_currentAction = DraggingNode;
-            m_draggingNode = node;
-            m_nodeDragStartPos = node->geometry().topLeft();
+        const QRect geometry = m_store.rect(node);
+
+        // 聚合矩形代表整棵子树，只移动或缩放根节点会与其子节点脱节，因此不参与几何变换
+        const auto aggregated = [this](NodeId n) {
+            return m_hierarchy.isAggregated(n, m_viewScale, LOD_AGGREGATE_PIXELS);
+        };
+        const bool fixed = group ? std::any_of(m_selection.cbegin(), m_selection.cend(), aggregated)
+                                 : aggregated(node);
+
+        // 检查是否点击调整控制点
+        QRect resizeArea(geometry.bottomRight() - QPoint(TreeNode::CONTROL_POINT_SIZE, TreeNode::CONTROL_POINT_SIZE),
+                         QSize(TreeNode::CONTROL_POINT_SIZE * 2, TreeNode::CONTROL_POINT_SIZE * 2));
+        if (resizeArea.contains(pos) && group && !fixed) {
+            beginSelectionTransform(ScalingSelection, pos);
+            return;
+        }
+        if (resizeArea.contains(pos) && !fixed) {
+            m_currentAction = Resizing;
+            m_resizeNode = node;
+            m_resizeStartRect = geometry;
             m_dragStartPos = pos;
+            return;
+        }
+
+        // 检查是否点击加号图标
+        QRect plusArea(geometry.right() - TreeNode::PLUS_ICON_SIZE,
+                       geometry.center().y() - TreeNode::PLUS_ICON_SIZE/2,
+                       TreeNode::PLUS_ICON_SIZE, TreeNode::PLUS_ICON_SIZE);
+        if (plusArea.contains(pos)) {
+            m_currentAction = CreatingConnection;
+            m_connectionStartNode = node;
+            m_tempConnectionEnd = pos;
+            return;
         }
+
+        //检查是否点击文本框
+        QRect textArea = TreeNode::textEditArea(geometry);
+        if (textArea.contains(pos)) {
+            m_currentAction = EditingText;
+            m_editingNode = node;
+            return;
+        }
+
+        // 普通拖拽
+        if (fixed) return;
+        if (group) {
+            beginSelectionTransform(DraggingSelection, pos);
+            return;
+        }
+        m_currentAction = DraggingNode;
+        m_draggingNode = node;
+        m_nodeDragStartPos = geometry.topLeft();
+        m_dragStartPos = pos;
     }
 }
 
 void CanvasWidget::mouseMoveEvent(QMouseEvent* event)
 {
-    QPoint pos = event->pos();
+    TRACE_SCOPE("CanvasWidget::mouseMoveEvent");
+    QPoint pos = mapToScene(event->pos()).toPoint();
 
     switch (m_currentAction) {
+    case Panning:
+        m_viewOffset = m_panStartOffset + (event->pos() - m_panStartPos);
+        viewChanged();
+        break;
+
     case Resizing:
         handleResize(m_resizeNode, pos);
         break;
 
-    case DraggingNode:
-        m_draggingNode->moveTo(m_nodeDragStartPos + (pos - m_dragStartPos));
-        updateConnectionPositions();
-        update();
+    case DraggingNode: {
+        // 重绘范围 = 移动前后节点及其连接线所占区域的并集
+        const QRect before = nodeAreaWithEdges(m_draggingNode);
+        const QRect previous = m_store.rect(m_draggingNode);
+        QRect moved = previous;
+        moved.moveTo(m_nodeDragStartPos + (pos - m_dragStartPos));
+        m_store.setRect(m_draggingNode, moved);
+        indexGeometry(m_draggingNode, moved);
+        updateConnectionPositions(m_draggingNode);
+        updateScene(before | nodeAreaWithEdges(m_draggingNode));
+        recordGeometry(m_draggingNode, previous);
         break;
+    }
 
-    case CreatingConnection:
+    case CreatingConnection: {
+        const QRect before = tempConnectionRect();
         m_tempConnectionEnd = pos;
-        update();
+        updateOverlay(before | tempConnectionRect());
+        break;
+    }
+
+    case SelectingArea: {
+        const QRect before = m_rubberBand;
+        m_rubberBand = QRect(m_rubberBandStart, pos).normalized();
+        updateOverlay((before | m_rubberBand).adjusted(-1, -1, 1, 1));
+        break;
+    }
+
+    case DraggingSelection:
+        transformSelection(pos - m_dragStartPos, 1.0, 1.0);
+        break;
+
+    case ScalingSelection: {
+        // 以选中范围的左上角为基点，按鼠标相对起点的比例缩放
+        const QPoint anchor = m_selectionStartBounds.topLeft();
+        const QPoint start = m_dragStartPos - anchor;
+        const QPoint current = pos - anchor;
+        const qreal scaleX = qMax(MIN_SELECTION_SCALE, qreal(current.x()) / qMax(1, start.x()));
+        const qreal scaleY = qMax(MIN_SELECTION_SCALE, qreal(current.y()) / qMax(1, start.y()));
+        transformSelection(QPoint(), scaleX, scaleY);
         break;
+    }
 
     default:
-        // 悬停效果处理
-        TreeNode* hoverNode = findNodeAt(pos);
-        for (TreeNode* node : qAsConst(m_nodes)) {
-            node->setHovered(node == hoverNode);
+        // 悬停效果处理（只需切换并重绘前后两个节点）
+        NodeId hoverNode = findNodeAt(pos);
+        if (hoverNode != m_hoveredNode) {
+            if (m_hoveredNode != INVALID_ID) {
+                m_store.setFlag(m_hoveredNode, SceneStore::Hovered, false);
+                updateScene(nodeDirtyRect(m_hoveredNode));
+            }
+            if (hoverNode != INVALID_ID) {
+                m_store.setFlag(hoverNode, SceneStore::Hovered, true);
+                updateScene(nodeDirtyRect(hoverNode));
+            }
+            m_hoveredNode = hoverNode;
         }
-        update();
     }
 }
 
 void CanvasWidget::mouseReleaseEvent(QMouseEvent *event)
 {
+    TRACE_SCOPE("CanvasWidget::mouseReleaseEvent");
+    if (event->button() == Qt::MiddleButton && m_currentAction == Panning) {
+        m_currentAction = None;
+        unsetCursor();
+        return;
+    }
+
     if (event->button() == Qt::LeftButton) {
         switch (m_currentAction) {
             case CreatingConnection:{
-                    TreeNode* endNode = findNodeAt(event->pos());
-                    if (endNode && endNode != m_connectionStartNode) {
-                        m_connections.append(new Connection(m_connectionStartNode, endNode));
+                    updateOverlay(tempConnectionRect());
+                    NodeId endNode = findNodeAt(mapToScene(event->pos()).toPoint());
+                    if (endNode != INVALID_ID && endNode != m_connectionStartNode) {
+                        addConnection(m_connectionStartNode, endNode);
                     }
                     break;
             }
             case DraggingNode:
-                updateConnectionPositions();
+                updateConnectionPositions(m_draggingNode);
                 break;
             case EditingText:
                 startEditingText(m_editingNode);
-                update();
+                break;
+            case SelectingArea: {
+                // 选中完全位于框内的节点
+                updateOverlay(m_rubberBand.adjusted(-1, -1, 1, 1));
+                // 层次结构中只选中当前可见的节点（聚合的子树按其根节点）
+                QVector<NodeId> hits;
+                m_hierarchy.forEachVisible(m_rubberBand, m_viewScale, LOD_AGGREGATE_PIXELS, m_store,
+                                           [&hits](NodeId node, bool) { hits.append(node); });
+                hits += m_spatialIndex.query(m_rubberBand);
+                for (NodeId node : qAsConst(hits)) {
+                    if (m_rubberBand.contains(m_store.rect(node))) setSelected(node, true);
+                }
+                m_rubberBand = QRect();
+                break;
+            }
+            case DraggingSelection:
+            case ScalingSelection:
+                endSelectionTransform();
+                break;
+            default:
                 break;
             } // 确保 switch 语句的括号正确关闭
 
+        // 清除操作节点的高亮框；节点确实被移动或缩放时通知场景变化
+        if (m_draggingNode != INVALID_ID) {
+            if (m_store.rect(m_draggingNode).topLeft() != m_nodeDragStartPos) {
+                sceneModified(nodeDirtyRect(m_draggingNode));
+            } else {
+                updateScene(nodeDirtyRect(m_draggingNode));
+            }
+        }
+        if (m_resizeNode != INVALID_ID) {
+            if (m_store.rect(m_resizeNode) != m_resizeStartRect) {
+                sceneModified(nodeDirtyRect(m_resizeNode));
+            } else {
+                updateScene(nodeDirtyRect(m_resizeNode));
+            }
+        }
+
         m_currentAction = None;
-        m_resizeNode = m_draggingNode = nullptr;
-        update();
+        m_resizeNode = m_draggingNode = INVALID_ID;
     }
 }
 
 void CanvasWidget::keyPressEvent(QKeyEvent* event)
 {
-    // 处理 Ctrl+Z 退出连接模式
-    if (event->key() == Qt::Key_Z && (event->modifiers() & Qt::ControlModifier)) {
-        if (m_currentAction == CreatingConnection) {
-            m_currentAction = None;
-            update();
+    // Delete 删除选中的节点，没有选中时删除当前悬停的节点
+    if (event->key() == Qt::Key_Delete && m_currentAction == None) {
+        if (!m_selection.isEmpty()) {
+            removeSelectedNodes();
+        } else if (m_hoveredNode != INVALID_ID) {
+            removeTreeNode(m_hoveredNode);
         }
+        return;
     }
+
+    // Esc 取消选择
+    if (event->key() == Qt::Key_Escape && m_currentAction == None) {
+        clearSelection();
+        return;
+    }
+
+    // Ctrl+0 恢复默认视图
+    if (event->key() == Qt::Key_0 && (event->modifiers() & Qt::ControlModifier)) {
+        resetView();
+        return;
+    }
+
+    // Ctrl+Z 撤销（创建连接线时退出连接模式），Ctrl+Y / Ctrl+Shift+Z 重做
+    if (event->key() == Qt::Key_Z && (event->modifiers() & Qt::ControlModifier)) {
+        if (event->modifiers() & Qt::ShiftModifier) redo();
+        else undo();
+        return;
+    }
+    if (event->key() == Qt::Key_Y && (event->modifiers() & Qt::ControlModifier)) {
+        redo();
+        return;
+    }
+}
+
+void CanvasWidget::wheelEvent(QWheelEvent* event)
+{
+    // 以光标为中心缩放：保持光标下的场景点不动
+    const QPointF anchor = event->position();
+    const QPointF sceneAnchor = mapToScene(anchor);
+    const qreal factor = qPow(1.0015, event->angleDelta().y());
+    m_viewScale = qBound(MIN_ZOOM, m_viewScale * factor, MAX_ZOOM);
+    m_viewOffset = anchor - sceneAnchor * m_viewScale;
+    viewChanged();
+    event->accept();
+}
+
+// === 视图变换 ===
+void CanvasWidget::resetView()
+{
+    m_viewScale = 1.0;
+    m_viewOffset = QPointF(0, 0);
+    viewChanged();
+}
+
+void CanvasWidget::setView(qreal scale, const QPointF& offset)
+{
+    m_viewScale = qBound(MIN_ZOOM, scale, MAX_ZOOM);
+    m_viewOffset = offset;
+    viewChanged();
+}
+
+QTransform CanvasWidget::viewTransform() const
+{
+    return QTransform(m_viewScale, 0, 0, m_viewScale, m_viewOffset.x(), m_viewOffset.y());
+}
+
+QPointF CanvasWidget::mapToScene(const QPointF& widgetPos) const
+{
+    return (widgetPos - m_viewOffset) / m_viewScale;
+}
+
+QRect CanvasWidget::mapToScene(const QRect& widgetRect) const
+{
+    const QRectF r(mapToScene(QPointF(widgetRect.topLeft())),
+                   QSizeF(widgetRect.size()) / m_viewScale);
+    return r.toAlignedRect().adjusted(-1, -1, 1, 1);
+}
+
+QRect CanvasWidget::mapFromScene(const QRect& sceneRect) const
+{
+    const QRectF r(QPointF(sceneRect.topLeft()) * m_viewScale + m_viewOffset,
+                   QSizeF(sceneRect.size()) * m_viewScale);
+    return r.toAlignedRect().adjusted(-1, -1, 1, 1);
+}
+
+void CanvasWidget::updateScene(const QRect& sceneRect)
+{
+    if (m_tileRenderer) m_tileRenderer->invalidate(sceneRect);
+    updateOverlay(sceneRect);
+}
+
+void CanvasWidget::updateOverlay(const QRect& sceneRect)
+{
+    update(mapFromScene(sceneRect));
+    // 叠加层显示的是整帧统计，局部重绘时也要刷新
+    if (m_statsOverlay) update(statsOverlayRect());
+}
+
+void CanvasWidget::updateAll()
+{
+    if (m_tileRenderer) m_tileRenderer->invalidateAll();
+    update();
+}
+
+void CanvasWidget::viewChanged()
+{
+    if (m_textEdit && m_editingNode != INVALID_ID) {
+        m_textEdit->setGeometry(textEditRect(m_editingNode));
+    }
+    update();
+}
+
+QRect CanvasWidget::textEditRect(NodeId node) const
+{
+    QRect sceneRect = TreeNode::textEditArea(m_store.rect(node));
+    return QRectF(QPointF(sceneRect.topLeft()) * m_viewScale + m_viewOffset,
+                  QSizeF(sceneRect.size()) * m_viewScale).toRect();
 }
 
 // === 私有辅助函数 ===
-void CanvasWidget::startEditingText(TreeNode* node)
+void CanvasWidget::startEditingText(NodeId node)
 {
     if (m_textEdit) return;
 
     m_textEdit = new QLineEdit(this);
-    m_textEdit->setText(node->text());
+    m_textEdit->setText(m_store.text(node).toString());
     m_textEdit->setAlignment(Qt::AlignCenter);
 
-    // 设置编辑框位置
-    QRect editRect = node->geometry();
-    int delta1 = node->m_rect.height()/4;
-    int delta2 = node->m_rect.width()/4;
-    m_textEdit->setGeometry(editRect.adjusted(delta2,delta1,-delta2,-delta1));
+    // 设置编辑框位置（场景坐标换算到控件坐标）
+    m_textEdit->setGeometry(textEditRect(node));
 
     connect(m_textEdit, &QLineEdit::editingFinished, [=]() {
-        node->setText(m_textEdit->text());
+        if (!m_textEdit) return;
+        const QString text = m_textEdit->text();
         m_textEdit->deleteLater();
         m_textEdit = nullptr;
-        update();
+
+        const QString before = m_store.text(node).toString();
+        if (text != before) {
+            applyText(node, text);
+            m_undoStack->push(new TextCommand(this, node, before, text));
+        }
     });
 
     m_textEdit->show();
     m_textEdit->setFocus();
 }
 
-void CanvasWidget::handleResize(TreeNode* node, const QPoint& mousePos)
+void CanvasWidget::handleResize(NodeId node, const QPoint& mousePos)
 {
-    QRect newRect = node->geometry();
+    const QRect before = nodeAreaWithEdges(node);
+    const QRect previous = m_store.rect(node);
+    QRect newRect = previous;
 
     // 计算坐标差并转换为 QSize
     QPoint deltaPoint = mousePos - newRect.bottomRight();
@@ -229,104 +1059,279 @@ void CanvasWidget::handleResize(TreeNode* node, const QPoint& mousePos)
     newRect.setWidth(qMax(50, newRect.width() + delta.width()));
     newRect.setHeight(qMax(30, newRect.height() + delta.height()));
 
-    node->setGeometry(newRect);
-    updateConnectionPositions();
-    update();
+    m_store.setRect(node, newRect);
+    indexGeometry(node, newRect);
+    updateConnectionPositions(node);
+    updateScene(before | nodeAreaWithEdges(node));
+    recordGeometry(node, previous);
 }
 
-void CanvasWidget::updateConnectionPositions()
+void CanvasWidget::updateConnectionPositions(NodeId node)
 {
-    for (Connection* conn : qAsConst(m_connections)) {
-        conn->updatePosition();
-    }
+    m_store.updateEdgeLines(node);
 }
 
-TreeNode* CanvasWidget::findNodeAt(const QPoint& pos) const
+QRect CanvasWidget::nodeDirtyRect(NodeId node) const
 {
-    // 反向遍历实现后添加的节点在上层
-    for (auto it = m_nodes.rbegin(); it != m_nodes.rend(); ++it) {
-        if ((*it)->geometry().contains(pos)) {
-            return *it;
-        }
-    }
-    return nullptr;
+    // 右下角控制点向外延伸 CONTROL_POINT_SIZE，另加高亮框与画笔宽度
+    return m_store.rect(node).adjusted(-2, -2, TreeNode::CONTROL_POINT_SIZE + 2, TreeNode::CONTROL_POINT_SIZE + 2);
+}
+
+QRect CanvasWidget::nodeAreaWithEdges(NodeId node) const
+{
+    QRect area = nodeDirtyRect(node);
+    m_store.forEachEdgeOf(node, [&](EdgeId conn) {
+        area |= Connection::boundingRect(m_store.edgeLine(conn));
+    });
+    return area;
+}
+
+QRect CanvasWidget::tempConnectionRect() const
+{
+    if (m_connectionStartNode == INVALID_ID) return QRect();
+    return QRect(m_store.center(m_connectionStartNode), m_tempConnectionEnd)
+        .normalized().adjusted(-2, -2, 2, 2);
+}
+
+NodeId CanvasWidget::findNodeAt(const QPoint& pos) const
+{
+    // 空间索引按插入顺序返回最上层（后添加）的节点；其余节点绘制在层次结构之上
+    const NodeId node = m_spatialIndex.topAt(pos);
+    if (node != INVALID_ID) return node;
+    return m_hierarchy.topAt(pos, m_viewScale, LOD_AGGREGATE_PIXELS, m_store);
 }
 
 // === 文件保存 ===
-void CanvasWidget::saveToFile(const QString& path)
+bool CanvasWidget::saveToFile(const QString& path)
 {
-    QFile file(path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, "错误", "无法保存文件");
-        return;
+    TRACE_SCOPE("CanvasWidget::saveToFile");
+    QString error;
+    if (!SceneFile::save(sceneData(), path, &error)) {
+        QMessageBox::warning(this, "错误", error);
+        return false;
     }
+    return true;
+}
 
-    QTextStream out(&file);
+SceneData CanvasWidget::sceneData() const
+{
+    // 存活节点按层叠顺序重新编号（即文件中的 ID）
+    return m_store.toSceneData();
+}
 
-    // 写入节点信息
-    out << "[Nodes]\n";
-    for (int i = 0; i < m_nodes.size(); ++i) {
-        TreeNode* node = m_nodes[i];
-        QRect rect = node->geometry();
-        out << QString("%1,%2,%3,%4,%5,%6\n")
-                   .arg(i)                        // ID
-                   .arg(rect.x()).arg(rect.y())   // 位置
-                   .arg(rect.width()).arg(rect.height()) // 尺寸
-                   .arg(node->text());            // 文本
+SceneSnapshot CanvasWidget::snapshot() const
+{
+    return SceneSnapshot(m_store, m_spatialIndex, m_hierarchy);
+}
+
+QVector<NodeId> CanvasWidget::setScene(const SceneData& scene)
+{
+    // 清空与重建在同一个事务中完成，只重绘一次
+    Batch batch(this);
+    clear();
+    return addScene(scene);
+}
+
+bool CanvasWidget::setHierarchy(const QVector<NodeId> &nodes, const QVector<int> &parents,
+                                const QVector<double> &weights)
+{
+    flushPendingIndex();
+
+    // 旧层次结构中的节点放回空间索引
+    for (NodeId node : m_hierarchy.nodes()) {
+        if (m_store.isAlive(node)) m_spatialIndex.insert(node, m_store.rect(node));
     }
+    m_hierarchy.clear();
 
-    // 写入连接线信息
-    out << "\n[Connections]\n";
-    for (Connection* conn : qAsConst(m_connections)) {
-        int startID = m_nodes.indexOf(conn->startNode());
-        int endID = m_nodes.indexOf(conn->endNode());
-        if (startID != -1 && endID != -1) {
-            out << QString("%1,%2\n").arg(startID).arg(endID);
-        }
+    for (NodeId node : nodes) {
+        if (node >= NodeId(m_store.nodeSlots())) return false;
     }
+    if (!m_hierarchy.build(nodes, parents, weights, m_store)) return false;
+
+    // 层次结构中的节点改由 m_hierarchy 查询，不再逐个放入空间索引
+    for (NodeId node : nodes) m_spatialIndex.remove(node);
+    if (m_journal) m_journal->sceneReset(); // 基准中保存层次结构，恢复后重建
+    updateAll();
+    return true;
+}
+
+void CanvasWidget::setLeafWeight(NodeId node, double weight)
+{
+    if (!m_hierarchy.contains(node)) return;
+    const QRect dirty = m_hierarchy.setWeight(node, weight, m_store);
+    if (m_journal) m_journal->weightChanged(node, weight);
+    if (!dirty.isNull()) updateScene(dirty);
 }
 
 void CanvasWidget::savetopdf(const QString& path)
 {
-    // 使用 QPdfWriter（更推荐）
-    QPdfWriter pdfWriter(path);
-    pdfWriter.setTitle("树图导出");
-    pdfWriter.setCreator("矩形树图绘制器");
-    pdfWriter.setResolution(96);
+    TRACE_SCOPE("CanvasWidget::savetopdf");
+    // 没有节点时导出与画布等大的空白页
+    QString error;
+    if (!SceneExporter::exportPdf(path, m_store, QRectF(0, 0, width(), height()), &error)) {
+        QMessageBox::warning(this, "错误", error);
+    }
+}
+
+// === 多选 ===
+void CanvasWidget::setSelected(NodeId node, bool selected)
+{
+    if (m_store.hasFlag(node, SceneStore::Selected) == selected) return;
+    m_store.setFlag(node, SceneStore::Selected, selected);
+    if (selected) m_selection.append(node);
+    else m_selection.removeOne(node);
+    updateScene(nodeDirtyRect(node));
+}
+
+void CanvasWidget::clearSelection()
+{
+    if (m_selection.isEmpty()) return;
+    QRect dirty;
+    for (NodeId node : qAsConst(m_selection)) {
+        m_store.setFlag(node, SceneStore::Selected, false);
+        dirty |= nodeDirtyRect(node);
+    }
+    m_selection.clear();
+    updateScene(dirty);
+}
+
+void CanvasWidget::removeSelectedNodes()
+{
+    // 先取出选择，避免逐个删除时反复从选择中移除
+    const QVector<NodeId> nodes = m_selection;
+    clearSelection();
 
-    // 计算所有节点的边界矩形
-    QRectF boundingRect;
-    for (TreeNode* node : qAsConst(m_nodes)) {
-        boundingRect = boundingRect.united(node->geometry());
+    Batch batch(this);
+    for (NodeId node : nodes) {
+        removeTreeNode(node);
     }
+}
 
-    // 如果没有节点，使用默认大小
-    if (boundingRect.isEmpty()) {
-        boundingRect = QRectF(0, 0, width(), height());
-    } else {
-        // 添加边距
-        boundingRect.adjust(-20, -20, 20, 20);
+QRect CanvasWidget::selectionExtent() const
+{
+    QRect extent;
+    for (NodeId node : m_selection) extent |= nodeDirtyRect(node);
+    for (EdgeId e : m_selectionEdges) extent |= Connection::boundingRect(m_store.edgeLine(e));
+    return extent;
+}
+
+void CanvasWidget::beginSelectionTransform(ActionType action, const QPoint &pos)
+{
+    m_currentAction = action;
+    m_dragStartPos = pos;
+
+    // 记录起始几何和相连的连接线（两端都被选中的连接线只保留一次）
+    m_selectionStartRects.clear();
+    m_selectionStartRects.reserve(m_selection.size());
+    m_selectionEdges.clear();
+    m_selectionStartBounds = QRect();
+    for (NodeId node : qAsConst(m_selection)) {
+        const QRect rect = m_store.rect(node);
+        m_selectionStartRects.append(rect);
+        m_selectionStartBounds |= rect;
+        m_store.forEachEdgeOf(node, [this](EdgeId e) { m_selectionEdges.append(e); });
     }
+    std::sort(m_selectionEdges.begin(), m_selectionEdges.end());
+    m_selectionEdges.erase(std::unique(m_selectionEdges.begin(), m_selectionEdges.end()),
+                           m_selectionEdges.end());
+    m_selectionExtent = selectionExtent();
+}
 
-    // 设置页面大小
-    pdfWriter.setPageSize(QPageSize(boundingRect.size(), QPageSize::Point));
-    pdfWriter.setPageMargins(QMarginsF(0, 0, 0, 0));
+void CanvasWidget::transformSelection(const QPoint &offset, qreal scaleX, qreal scaleY)
+{
+    const QPoint anchor = m_selectionStartBounds.topLeft();
+    for (int i = 0; i < m_selection.size(); ++i) {
+        const QRect &start = m_selectionStartRects[i];
+        QRect rect;
+        if (scaleX == 1.0 && scaleY == 1.0) {
+            rect = start.translated(offset);
+        } else {
+            rect = QRect(anchor.x() + qRound((start.x() - anchor.x()) * scaleX),
+                         anchor.y() + qRound((start.y() - anchor.y()) * scaleY),
+                         qMax(1, qRound(start.width() * scaleX)),
+                         qMax(1, qRound(start.height() * scaleY)));
+        }
+        m_store.setRect(m_selection[i], rect);
+        indexGeometry(m_selection[i], rect);
+    }
 
-    QPainter painter(&pdfWriter);
-    painter.setRenderHint(QPainter::Antialiasing);
+    // 每一步只重新裁剪相连的连接线，并只重绘变换前后范围的并集
+    m_store.recomputeEdgeLines(m_selectionEdges);
+    const QRect extent = selectionExtent();
+    updateScene(m_selectionExtent | extent);
+    m_selectionExtent = extent;
+}
 
-    // 设置视图窗口
-    painter.setWindow(boundingRect.toRect());
+void CanvasWidget::endSelectionTransform()
+{
+    QVector<QRect> after;
+    after.reserve(m_selection.size());
+    for (NodeId node : qAsConst(m_selection)) after.append(m_store.rect(node));
 
-    // 绘制所有连接线
-    for (Connection* conn : qAsConst(m_connections)) {
-        conn->draw(&painter);
+    if (after != m_selectionStartRects) {
+        if (m_journal) {
+            for (int i = 0; i < m_selection.size(); ++i) {
+                m_journal->geometryChanged(m_selection[i], after[i]);
+            }
+        }
+        m_undoStack->push(new GroupGeometryCommand(this, m_selection, m_selectionStartRects, after));
+        sceneModified(m_selectionExtent);
     }
+    m_selectionStartRects.clear();
+    m_selectionEdges.clear();
+}
 
-    // 绘制所有节点
-    for (TreeNode* node : qAsConst(m_nodes)) {
-        node->draw(&painter, CONTROL_POINT_SIZE, PLUS_ICON_SIZE);
+// === 性能信息叠加层 ===
+void CanvasWidget::setStatsOverlayVisible(bool visible)
+{
+    if (m_statsOverlay == visible) return;
+    m_statsOverlay = visible;
+    update(statsOverlayRect());
+}
+
+void CanvasWidget::setTiledRendering(bool enabled)
+{
+    if (enabled == isTiledRendering()) return;
+    if (enabled) {
+        m_tileRenderer = new TileRenderer(&CanvasWidget::drawContent, this);
+        m_tileRenderer->setBackground(palette().color(backgroundRole()));
+        // 分块完成后只重绘对应区域（不能用 updateScene，否则分块会再次过期）
+        connect(m_tileRenderer, &TileRenderer::tileReady, this, [this](const QRect &sceneRect) {
+            updateOverlay(sceneRect);
+        });
+    } else {
+        delete m_tileRenderer; // 等待正在绘制的分块结束
+        m_tileRenderer = nullptr;
     }
+    update();
+}
 
-    painter.end();
+QRect CanvasWidget::statsOverlayRect() const
+{
+    const QFontMetrics fm(font());
+    return QRect(4, 4, fm.horizontalAdvance(QStringLiteral("剔除节点: 00000000")) + 16,
+                 fm.lineSpacing() * 3 + 8);
+}
+
+void CanvasWidget::drawStatsOverlay(QPainter* painter)
+{
+    // 叠加层使用控件坐标，不受视图变换影响
+    painter->save();
+    painter->resetTransform();
+    painter->setRenderHint(QPainter::Antialiasing, false);
+    const QRect box = statsOverlayRect();
+    painter->fillRect(box, QColor(0, 0, 0, 160));
+    painter->setPen(Qt::white);
+    // 分块渲染时节点在工作线程中绘制，改为显示分块状态
+    const QString text = m_tileRenderer
+        ? QStringLiteral("帧时间: %1 ms\n缓存分块: %2\n绘制中分块: %3")
+              .arg(m_lastFrameNs / 1e6, 0, 'f', 2)
+              .arg(m_tileRenderer->cachedTiles())
+              .arg(m_tileRenderer->pendingTiles())
+        : QStringLiteral("帧时间: %1 ms\n绘制节点: %2\n剔除节点: %3")
+              .arg(m_lastFrameNs / 1e6, 0, 'f', 2)
+              .arg(m_lastNodesDrawn)
+              .arg(m_lastNodesCulled);
+    painter->drawText(box.adjusted(8, 4, -8, -4), Qt::AlignLeft | Qt::AlignTop, text);
+    painter->restore();
 }
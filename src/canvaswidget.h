@@ -3,10 +3,20 @@
 #include <QWidget>
 #include <QLineEdit>
 #include <QList>
+#include <QHash>
+#include <QVector>
+#include "spatialindex.h"
+#include "scenestore.h"
+#include "scenehierarchy.h"
+#include "scenesnapshot.h"
+#include <QTransform>
+
+class UndoStack;
+class SceneJournal;
+class TileRenderer;
 
 // 前向声明（避免头文件循环依赖）
-class TreeNode;
-class Connection;
+struct SceneData;
 
 /**
  * @brief 核心画布组件，负责所有图形元素的绘制和交互逻辑
@@ -24,19 +34,99 @@ public:
         Resizing,       // 正在调整矩形大小
         DraggingNode,   // 正在拖拽矩形
         CreatingConnection, // 正在创建连接线
-        EditingText //正在编辑文本
+        EditingText, //正在编辑文本
+        Panning,     // 正在平移视图
+        SelectingArea,     // 正在框选
+        DraggingSelection, // 正在整体拖拽选中的节点
+        ScalingSelection   // 正在整体缩放选中的节点
     };
 
     explicit CanvasWidget(QWidget *parent = nullptr);
     ~CanvasWidget() override;
 
+    /**
+     * @brief 批量修改事务（RAII）
+     *
+     * 作用域内的增删操作不逐项重绘，新节点推迟到最外层事务结束时统一
+     * 写入空间索引；提交时只请求一次重绘（脏区域的并集）并只发出一次
+     * sceneChanged。事务可以嵌套。
+     */
+    class Batch
+    {
+    public:
+        explicit Batch(CanvasWidget *canvas, int nodeHint = 0, int edgeHint = 0)
+            : m_canvas(canvas) { m_canvas->beginBatch(nodeHint, edgeHint); }
+        ~Batch() { m_canvas->endBatch(); }
+        Q_DISABLE_COPY(Batch)
+
+    private:
+        CanvasWidget *m_canvas;
+    };
+
+    void beginBatch(int nodeHint = 0, int edgeHint = 0); // 开始批量修改（可预留容量）
+    void endBatch();                                      // 提交批量修改
+
     // 提供给 MainWindow 的公共接口
     void clear();  // 清空所有元素
-    TreeNode* addTreeNode(const QRect &rect, const QString &text);// 添加新节点
-    void addConnection(TreeNode *start,TreeNode *end);
-    void saveToFile(const QString &path); // 保存到文件
-    void savetopdf(const QString &path);
-    const QList<TreeNode*>& nodes() const { return m_nodes; } // 提供给 Connection 访问节点列表
+    NodeId addTreeNode(const QRect &rect, const QString &text);// 添加新节点
+    EdgeId addConnection(NodeId start, NodeId end);
+    QVector<NodeId> addScene(const SceneData &scene); // 批量追加节点和连接线，返回新节点
+    void removeTreeNode(NodeId node);           // 删除节点及其所有连接线
+    void removeConnection(EdgeId conn);         // 删除单条连接线
+    void setNodeGeometry(NodeId node, const QRect &rect); // 移动/缩放节点（更新索引和连接线，局部重绘）
+    bool saveToFile(const QString &path); // 保存到文件（按后缀选择文本或二进制格式）
+    SceneData sceneData() const;             // 导出场景的列式数据
+    QVector<NodeId> setScene(const SceneData &scene); // 用列式数据整体替换场景，返回新节点
+    void savetopdf(const QString &path);     // 同步导出单页 PDF（界面通过 PdfExporter 在后台导出快照）
+    const SceneStore& store() const { return m_store; }  // 场景数据（只读）
+    SceneSnapshot snapshot() const; // 当前场景的不可变快照（供工作线程读取；批量事务中新增的节点尚未进入索引）
+    NodeId hoveredNode() const { return m_hoveredNode; } // 当前悬停的节点（没有时为 INVALID_ID）
+    ActionType currentAction() const { return m_currentAction; } // 正在进行的交互
+
+    // 层次细节：为已有节点建立父子关系后，屏幕上过小的子树聚合为一个矩形绘制
+    // （parents 为层次结构下标，-1 表示根；结构无效时返回 false；清空画布时一并清除）
+    bool setHierarchy(const QVector<NodeId> &nodes, const QVector<int> &parents,
+                      const QVector<double> &weights);
+    const SceneHierarchy& hierarchy() const { return m_hierarchy; }
+    void setLeafWeight(NodeId node, double weight); // 修改叶节点权重（更新聚合矩形的汇总信息）
+    void applyNodeGeometries(const QVector<NodeId> &nodes, const QVector<QRect> &rects); // 同时移动多个节点（不记录历史，供外部撤销命令使用）
+
+    // 多选（框选或 Shift+单击；选中多个节点时可整体拖拽、缩放和删除）
+    const QVector<NodeId>& selectedNodes() const { return m_selection; }
+    void setSelected(NodeId node, bool selected);
+    void clearSelection();
+    void removeSelectedNodes(); // 删除所有选中的节点（一步撤销）
+
+    // 撤销/重做（增删、移动、缩放、文本修改和清空；addScene/setScene 会清空历史记录）
+    UndoStack* undoStack() const { return m_undoStack; }
+    void undo(); // 正在创建连接线时先取消创建
+    void redo();
+
+    // 自动保存：场景的每次修改都写入日志（为空时不记录）
+    void setJournal(SceneJournal *journal) { m_journal = journal; }
+
+    // 视图变换（控件坐标 = 场景坐标 * 缩放 + 偏移）
+    void resetView();                                  // 恢复 1:1 缩放和原点位置
+    qreal zoom() const { return m_viewScale; }         // 当前缩放倍数
+    QPointF viewOffset() const { return m_viewOffset; } // 场景原点在控件中的位置
+    void setView(qreal scale, const QPointF &offset);  // 直接设置视图变换（缩放倍数会限制在允许范围内）
+    QRect visibleSceneRect() const { return mapToScene(rect()); } // 当前可见的场景区域
+    QPointF mapToScene(const QPointF &widgetPos) const;
+    QRect mapToScene(const QRect &widgetRect) const;
+    QRect mapFromScene(const QRect &sceneRect) const;
+
+    // 性能信息叠加层（左上角显示帧时间、绘制和剔除的节点数）
+    void setStatsOverlayVisible(bool visible);
+    bool isStatsOverlayVisible() const { return m_statsOverlay; }
+
+    // 分块渲染（在线程池中按分块并行绘制，界面线程只负责贴图和叠加内容）
+    void setTiledRendering(bool enabled);
+    bool isTiledRendering() const { return m_tileRenderer != nullptr; }
+
+signals:
+    void sceneChanged(); // 场景内容发生变化（批量修改只在提交时通知一次）
+    void nodeRemoved(NodeId node);    // 节点即将被删除（句柄随后失效）
+    void cleared();                   // 所有节点已被清空
 
 protected:
     // 重写 Qt 事件处理函数
@@ -45,34 +135,129 @@ protected:
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
 
 private:
+    friend class CanvasBenchmark; // 基准测试直接调用命中检测和连接线更新
+
+    // 撤销命令（只保存增量，通过下面不记录历史的底层操作修改场景）
+    class GeometryCommand;
+    class TextCommand;
+    class NodeCommand;
+    class EdgeCommand;
+    class ClearCommand;
+    class GroupGeometryCommand;
+
+    // 不记录历史的底层操作
+    NodeId insertNode(const QRect &rect, QStringView text);  // 追加节点
+    void reviveNode(NodeId node, const QRect &rect, QStringView text); // 恢复已删除的节点
+    void eraseNode(NodeId node, bool discardSlot);     // 删除节点（discardSlot 时回收最后一个槽位）
+    EdgeId insertEdge(NodeId start, NodeId end);
+    void reviveEdge(EdgeId conn, NodeId start, NodeId end);
+    void eraseEdge(EdgeId conn, bool discardSlot);
+    void applyGeometry(NodeId node, const QRect &rect); // 移动/缩放节点并局部重绘
+    void applyGeometries(const QVector<NodeId> &nodes, const QVector<QRect> &rects); // 同时移动多个节点
+    void applyText(NodeId node, const QString &text);
+    void indexGeometry(NodeId node, const QRect &rect); // 几何变化后更新空间索引或层次结构
+    SceneStore takeScene(SceneHierarchy *hierarchy = nullptr); // 取出整个场景（及层次结构）并清空画布
+    void restoreScene(SceneStore &&store, SceneHierarchy &&hierarchy); // 放回取出的场景（画布须为空）
+    void resetInteraction();                           // 结束正在进行的交互
+    void recordGeometry(NodeId node, const QRect &before); // 记录交互中的移动/缩放（同一次拖拽合并）
+
     // 私有辅助函数
-    void startEditingText(TreeNode *node); // 启动文本编辑
-    void handleResize(TreeNode *node, const QPoint &mousePos); // 处理调整大小
-    void updateConnectionPositions(); // 更新所有连接线位置
-    TreeNode* findNodeAt(const QPoint &pos) const; // 查找坐标处的节点
+    void startEditingText(NodeId node); // 启动文本编辑
+    void handleResize(NodeId node, const QPoint &mousePos); // 处理调整大小
+    void updateConnectionPositions(NodeId node); // 更新与节点相连的连接线位置
+    NodeId findNodeAt(const QPoint &pos) const; // 查找坐标处的节点
+
+    // 视图辅助
+    QTransform viewTransform() const;                 // 场景到控件的变换
+    void updateScene(const QRect &sceneRect);         // 使场景区域失效（换算为控件区域）
+    void updateOverlay(const QRect &sceneRect);       // 只重绘叠加内容（临时连接线、框选区域），分块不过期
+    void updateAll();                                 // 整体重绘（场景整体变化时）
+    void viewChanged();                               // 缩放/平移后刷新
+    QRect textEditRect(NodeId node) const;            // 文本编辑框的控件坐标
+
+    // 场景修改后的重绘与通知（批量修改中只累积脏区域；空矩形表示整体重绘）
+    void sceneModified(const QRect &sceneRect);
+    void flushPendingIndex(); // 把批量添加的节点写入空间索引
+
+    // 局部重绘辅助（返回需要失效的场景区域）
+    QRect nodeDirtyRect(NodeId node) const;        // 节点绘制范围（含控制点和高亮框）
+    QRect nodeAreaWithEdges(NodeId node) const;    // 节点及其连接线的绘制范围
+    QRect tempConnectionRect() const;              // 临时连接线的绘制范围
+    QRect selectionExtent() const;                 // 选中节点及其连接线的绘制范围
+
+    // 整体拖拽/缩放选中的节点
+    void beginSelectionTransform(ActionType action, const QPoint &pos);
+    void transformSelection(const QPoint &offset, qreal scaleX, qreal scaleY); // 相对起始几何变换
+    void endSelectionTransform();
 
-    // 图形元素存储
-    QList<TreeNode*> m_nodes;          // 所有矩形节点
-    QList<Connection*> m_connections;  // 所有连接线
+    // 绘制与场景区域相交的连接线和节点，返回绘制的节点数（直接绘制和分块渲染共用，可在工作线程调用）
+    static int drawContent(QPainter *painter, const SceneStore &store, const SpatialIndex &index,
+                           const SceneHierarchy &hierarchy, const QRect &sceneRect, qreal scale);
+    QRect statsOverlayRect() const;                // 性能信息叠加层的控件区域
+    void drawStatsOverlay(QPainter *painter);      // 绘制性能信息叠加层
+
+    // 图形元素存储（节点和连接线按列存放，邻接关系由 SceneStore 维护）
+    SceneStore m_store;
+    SpatialIndex m_spatialIndex;       // 节点空间索引（用于命中检测；不含层次结构中的节点）
+    SceneHierarchy m_hierarchy;        // 自动布局节点的层次结构（层次细节聚合）
+    TileRenderer* m_tileRenderer = nullptr; // 分块渲染器（关闭时在 paintEvent 中直接绘制）
+
+    // 批量修改状态
+    int m_batchDepth = 0;              // 事务嵌套深度
+    QRect m_batchDirty;                // 事务内累积的脏区域（场景坐标）
+    bool m_batchFullRepaint = false;   // 事务内是否需要整体重绘
+    bool m_batchModified = false;      // 事务内是否有修改
+    QVector<NodeId> m_pendingIndex;    // 尚未写入空间索引的节点
+
+    // 撤销历史
+    UndoStack* m_undoStack;            // 撤销/重做栈（批量修改作为一步）
+    quint32 m_interactionSerial = 0;   // 每次按下鼠标递增，同一次拖拽的移动合并为一步
+    SceneJournal* m_journal = nullptr; // 自动保存日志
 
     // 交互状态管理
     ActionType m_currentAction = None; // 当前操作类型
-    TreeNode* m_resizeNode = nullptr;  // 正在调整大小的节点
-    TreeNode* m_draggingNode = nullptr;// 正在拖拽的节点
-    TreeNode* m_editingNode = nullptr; // 正在编辑文本的节点
+    NodeId m_resizeNode = INVALID_ID;  // 正在调整大小的节点
+    NodeId m_draggingNode = INVALID_ID;// 正在拖拽的节点
+    NodeId m_editingNode = INVALID_ID; // 正在编辑文本的节点
+    NodeId m_hoveredNode = INVALID_ID; // 当前悬停的节点
     QLineEdit* m_textEdit = nullptr;   // 文本编辑框
 
+    // 多选状态
+    QVector<NodeId> m_selection;          // 选中的节点（与 SceneStore::Selected 标志一致）
+    QRect m_rubberBand;                   // 框选区域（场景坐标）
+    QPoint m_rubberBandStart;             // 框选起点
+    QVector<QRect> m_selectionStartRects; // 整体变换开始时各节点的几何
+    QVector<EdgeId> m_selectionEdges;     // 与选中节点相连的连接线（去重）
+    QRect m_selectionStartBounds;         // 整体变换开始时选中节点的外接矩形
+    QRect m_selectionExtent;              // 上一步变换后的绘制范围（用于局部重绘）
+
     // 连接线创建相关
-    TreeNode* m_connectionStartNode = nullptr; // 连接线起点节点
+    NodeId m_connectionStartNode = INVALID_ID; // 连接线起点节点
     QPoint m_tempConnectionEnd;        // 临时连接线终点（鼠标位置）
 
     // 几何计算辅助
     QPoint m_dragStartPos;             // 拖拽起始坐标
     QPoint m_nodeDragStartPos;         // 节点拖拽起始位置
+    QRect m_resizeStartRect;           // 调整大小前的节点几何
+
+    // 视图状态
+    qreal m_viewScale = 1.0;           // 缩放倍数
+    QPointF m_viewOffset;              // 场景原点在控件中的位置
+    QPoint m_panStartPos;              // 平移起始的鼠标位置（控件坐标）
+    QPointF m_panStartOffset;          // 平移起始时的视图偏移
+
+    // 性能信息（上一帧的统计，下一帧绘制时显示）
+    bool m_statsOverlay = false;       // 是否显示叠加层
+    qint64 m_lastFrameNs = 0;          // 上一帧绘制耗时（纳秒）
+    int m_lastNodesDrawn = 0;          // 上一帧绘制的节点数
+    int m_lastNodesCulled = 0;         // 上一帧被裁剪的节点数
 
-    // 控制点尺寸常量
-    static const int CONTROL_POINT_SIZE = 8; // 调整大小控制点边长
-    static const int PLUS_ICON_SIZE = 12;    // 加号图标边长
+    // 缩放范围与聚合阈值（屏幕像素；单个节点的细节层次阈值见 TreeNode）
+    static constexpr qreal MIN_ZOOM = 0.01;
+    static constexpr qreal MAX_ZOOM = 32.0;
+    static const int LOD_AGGREGATE_PIXELS = 48;  // 子树小于此尺寸时聚合为一个矩形
+    static constexpr qreal MIN_SELECTION_SCALE = 0.05; // 整体缩放的最小倍数
 };
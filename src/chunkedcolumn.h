@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QVector>
+
+/**
+ * @brief 分块存储的列（写时复制的粒度为块）
+ *
+ * 元素按 CHUNK_SIZE 个一组存放在隐式共享的 QVector 中，块表本身也是隐式
+ * 共享的 QVector。复制整列只增加块表的引用计数；之后任意一方修改某个元素，
+ * 只复制块表（每块一个句柄）和该元素所在的块，其余块继续共享。
+ *
+ * 场景快照因此可以近乎零开销地保留修改前的内容，供工作线程无锁读取，
+ * 界面线程的一次修改也不会复制整列。
+ * 只读访问请通过 const 对象或 at()，非 const 的 operator[] 会触发复制。
+ */
+template <typename T>
+class ChunkedColumn
+{
+public:
+    static const int CHUNK_SHIFT = 12;               ///< 每块 4096 个元素
+    static const int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+    static const int CHUNK_MASK = CHUNK_SIZE - 1;
+
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+    const T& at(int i) const { return m_chunks.at(i >> CHUNK_SHIFT).at(i & CHUNK_MASK); }
+    const T& operator[](int i) const { return at(i); }
+    T& operator[](int i) { return m_chunks[i >> CHUNK_SHIFT][i & CHUNK_MASK]; } ///< 只复制该元素所在的块
+    const T& last() const { return at(m_size - 1); }
+
+    void append(const T& value)
+    {
+        if ((m_size & CHUNK_MASK) == 0) m_chunks.append(QVector<T>());
+        m_chunks.last().append(value);
+        m_size++;
+    }
+
+    void removeLast()
+    {
+        m_chunks.last().removeLast();
+        if (m_chunks.last().isEmpty()) m_chunks.removeLast();
+        m_size--;
+    }
+
+    void resize(int size, const T& value = T())
+    {
+        while (m_size > size) removeLast();
+        while (m_size < size) append(value);
+    }
+
+    void fill(const T& value, int size)
+    {
+        clear();
+        resize(size, value);
+    }
+
+    void clear()
+    {
+        m_chunks.clear();
+        m_size = 0;
+    }
+
+    void reserve(int size) { m_chunks.reserve((size + CHUNK_MASK) >> CHUNK_SHIFT); } ///< 只预留块表
+
+    /// 已分配的元素容量（用于估算内存占用）
+    qsizetype capacity() const
+    {
+        qsizetype total = 0;
+        for (const QVector<T>& chunk : m_chunks) total += chunk.capacity();
+        return total;
+    }
+
+private:
+    QVector<QVector<T>> m_chunks;
+    int m_size = 0;
+};
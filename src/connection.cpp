@@ -1,37 +1,95 @@
 #include "connection.h"
-#include "treenode.h"
-#include "canvaswidget.h"
+#include "tracing.h"
 #include <QPainter>
 #include <QLineF>
 #include <QRectF>
+#include <algorithm>
+#include <cmath>
 
 // 样式常量定义
 const QColor Connection::LINE_COLOR = Qt::darkGray;
 const double Connection::LINE_WIDTH = 2.0;
 const Qt::PenStyle Connection::LINE_STYLE = Qt::SolidLine;
 
-Connection::Connection(TreeNode* start, TreeNode* end)
-    : m_startNode(start), m_endNode(end)
+namespace {
+
+// 批量裁剪时每块处理的连接线数（列式临时数组放在栈上）
+const int CLIP_BLOCK = 256;
+
+// 方向分量的下限，避免除零（中心重合时线段退化为一点）
+const double MIN_EXTENT = 1e-9;
+
+} // namespace
+
+QLineF Connection::lineBetween(const QRect& start, const QRect& end)
 {
-    updatePosition();
+    QLineF line;
+    clipLines(&start, &end, &line, 1);
+    return line;
+}
+
+void Connection::clipLines(const QRect* starts, const QRect* ends, QLineF* lines, int count)
+{
+    // 线段参数化为 p(t) = c0 + t * d（d = c1 - c0），起点取离开起始矩形处，
+    // 终点取进入目标矩形处；矩形半宽为 w 时，沿 d 在 t = w / |dx| 处到达竖直边
+    double cx[CLIP_BLOCK], cy[CLIP_BLOCK], dx[CLIP_BLOCK], dy[CLIP_BLOCK];
+    double sw[CLIP_BLOCK], sh[CLIP_BLOCK], ew[CLIP_BLOCK], eh[CLIP_BLOCK];
+    double t0[CLIP_BLOCK], t1[CLIP_BLOCK];
+
+    for (int base = 0; base < count; base += CLIP_BLOCK) {
+        const int n = qMin(CLIP_BLOCK, count - base);
+
+        // 转换为列式：起点中心、方向、两端矩形的半尺寸
+        for (int i = 0; i < n; ++i) {
+            const QRect& s = starts[base + i];
+            const QRect& e = ends[base + i];
+            sw[i] = s.width() * 0.5;
+            sh[i] = s.height() * 0.5;
+            ew[i] = e.width() * 0.5;
+            eh[i] = e.height() * 0.5;
+            cx[i] = s.x() + sw[i];
+            cy[i] = s.y() + sh[i];
+            dx[i] = e.x() + ew[i] - cx[i];
+            dy[i] = e.y() + eh[i] - cy[i];
+        }
+
+        // 无分支裁剪：只用 min/max/abs，可编译为 SIMD 指令
+        for (int i = 0; i < n; ++i) {
+            const double ax = std::max(std::abs(dx[i]), MIN_EXTENT);
+            const double ay = std::max(std::abs(dy[i]), MIN_EXTENT);
+            const double leave = std::min(std::min(sw[i] / ax, sh[i] / ay), 1.0);
+            const double enter = 1.0 - std::min(ew[i] / ax, eh[i] / ay);
+            t0[i] = leave;
+            t1[i] = std::max(enter, leave); // 两矩形重叠时退化为一点
+        }
+
+        for (int i = 0; i < n; ++i) {
+            lines[base + i] = QLineF(cx[i] + t0[i] * dx[i], cy[i] + t0[i] * dy[i],
+                                     cx[i] + t1[i] * dx[i], cy[i] + t1[i] * dy[i]);
+        }
+    }
 }
 
-void Connection::updatePosition()
+QRect Connection::boundingRect(const QLineF& line)
 {
-    m_line = QLineF(m_startNode->center(), m_endNode->center());
+    const qreal m = LINE_WIDTH + 1; // 抗锯齿会向外多扩散一个像素
+    return QRectF(line.p1(), line.p2()).normalized()
+        .adjusted(-m, -m, m, m).toAlignedRect();
 }
 
-void Connection::draw(QPainter* painter) const
+void Connection::drawLines(QPainter* painter, const QLineF* lines, int count)
 {
+    TRACE_SCOPE("Connection::drawLines");
+    if (count <= 0) return;
     painter->save();
 
-    // 设置线段样式
+    // 设置线段样式（所有连接线共用一支画笔）
     QPen pen(LINE_COLOR, LINE_WIDTH);
     pen.setStyle(LINE_STYLE);
     painter->setPen(pen);
     painter->setRenderHint(QPainter::Antialiasing);
 
-    // 绘制线段
-    painter->drawLine(m_line);
+    // 一次提交全部线段
+    painter->drawLines(lines, count);
     painter->restore();
 }
@@ -1,51 +1,56 @@
 #pragma once
 
 #include <QLineF>
-#include <QList>
+#include <QRect>
 #include <QPainter>
 
-class TreeNode; // 前向声明
-
 /**
- * @brief 表示两个矩形节点之间的连接线
+ * @brief 两个矩形节点之间连接线的几何计算和绘制逻辑
  *
- * 负责管理连接线的几何计算和绘制逻辑，自动处理线段裁剪
+ * 连接线数据（端点句柄、缓存线段）按列存放在 SceneStore 中，
+ * 本类只提供无状态的辅助函数
  */
 class Connection
 {
 public:
     /**
-     * @brief 构造函数
-     * @param start 起始节点
-     * @param end 目标节点
+     * @brief 计算连接线路径（中心连线在两个节点边框之间的可见部分）
+     * @param start 起始节点几何
+     * @param end 目标节点几何
+     * @return 两个节点重叠或为自环时返回长度为 0 的线段（不绘制）
      */
-    explicit Connection(TreeNode* start, TreeNode* end);
+    static QLineF lineBetween(const QRect& start, const QRect& end);
 
-    // 基础属性访问器
-    TreeNode* startNode() const { return m_startNode; } ///< 获取起始节点
-    TreeNode* endNode() const   { return m_endNode; }   ///< 获取目标节点
+    /**
+     * @brief 批量计算连接线路径（结果与逐条调用 lineBetween 相同）
+     *
+     * 内部分块转换为列式数据后以无分支的循环裁剪，便于编译器向量化。
+     * @param starts 起始节点几何数组
+     * @param ends 目标节点几何数组
+     * @param lines 输出线段数组
+     * @param count 连接线数
+     */
+    static void clipLines(const QRect* starts, const QRect* ends, QLineF* lines, int count);
 
     /**
-     * @brief 更新连接线路径（当节点移动时调用）
+     * @brief 获取连接线的绘制范围（含线宽）
+     * @return 覆盖整条线段的矩形，用于局部重绘
      */
-    void updatePosition();
+    static QRect boundingRect(const QLineF& line);
 
     /**
-     * @brief 执行线段绘制
+     * @brief 以统一样式批量绘制线段（只设置一次画笔，一次 drawLines 调用）
      * @param painter 绘图设备
+     * @param lines 线段数组（长度为 0 的线段应由调用者剔除）
+     * @param count 线段数
      */
-    void draw(QPainter* painter) const;
-
-private:
-    // 线段裁剪算法
-    QLineF calculateVisibleSegment() const;
-
-    TreeNode* m_startNode; ///< 起始节点（不可为nullptr）
-    TreeNode* m_endNode;   ///< 目标节点（不可为nullptr）
-    QLineF m_line;         ///< 当前连接线几何路径
+    static void drawLines(QPainter* painter, const QLineF* lines, int count);
 
-    // 样式常量
+    // 样式常量（SVG 导出按同样的样式生成）
     static const QColor LINE_COLOR;       ///< 线段颜色
     static const double LINE_WIDTH;       ///< 线宽
     static const Qt::PenStyle LINE_STYLE; ///< 线型
+
+private:
+    Connection() = delete;
 };
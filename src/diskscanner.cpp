@@ -0,0 +1,353 @@
+#include "diskscanner.h"
+#include "tracing.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QLocale>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace {
+
+const qint64 PROGRESS_INTERVAL_MS = 100; // 进度回调的最小间隔
+const int CANCEL_CHECK_ENTRIES = 1024;   // 每处理若干个目录项检查一次取消标志
+const int IDLE_SPINS = 64;               // 窃取失败后先让出时间片，超过此次数再休眠
+
+void setError(QString* error, const QString& message)
+{
+    if (error) *error = message;
+}
+
+struct FileEntry {
+    qint64 size;
+    QString name;
+};
+
+// 一个目录的扫描结果（只保存名称，不保存完整路径）
+struct DirRecord {
+    int id = -1;
+    int parent = -1;             // 父目录 ID（根目录为 -1，父目录 ID 总是小于子目录）
+    QString name;
+    QVector<FileEntry> largest;  // 最大的若干个文件（按大小降序）
+    qint64 otherBytes = 0;       // 其余文件的总大小
+    int otherCount = 0;          // 其余文件数
+};
+
+// 待扫描的目录
+struct DirTask {
+    int id;
+    int parent;
+    QString path;
+};
+
+// 工作线程的状态：自己从队尾取任务，其他线程从队头窃取
+struct Worker {
+    QMutex mutex;
+    std::deque<DirTask> tasks;
+    QVector<DirRecord> records; // 本线程扫描完的目录（只由本线程写入）
+};
+
+// 一次扫描的共享状态
+class Scan
+{
+public:
+    Scan(const DiskScanner::Options& options, const std::atomic_bool* cancelled,
+         const DiskScanner::ProgressCallback& progress)
+        : m_maxFiles(options.maxFilesPerDirectory), m_cancelled(cancelled), m_progress(progress)
+    {
+        const int threads = options.threads > 0 ? options.threads : QThread::idealThreadCount();
+        for (int i = 0; i < qMax(1, threads); ++i) m_workers.emplace_back(new Worker);
+    }
+
+    void run(const QString& root);
+    bool isCancelled() const { return m_cancelled && m_cancelled->load(std::memory_order_relaxed); }
+    QVector<DirRecord> takeRecords(); // 按目录 ID 排列
+
+private:
+    void work(int index);
+    void push(int index, DirTask task);
+    bool pop(int index, DirTask* task);
+    bool steal(int index, DirTask* task);
+    void scanDirectory(int index, const DirTask& task);
+    void addFile(DirRecord& record, qint64 size, const QString& name) const;
+    void reportProgress();
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    const int m_maxFiles;
+    const std::atomic_bool* m_cancelled;
+    const DiskScanner::ProgressCallback& m_progress;
+
+    std::atomic_int m_nextId{0};        // 下一个目录 ID（发现目录时分配）
+    std::atomic_int m_outstanding{0};   // 已入队但尚未扫描完的目录数
+    std::atomic<qint64> m_directories{0};
+    std::atomic<qint64> m_files{0};
+    std::atomic<qint64> m_bytes{0};
+    QElapsedTimer m_timer;
+    std::atomic<qint64> m_nextReport{0}; // 下一次报告进度的时间（毫秒）
+};
+
+void Scan::run(const QString& root)
+{
+    m_timer.start();
+    push(0, DirTask{m_nextId++, -1, root});
+
+    // 每个工作线程一个任务，全部同时运行
+    QThreadPool pool;
+    pool.setMaxThreadCount(int(m_workers.size()));
+    for (int i = 0; i < int(m_workers.size()); ++i) {
+        QtConcurrent::run(&pool, [this, i]() { work(i); });
+    }
+    pool.waitForDone();
+
+    if (m_progress) m_progress(m_directories.load(), m_files.load(), m_bytes.load());
+}
+
+void Scan::work(int index)
+{
+    TRACE_SCOPE("DiskScanner::work");
+    int idle = 0;
+    DirTask task;
+    while (!isCancelled()) {
+        if (pop(index, &task) || steal(index, &task)) {
+            idle = 0;
+            scanDirectory(index, task);
+            m_outstanding--; // 子目录已在扫描时入队，计数归零即全部完成
+            continue;
+        }
+        if (m_outstanding.load() == 0) break;
+
+        // 其他线程仍在扫描，可能很快产生新的子目录
+        if (++idle < IDLE_SPINS) QThread::yieldCurrentThread();
+        else QThread::usleep(200);
+    }
+}
+
+void Scan::push(int index, DirTask task)
+{
+    m_outstanding++;
+    Worker& worker = *m_workers[index];
+    QMutexLocker locker(&worker.mutex);
+    worker.tasks.push_back(std::move(task));
+}
+
+bool Scan::pop(int index, DirTask* task)
+{
+    Worker& worker = *m_workers[index];
+    QMutexLocker locker(&worker.mutex);
+    if (worker.tasks.empty()) return false;
+    *task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool Scan::steal(int index, DirTask* task)
+{
+    // 从下一个线程开始轮流尝试，取队头（最早发现、子树通常最大的目录）
+    const int count = int(m_workers.size());
+    for (int i = 1; i < count; ++i) {
+        Worker& victim = *m_workers[(index + i) % count];
+        QMutexLocker locker(&victim.mutex);
+        if (victim.tasks.empty()) continue;
+        *task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void Scan::scanDirectory(int index, const DirTask& task)
+{
+    DirRecord record;
+    record.id = task.id;
+    record.parent = task.parent;
+    record.name = task.parent < 0 ? QDir::toNativeSeparators(task.path) : QFileInfo(task.path).fileName();
+
+    // 无法读取的目录没有任何目录项，按空目录处理
+    qint64 files = 0, bytes = 0;
+    int entries = 0;
+    QDirIterator it(task.path, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+    while (it.hasNext()) {
+        it.next();
+        if (++entries % CANCEL_CHECK_ENTRIES == 0 && isCancelled()) break;
+
+        // 不跟随符号链接（避免环路和重复计数）
+        const QFileInfo info = it.fileInfo();
+        if (info.isSymLink()) continue;
+        if (info.isDir()) {
+            push(index, DirTask{m_nextId++, task.id, info.filePath()});
+        } else {
+            const qint64 size = info.size();
+            addFile(record, size, info.fileName());
+            files++;
+            bytes += size;
+        }
+    }
+
+    m_workers[index]->records.append(std::move(record));
+    m_directories++;
+    m_files += files;
+    m_bytes += bytes;
+    reportProgress();
+}
+
+void Scan::addFile(DirRecord& record, qint64 size, const QString& name) const
+{
+    // 只保留最大的 m_maxFiles 个文件，被挤出的文件计入“其他文件”
+    QVector<FileEntry>& largest = record.largest;
+    if (largest.size() == m_maxFiles && (m_maxFiles == 0 || size <= largest.last().size)) {
+        record.otherBytes += size;
+        record.otherCount++;
+        return;
+    }
+    if (largest.size() == m_maxFiles) {
+        record.otherBytes += largest.last().size;
+        record.otherCount++;
+        largest.removeLast();
+    }
+    const auto pos = std::upper_bound(largest.begin(), largest.end(), size,
+                                      [](qint64 s, const FileEntry& e) { return s > e.size; });
+    largest.insert(pos, FileEntry{size, name});
+}
+
+void Scan::reportProgress()
+{
+    if (!m_progress) return;
+    const qint64 now = m_timer.elapsed();
+    qint64 due = m_nextReport.load();
+    if (now < due || !m_nextReport.compare_exchange_strong(due, now + PROGRESS_INTERVAL_MS)) return;
+    m_progress(m_directories.load(), m_files.load(), m_bytes.load());
+}
+
+QVector<DirRecord> Scan::takeRecords()
+{
+    QVector<DirRecord> records(m_nextId.load());
+    for (const auto& worker : m_workers) {
+        for (DirRecord& record : worker->records) {
+            const int id = record.id;
+            records[id] = std::move(record);
+        }
+        worker->records.clear();
+    }
+    return records;
+}
+
+QString sizeLabel(const QLocale& locale, const QString& name, qint64 bytes)
+{
+    return QStringLiteral("%1 (%2)").arg(name, locale.formattedDataSize(bytes));
+}
+
+// 父目录 ID 总是小于子目录，按 ID 顺序添加即可保证父节点在前
+void buildHierarchy(const QVector<DirRecord>& records, TreemapHierarchy* hierarchy)
+{
+    QVector<qint64> totals(records.size(), 0);
+    int leafCount = 0;
+    for (int d = 0; d < records.size(); ++d) {
+        const DirRecord& record = records[d];
+        totals[d] = record.otherBytes;
+        for (const FileEntry& file : record.largest) totals[d] += file.size;
+        leafCount += record.largest.size() + (record.otherCount > 0 ? 1 : 0);
+    }
+    for (int d = records.size() - 1; d > 0; --d) {
+        totals[records[d].parent] += totals[d];
+    }
+
+    hierarchy->clear();
+    hierarchy->reserve(records.size() + leafCount);
+    const QLocale locale;
+    QVector<int> nodeOf(records.size(), -1);
+    for (int d = 0; d < records.size(); ++d) {
+        const DirRecord& record = records[d];
+        const int parent = record.parent < 0 ? -1 : nodeOf[record.parent];
+        nodeOf[d] = hierarchy->addNode(parent, 0, sizeLabel(locale, record.name, totals[d]));
+        for (const FileEntry& file : record.largest) {
+            hierarchy->addNode(nodeOf[d], file.size, sizeLabel(locale, file.name, file.size));
+        }
+        if (record.otherCount > 0) {
+            const QString name = QStringLiteral("其他 %1 个文件").arg(record.otherCount);
+            hierarchy->addNode(nodeOf[d], record.otherBytes, sizeLabel(locale, name, record.otherBytes));
+        }
+    }
+}
+
+} // namespace
+
+DiskScanner::DiskScanner(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<Result>::finished, this, &DiskScanner::onFinished);
+}
+
+DiskScanner::~DiskScanner()
+{
+    cancel();
+    m_watcher.waitForFinished();
+}
+
+bool DiskScanner::scan(const QString &root, TreemapHierarchy *hierarchy, const Options &options,
+                       QString *error, const std::atomic_bool *cancelled,
+                       const ProgressCallback &progress)
+{
+    TRACE_SCOPE("DiskScanner::scan");
+    const QFileInfo info(root);
+    if (!info.isDir()) {
+        setError(error, QStringLiteral("不是有效的目录：%1").arg(root));
+        return false;
+    }
+
+    Scan scan(options, cancelled, progress);
+    scan.run(info.absoluteFilePath());
+    if (scan.isCancelled()) return false;
+
+    buildHierarchy(scan.takeRecords(), hierarchy);
+    return true;
+}
+
+void DiskScanner::start(const QString &root, const Options &options)
+{
+    if (isRunning()) {
+        cancel();
+        m_watcher.waitForFinished();
+    }
+
+    m_cancel = false;
+    const int generation = ++m_generation;
+    m_watcher.setFuture(QtConcurrent::run([this, root, options, generation]() {
+        Result result;
+        result.ok = scan(root, &result.hierarchy, options, &result.error, &m_cancel,
+                         [this, generation](qint64 directories, qint64 files, qint64 bytes) {
+            // 信号跨线程发送时自动排队到 GUI 线程
+            if (generation == m_generation) emit progressChanged(directories, files, bytes);
+        });
+        result.canceled = m_cancel;
+        return result;
+    }));
+}
+
+void DiskScanner::cancel()
+{
+    m_cancel = true;
+}
+
+bool DiskScanner::isRunning() const
+{
+    return m_watcher.isRunning();
+}
+
+void DiskScanner::onFinished()
+{
+    const Result result = m_watcher.result();
+    if (result.canceled) {
+        emit canceled();
+    } else if (!result.ok) {
+        emit failed(result.error);
+    } else {
+        emit scanned(result.hierarchy);
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "treemaplayout.h"
+#include <QObject>
+#include <QFutureWatcher>
+#include <atomic>
+#include <functional>
+
+/**
+ * @brief 并行目录扫描器（生成磁盘占用树图的层次结构）
+ *
+ * 在工作窃取线程池中遍历目录树：每个工作线程有自己的目录队列，
+ * 从队尾取出任务（深度优先，待扫描的目录数与目录深度成正比），
+ * 空闲时从其他线程的队头窃取（通常是较浅、子树较大的目录）。
+ *
+ * 文件不逐个保存，只按目录累加大小；每个目录只保留最大的若干个文件作为
+ * 单独的叶节点，其余合并为一个“其他文件”叶节点，因此内存占用与目录数
+ * 成正比，与文件数无关。符号链接不跟随也不计入大小。
+ *
+ * 结果是 TreemapHierarchy（叶节点权重为字节数，文本附带大小），
+ * 可以直接交给 TreemapLayout 布局后写入画布。
+ */
+class DiskScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        int threads = 0;              ///< 工作线程数（0 表示 CPU 核数）
+        int maxFilesPerDirectory = 8; ///< 每个目录单独显示的最大文件数，其余合并
+    };
+
+    /// 扫描进度（可能在工作线程中回调）
+    using ProgressCallback = std::function<void(qint64 directories, qint64 files, qint64 bytes)>;
+
+    explicit DiskScanner(QObject *parent = nullptr);
+    ~DiskScanner() override;
+
+    /**
+     * @brief 开始后台扫描（会先取消尚未完成的扫描）
+     * @param root 根目录
+     */
+    void start(const QString &root, const Options &options = Options());
+
+    void cancel();           ///< 请求取消当前扫描
+    bool isRunning() const;  ///< 是否正在扫描
+
+    /**
+     * @brief 同步扫描目录树（可在任意线程调用）
+     * @param root 根目录
+     * @param hierarchy 输出的层次结构（第 0 个节点为根目录）
+     * @param error 失败时的错误信息
+     * @param cancelled 非空时在扫描过程中检查，置位后尽快返回 false
+     * @param progress 进度回调（最多每 100ms 调用一次）
+     * @return 是否扫描成功
+     */
+    static bool scan(const QString &root, TreemapHierarchy *hierarchy,
+                     const Options &options = Options(), QString *error = nullptr,
+                     const std::atomic_bool *cancelled = nullptr,
+                     const ProgressCallback &progress = {});
+
+signals:
+    void progressChanged(qint64 directories, qint64 files, qint64 bytes); ///< 已扫描的目录数、文件数和字节数
+    void scanned(const TreemapHierarchy &hierarchy); ///< 扫描完成
+    void failed(const QString &error);               ///< 扫描失败
+    void canceled();                                 ///< 扫描被取消
+
+private:
+    struct Result {
+        bool ok = false;
+        bool canceled = false;
+        TreemapHierarchy hierarchy;
+        QString error;
+    };
+
+    void onFinished();
+
+    QFutureWatcher<Result> m_watcher; ///< 监视后台任务
+    std::atomic_bool m_cancel{false}; ///< 取消标志（工作线程读取）
+    std::atomic_int m_generation{0};  ///< 扫描批次，用于丢弃过期的进度通知
+};
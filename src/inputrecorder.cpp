@@ -0,0 +1,252 @@
+#include "inputrecorder.h"
+#include "canvaswidget.h"
+#include <QFile>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QWheelEvent>
+#include <iterator>
+
+namespace {
+
+void setError(QString* error, const QString& message)
+{
+    if (error) *error = message;
+}
+
+// 事件类型与文件中名称的对应关系（顺序与 InputEvent::Type 一致）
+const char* const TYPE_NAMES[] = {
+    "press", "release", "dblclick", "move", "wheel", "keypress", "keyrelease"
+};
+
+int typeFromName(QStringView name)
+{
+    for (int i = 0; i < int(std::size(TYPE_NAMES)); ++i) {
+        if (name == QLatin1String(TYPE_NAMES[i])) return i;
+    }
+    return -1;
+}
+
+} // namespace
+
+// === InputEvent ===
+std::unique_ptr<QEvent> InputEvent::toEvent() const
+{
+    const auto mods = Qt::KeyboardModifiers(modifiers);
+    switch (type) {
+    case MousePress:
+    case MouseRelease:
+    case MouseDoubleClick:
+    case MouseMove: {
+        static const QEvent::Type eventTypes[] = {
+            QEvent::MouseButtonPress, QEvent::MouseButtonRelease,
+            QEvent::MouseButtonDblClick, QEvent::MouseMove
+        };
+        return std::make_unique<QMouseEvent>(eventTypes[type], pos, Qt::MouseButton(button),
+                                             Qt::MouseButtons(buttons), mods);
+    }
+    case Wheel:
+        return std::make_unique<QWheelEvent>(pos, pos, QPoint(), angleDelta, Qt::MouseButtons(buttons),
+                                             mods, Qt::NoScrollPhase, false);
+    case KeyPress:
+    case KeyRelease:
+        return std::make_unique<QKeyEvent>(type == KeyPress ? QEvent::KeyPress : QEvent::KeyRelease,
+                                           key, mods, QString(), autoRepeat);
+    }
+    return nullptr;
+}
+
+// === InputRecording ===
+bool InputRecording::save(const QString& path, QString* error) const
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        setError(error, QStringLiteral("无法写入文件 %1").arg(path));
+        return false;
+    }
+
+    QTextStream out(&file);
+    out.setRealNumberPrecision(12); // 视图变换需要原样恢复
+    out << "# Treemap input recording\n";
+    out << "canvas " << canvasSize.width() << ' ' << canvasSize.height() << ' '
+        << viewScale << ' ' << viewOffset.x() << ' ' << viewOffset.y() << '\n';
+    for (const InputEvent& e : events) {
+        out << e.time << ' ' << TYPE_NAMES[e.type] << ' ';
+        if (e.isMouse()) {
+            out << e.pos.x() << ' ' << e.pos.y() << ' ' << e.button << ' ' << e.buttons << ' ' << e.modifiers;
+        } else if (e.type == InputEvent::Wheel) {
+            out << e.pos.x() << ' ' << e.pos.y() << ' ' << e.angleDelta.x() << ' ' << e.angleDelta.y()
+                << ' ' << e.buttons << ' ' << e.modifiers;
+        } else {
+            out << e.key << ' ' << e.modifiers << ' ' << int(e.autoRepeat);
+        }
+        out << '\n';
+    }
+    out.flush();
+
+    if (out.status() != QTextStream::Ok || !file.commit()) {
+        setError(error, QStringLiteral("写入文件 %1 失败").arg(path));
+        return false;
+    }
+    return true;
+}
+
+bool InputRecording::load(const QString& path, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        setError(error, QStringLiteral("无法打开文件 %1").arg(path));
+        return false;
+    }
+
+    *this = InputRecording();
+    QTextStream in(&file);
+    int lineNumber = 0;
+    bool hasCanvas = false;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#'))) continue;
+
+        const QStringList fields = line.split(QLatin1Char(' '), Qt::SkipEmptyParts);
+        bool ok = true;
+        // 字段缺失或不是数字时 ok 置为 false
+        auto number = [&](int i) {
+            bool fieldOk = false;
+            const qreal value = i < fields.size() ? fields[i].toDouble(&fieldOk) : 0;
+            ok = ok && fieldOk;
+            return value;
+        };
+        auto integer = [&](int i) {
+            bool fieldOk = false;
+            const int value = i < fields.size() ? fields[i].toInt(&fieldOk) : 0;
+            ok = ok && fieldOk;
+            return value;
+        };
+
+        if (fields[0] == QLatin1String("canvas")) {
+            canvasSize = QSize(integer(1), integer(2));
+            viewScale = number(3);
+            const qreal x = number(4);
+            viewOffset = QPointF(x, number(5));
+            hasCanvas = ok;
+        } else {
+            InputEvent e;
+            e.time = fields[0].toLongLong(&ok);
+            const int type = fields.size() > 1 ? typeFromName(fields[1]) : -1;
+            ok = ok && type >= 0;
+            if (ok) {
+                e.type = InputEvent::Type(type);
+                if (e.isMouse()) {
+                    const qreal x = number(2);
+                    e.pos = QPointF(x, number(3));
+                    e.button = integer(4);
+                    e.buttons = integer(5);
+                    e.modifiers = integer(6);
+                } else if (e.type == InputEvent::Wheel) {
+                    const qreal x = number(2);
+                    e.pos = QPointF(x, number(3));
+                    const int dx = integer(4);
+                    e.angleDelta = QPoint(dx, integer(5));
+                    e.buttons = integer(6);
+                    e.modifiers = integer(7);
+                } else {
+                    e.key = integer(2);
+                    e.modifiers = integer(3);
+                    e.autoRepeat = integer(4) != 0;
+                }
+            }
+            if (ok) events.append(e);
+        }
+
+        if (!ok) {
+            setError(error, QStringLiteral("%1 第 %2 行格式错误").arg(path).arg(lineNumber));
+            return false;
+        }
+    }
+
+    if (!hasCanvas) {
+        setError(error, QStringLiteral("%1 缺少画布尺寸记录").arg(path));
+        return false;
+    }
+    return true;
+}
+
+// === InputRecorder ===
+InputRecorder::InputRecorder(CanvasWidget* canvas, QObject* parent)
+    : QObject(parent)
+    , m_canvas(canvas)
+{
+}
+
+InputRecorder::~InputRecorder()
+{
+    stop();
+}
+
+void InputRecorder::start()
+{
+    if (m_recording) return;
+    m_data = InputRecording();
+    m_data.canvasSize = m_canvas->size();
+    m_data.viewScale = m_canvas->zoom();
+    m_data.viewOffset = m_canvas->viewOffset();
+    m_scene = m_canvas->sceneData();
+    m_clock.start();
+    m_canvas->installEventFilter(this);
+    m_recording = true;
+}
+
+void InputRecorder::stop()
+{
+    if (!m_recording) return;
+    m_canvas->removeEventFilter(this);
+    m_recording = false;
+}
+
+bool InputRecorder::eventFilter(QObject* watched, QEvent* event)
+{
+    InputEvent e;
+    e.time = m_clock.elapsed();
+    switch (event->type()) {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::MouseMove: {
+        const auto* mouse = static_cast<QMouseEvent*>(event);
+        e.type = event->type() == QEvent::MouseButtonPress ? InputEvent::MousePress
+               : event->type() == QEvent::MouseButtonRelease ? InputEvent::MouseRelease
+               : event->type() == QEvent::MouseButtonDblClick ? InputEvent::MouseDoubleClick
+               : InputEvent::MouseMove;
+        e.pos = mouse->pos();
+        e.button = int(mouse->button());
+        e.buttons = int(mouse->buttons());
+        e.modifiers = int(mouse->modifiers());
+        break;
+    }
+    case QEvent::Wheel: {
+        const auto* wheel = static_cast<QWheelEvent*>(event);
+        e.type = InputEvent::Wheel;
+        e.pos = wheel->position();
+        e.angleDelta = wheel->angleDelta();
+        e.buttons = int(wheel->buttons());
+        e.modifiers = int(wheel->modifiers());
+        break;
+    }
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease: {
+        const auto* key = static_cast<QKeyEvent*>(event);
+        e.type = event->type() == QEvent::KeyPress ? InputEvent::KeyPress : InputEvent::KeyRelease;
+        e.key = key->key();
+        e.modifiers = int(key->modifiers());
+        e.autoRepeat = key->isAutoRepeat();
+        break;
+    }
+    default:
+        return QObject::eventFilter(watched, event);
+    }
+
+    m_data.events.append(e);
+    return QObject::eventFilter(watched, event); // 只记录，不拦截
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <QObject>
+#include <QPoint>
+#include <QPointF>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <QElapsedTimer>
+#include <memory>
+#include "scenefile.h"
+
+class QEvent;
+class CanvasWidget;
+
+/**
+ * @brief 一条录制的输入事件（控件坐标）
+ */
+struct InputEvent
+{
+    enum Type : quint8 {
+        MousePress,
+        MouseRelease,
+        MouseDoubleClick,
+        MouseMove,
+        Wheel,
+        KeyPress,
+        KeyRelease
+    };
+
+    qint64 time = 0;       ///< 相对录制开始的毫秒数（回放时不用于定时）
+    Type type = MouseMove;
+    QPointF pos;           ///< 鼠标/滚轮事件的位置
+    int button = 0;        ///< 触发事件的鼠标按键（Qt::MouseButton）
+    int buttons = 0;       ///< 事件发生时按下的鼠标按键（Qt::MouseButtons）
+    int modifiers = 0;     ///< Qt::KeyboardModifiers
+    int key = 0;           ///< 键盘事件的 Qt::Key
+    bool autoRepeat = false;
+    QPoint angleDelta;     ///< 滚轮转动角度
+
+    bool isMouse() const { return type <= MouseMove; }
+    std::unique_ptr<QEvent> toEvent() const; ///< 重建为可发送给控件的 Qt 事件
+};
+
+/**
+ * @brief 输入录制文件
+ *
+ * 文本格式，每行一条记录：
+ *   canvas 宽 高 缩放倍数 偏移X 偏移Y   （录制开始时的画布尺寸和视图变换）
+ *   时间 press|release|dblclick|move x y 按键 按下的按键 修饰键
+ *   时间 wheel x y 角度X 角度Y 按下的按键 修饰键
+ *   时间 keypress|keyrelease 键 修饰键 自动重复
+ * 以 # 开头的行为注释。
+ */
+struct InputRecording
+{
+    QSize canvasSize;
+    qreal viewScale = 1.0;
+    QPointF viewOffset;
+    QVector<InputEvent> events;
+
+    bool save(const QString &path, QString *error = nullptr) const;
+    bool load(const QString &path, QString *error = nullptr);
+};
+
+/**
+ * @brief 录制发送给画布的鼠标和键盘事件
+ *
+ * 作为事件过滤器安装在画布上，只记录事件，不拦截。开始录制时同时保存
+ * 当时的场景，两者一起交给 InputReplay 回放，用于测量交互延迟。
+ */
+class InputRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InputRecorder(CanvasWidget *canvas, QObject *parent = nullptr);
+    ~InputRecorder() override;
+
+    void start();  ///< 清空之前的记录，记下场景、画布尺寸和视图变换后开始录制
+    void stop();
+    bool isRecording() const { return m_recording; }
+    const InputRecording &recording() const { return m_data; }
+    const SceneData &startScene() const { return m_scene; } ///< 开始录制时的场景
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    CanvasWidget *m_canvas;
+    InputRecording m_data;
+    SceneData m_scene;
+    QElapsedTimer m_clock;
+    bool m_recording = false;
+};
@@ -0,0 +1,177 @@
+#include "inputreplay.h"
+#include "inputrecorder.h"
+#include "canvaswidget.h"
+#include "sceneloader.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QEvent>
+#include <QMap>
+#include <QTextStream>
+#include <QtMath>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// 按事件发生前后画布的交互状态归类（按下时看之后的状态，移动和松开时看之前的状态）
+QString interactionType(const InputEvent& e, CanvasWidget::ActionType before, CanvasWidget::ActionType after)
+{
+    if (e.type == InputEvent::Wheel) return QStringLiteral("zoom");
+    if (!e.isMouse()) return QStringLiteral("key");
+
+    switch (before != CanvasWidget::None ? before : after) {
+    case CanvasWidget::DraggingNode:
+    case CanvasWidget::DraggingSelection:
+        return QStringLiteral("drag");
+    case CanvasWidget::Resizing:
+    case CanvasWidget::ScalingSelection:
+        return QStringLiteral("resize");
+    case CanvasWidget::CreatingConnection:
+        return QStringLiteral("connect");
+    case CanvasWidget::SelectingArea:
+        return QStringLiteral("select");
+    case CanvasWidget::Panning:
+        return QStringLiteral("pan");
+    case CanvasWidget::EditingText:
+        return QStringLiteral("edit");
+    case CanvasWidget::None:
+        break;
+    }
+    return e.type == InputEvent::MouseMove && e.buttons == Qt::NoButton
+        ? QStringLiteral("hover") : QStringLiteral("click");
+}
+
+// 最近秩百分位数（samples 已排序）
+qint64 percentile(const QVector<qint64>& samples, int p)
+{
+    const int rank = qMax(1, qCeil(samples.size() * p / 100.0));
+    return samples[rank - 1];
+}
+
+QString formatMs(qint64 ns)
+{
+    return QString::number(ns / 1e6, 'f', 3);
+}
+
+// 把场景和视图恢复到录制开始时的状态，并完成首次绘制
+void resetCanvas(CanvasWidget& canvas, const SceneData& scene, const InputRecording& recording)
+{
+    canvas.setScene(scene);
+    canvas.setView(recording.viewScale, recording.viewOffset);
+    QCoreApplication::processEvents();
+}
+
+} // namespace
+
+bool InputReplay::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--replay") == 0) return true;
+    }
+    return false;
+}
+
+int InputReplay::run(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("回放录制的输入并测量交互延迟"));
+    parser.addHelpOption();
+    parser.addOption({QStringLiteral("replay"), QStringLiteral("输入录制文件"), QStringLiteral("file")});
+    parser.addOption({QStringLiteral("scene"),
+                      QStringLiteral("录制时的场景文件（.txt / .tmap，默认为录制文件旁同名的 .tmap）"),
+                      QStringLiteral("file")});
+    parser.addOption({QStringLiteral("repeat"), QStringLiteral("重复回放次数"),
+                      QStringLiteral("n"), QStringLiteral("1")});
+    parser.addOption({QStringLiteral("tiled"), QStringLiteral("使用分块渲染")});
+    parser.addOption({QStringLiteral("max-p99"), QStringLiteral("任一交互类型的 p99 超过此值（毫秒）时返回 1"),
+                      QStringLiteral("ms")});
+    parser.process(arguments);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    bool ok = false;
+    const int repeat = parser.value(QStringLiteral("repeat")).toInt(&ok);
+    if (!ok || repeat < 1) {
+        err << "无效的重复次数" << Qt::endl;
+        return 2;
+    }
+    qreal maxP99 = -1;
+    if (parser.isSet(QStringLiteral("max-p99"))) {
+        maxP99 = parser.value(QStringLiteral("max-p99")).toDouble(&ok);
+        if (!ok || maxP99 <= 0) {
+            err << "无效的延迟上限" << Qt::endl;
+            return 2;
+        }
+    }
+
+    const QString recordingPath = parser.value(QStringLiteral("replay"));
+    InputRecording recording;
+    QString error;
+    if (!recording.load(recordingPath, &error)) {
+        err << error << Qt::endl;
+        return 2;
+    }
+    const QFileInfo info(recordingPath);
+    const QString scenePath = parser.isSet(QStringLiteral("scene"))
+        ? parser.value(QStringLiteral("scene"))
+        : info.dir().filePath(info.completeBaseName() + SceneFile::BINARY_SUFFIX);
+    SceneData scene;
+    if (!SceneLoader::load(scenePath, &scene, &error)) {
+        err << scenePath << ": " << error << Qt::endl;
+        return 2;
+    }
+
+    CanvasWidget canvas;
+    canvas.resize(recording.canvasSize);
+    canvas.setTiledRendering(parser.isSet(QStringLiteral("tiled")));
+    canvas.show();
+
+    // 每个事件：发送 -> 立即处理它引起的重绘请求，两者合计即为延迟
+    QMap<QString, QVector<qint64>> latencies;
+    QElapsedTimer timer;
+    for (int r = 0; r < repeat; ++r) {
+        resetCanvas(canvas, scene, recording);
+        for (const InputEvent& e : qAsConst(recording.events)) {
+            const std::unique_ptr<QEvent> event = e.toEvent();
+            const CanvasWidget::ActionType before = canvas.currentAction();
+            timer.start();
+            QCoreApplication::sendEvent(&canvas, event.get());
+            QCoreApplication::sendPostedEvents(nullptr, QEvent::UpdateRequest);
+            const qint64 elapsed = timer.nsecsElapsed();
+            latencies[interactionType(e, before, canvas.currentAction())].append(elapsed);
+
+            // 事件引起的其他排队任务（例如创建文本编辑框）不计入延迟
+            QCoreApplication::processEvents();
+        }
+    }
+
+    out << QStringLiteral("%1 个事件 x %2 次，%3 个节点\n")
+               .arg(recording.events.size()).arg(repeat).arg(scene.nodeCount());
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+               .arg(QStringLiteral("type"), -10).arg(QStringLiteral("count"), 8)
+               .arg(QStringLiteral("p50 ms"), 10).arg(QStringLiteral("p95 ms"), 10)
+               .arg(QStringLiteral("p99 ms"), 10).arg(QStringLiteral("max ms"), 10);
+
+    bool withinBudget = true;
+    for (auto it = latencies.begin(); it != latencies.end(); ++it) {
+        QVector<qint64>& samples = it.value();
+        std::sort(samples.begin(), samples.end());
+        const qint64 p99 = percentile(samples, 99);
+        out << QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+                   .arg(it.key(), -10).arg(samples.size(), 8)
+                   .arg(formatMs(percentile(samples, 50)), 10)
+                   .arg(formatMs(percentile(samples, 95)), 10)
+                   .arg(formatMs(p99), 10)
+                   .arg(formatMs(samples.last()), 10);
+        if (maxP99 > 0 && p99 / 1e6 > maxP99) {
+            err << it.key() << " 的 p99 超过 " << maxP99 << " ms" << Qt::endl;
+            withinBudget = false;
+        }
+    }
+    out.flush();
+    return withinBudget ? 0 : 1;
+}
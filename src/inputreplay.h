@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QStringList>
+
+/**
+ * @brief 输入回放与交互延迟测量（命令行模式）
+ *
+ * 用法：test --replay 录制文件 [--scene 场景文件] [--repeat 次数] [--tiled]
+ *                     [--max-p99 毫秒]
+ *
+ * 未指定场景时使用录制文件旁同名的 .tmap（录制时一同保存的起始场景）。
+ * 在 offscreen 平台上创建与录制时同样尺寸和视图变换的 CanvasWidget，加载场景后
+ * 逐条发送录制的事件（不按录制时的间隔等待，结果可重复），测量从发送事件到
+ * 该事件引起的重绘完成的时间，按交互类型（悬停、拖拽、缩放、连线等）输出
+ * p50/p95/p99。每次重复都从重新加载的场景开始。
+ *
+ * 分块渲染（--tiled）时只测量界面线程的耗时，不包括工作线程中的光栅化。
+ */
+namespace InputReplay
+{
+    /// argv 中是否请求了输入回放（需在创建应用对象之前判断）
+    bool isRequested(int argc, char *argv[]);
+
+    /**
+     * @brief 执行回放并输出延迟统计
+     * @param arguments 完整的命令行参数（含程序名）
+     * @return 进程退出码：成功为 0，超出 --max-p99 为 1，参数或文件错误为 2
+     */
+    int run(const QStringList &arguments);
+}
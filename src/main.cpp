@@ -1,5 +1,30 @@
 #include "mainwindow.h"  // 主窗口头文件
+#include "batchrender.h"  // 命令行批量渲染
+#include "inputreplay.h"  // 输入回放与延迟测量
+#include "tracing.h"      // 性能跟踪
 #include <QApplication>   // Qt 应用框架核心头文件
+#include <QDebug>
+
+namespace {
+
+// 设置环境变量 TREEMAP_TRACE=<文件> 时从启动开始记录，退出时写出跟踪文件
+QString startupTracePath()
+{
+    const QString path = qEnvironmentVariable("TREEMAP_TRACE");
+    if (!path.isEmpty()) Tracing::setEnabled(true);
+    return path;
+}
+
+int finishTrace(const QString& path, int exitCode)
+{
+    QString error;
+    if (!path.isEmpty() && !Tracing::writeChromeTrace(path, &error)) {
+        qWarning().noquote() << error;
+    }
+    return exitCode;
+}
+
+} // namespace
 
 /**
  * @brief 应用程序入口点
@@ -9,6 +34,26 @@
  */
 int main(int argc, char *argv[])
 {
+    const QString tracePath = startupTracePath();
+
+    // === 命令行批量渲染模式（无需显示器，不创建主窗口）===
+    if (BatchRender::isRequested(argc, argv)) {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+        QGuiApplication app(argc, argv);
+        return finishTrace(tracePath, BatchRender::run(app.arguments()));
+    }
+
+    // === 输入回放模式（需要控件，但同样在 offscreen 平台上运行）===
+    if (InputReplay::isRequested(argc, argv)) {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+        QApplication app(argc, argv);
+        return finishTrace(tracePath, InputReplay::run(app.arguments()));
+    }
+
     // === 初始化阶段 ===
     QApplication app(argc, argv);  // 创建 Qt 应用对象
 
@@ -23,5 +68,5 @@ int main(int argc, char *argv[])
     mainWindow.show();       // 显示主窗口
 
     // === 事件循环 ===
-    return app.exec();  // 进入 Qt 事件循环
+    return finishTrace(tracePath, app.exec());  // 进入 Qt 事件循环，退出时写出跟踪文件
 }
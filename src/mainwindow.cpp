@@ -1,12 +1,80 @@
 #include "mainwindow.h"
 #include "canvaswidget.h"   // 核心画布组件
-#include "treenode.h"
+#include "scenefile.h"
+#include "sceneloader.h"
+#include "diskscanner.h"
+#include "inputrecorder.h"
+#include "pdfexporter.h"
+#include "treemaplayout.h"
+#include "tracing.h"
+#include "undostack.h"
+#include "scenejournal.h"
+#include <QInputDialog>
+#include <QProgressDialog>
 #include <QMenuBar>         // 菜单栏
 #include <QAction>          // 菜单动作
 #include <QFileDialog>      // 文件对话框
 #include <QApplication>     // 应用全局对象
 #include <qstandardpaths.h>
 #include <QMessageBox>
+#include <QStatusBar>
+#include <QTimer>
+#include <QLocale>
+#include <QDir>
+#include <QFileInfo>
+
+namespace {
+
+// 结束后台任务的进度对话框（autoClose 关闭时 reset() 不会隐藏对话框）
+void closeProgress(QProgressDialog *dialog)
+{
+    if (!dialog) return;
+    dialog->reset();
+    dialog->hide();
+}
+
+} // namespace
+
+// 修改叶节点权重：布局、层次汇总信息和受影响节点的几何作为一步撤销
+class MainWindow::WeightCommand : public UndoCommand
+{
+public:
+    WeightCommand(MainWindow *window, int index, NodeId node, double before, double after,
+                  const QVector<NodeId> &nodes, const QVector<QRect> &beforeRects,
+                  const QVector<QRect> &afterRects)
+        : m_window(window), m_generation(window->m_treemapGeneration), m_index(index), m_node(node)
+        , m_before(before), m_after(after), m_nodes(nodes), m_beforeRects(beforeRects)
+        , m_afterRects(afterRects) {}
+
+    void undo() override { apply(m_before, m_beforeRects); }
+    void redo() override { apply(m_after, m_afterRects); }
+    qsizetype memoryCost() const override
+    {
+        return sizeof(*this) + m_nodes.size() * qsizetype(sizeof(NodeId) + 2 * sizeof(QRect));
+    }
+
+private:
+    void apply(double weight, const QVector<QRect> &rects)
+    {
+        // 清空画布后树图已失效（撤销清空不会恢复布局），此时只恢复画布上的状态
+        if (m_window->m_treemapGeneration == m_generation) {
+            m_window->m_treemap.setWeight(m_index, weight);
+        }
+        CanvasWidget *canvas = m_window->m_canvasWidget;
+        canvas->setLeafWeight(m_node, weight);
+        canvas->applyNodeGeometries(m_nodes, rects);
+    }
+
+    MainWindow *m_window;
+    quint64 m_generation;
+    int m_index;
+    NodeId m_node;
+    double m_before;
+    double m_after;
+    QVector<NodeId> m_nodes;
+    QVector<QRect> m_beforeRects;
+    QVector<QRect> m_afterRects;
+};
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -19,6 +87,78 @@ MainWindow::MainWindow(QWidget *parent)
     m_canvasWidget = new CanvasWidget(this);
     setCentralWidget(m_canvasWidget);
 
+    // 后台加载器：解析完成后一次性替换画布场景
+    m_loader = new SceneLoader(this);
+    connect(m_loader, &SceneLoader::progressChanged, this, [this](int percent) {
+        if (m_loadProgress) m_loadProgress->setValue(percent);
+    });
+    connect(m_loader, &SceneLoader::loaded, this, [this](const SceneData &scene) {
+        closeProgress(m_loadProgress);
+        m_canvasWidget->setScene(scene);
+        m_journal->setDocumentPath(m_loadingPath);
+    });
+    connect(m_loader, &SceneLoader::failed, this, [this](const QString &error) {
+        closeProgress(m_loadProgress);
+        QMessageBox::warning(this, tr("错误"), error);
+    });
+    connect(m_loader, &SceneLoader::canceled, this, [this]() {
+        closeProgress(m_loadProgress);
+    });
+
+    // 后台目录扫描：完成后按磁盘占用生成树图
+    m_scanner = new DiskScanner(this);
+    connect(m_scanner, &DiskScanner::progressChanged, this,
+            [this](qint64 directories, qint64 files, qint64 bytes) {
+        if (!m_scanProgress) return;
+        m_scanProgress->setLabelText(tr("已扫描 %1 个目录、%2 个文件（%3）")
+                                         .arg(directories).arg(files)
+                                         .arg(QLocale().formattedDataSize(bytes)));
+    });
+    connect(m_scanner, &DiskScanner::scanned, this, [this](const TreemapHierarchy &hierarchy) {
+        closeProgress(m_scanProgress);
+        // 目录留出标题栏显示名称和大小
+        TreemapLayout::Options options;
+        options.headerHeight = 20;
+        applyTreemap(hierarchy, options);
+    });
+    connect(m_scanner, &DiskScanner::failed, this, [this](const QString &error) {
+        closeProgress(m_scanProgress);
+        QMessageBox::warning(this, tr("错误"), error);
+    });
+    connect(m_scanner, &DiskScanner::canceled, this, [this]() {
+        closeProgress(m_scanProgress);
+    });
+
+    m_inputRecorder = new InputRecorder(m_canvasWidget, this);
+
+    // 后台 PDF 导出
+    m_pdfExporter = new PdfExporter(this);
+    connect(m_pdfExporter, &PdfExporter::progressChanged, this, [this](int percent) {
+        if (m_pdfProgress) m_pdfProgress->setValue(percent);
+    });
+    connect(m_pdfExporter, &PdfExporter::exported, this, [this](const QString &path) {
+        closeProgress(m_pdfProgress);
+        statusBar()->showMessage(tr("已导出 %1").arg(QDir::toNativeSeparators(path)), 5000);
+    });
+    connect(m_pdfExporter, &PdfExporter::failed, this, [this](const QString &error) {
+        closeProgress(m_pdfProgress);
+        QMessageBox::warning(this, tr("错误"), error);
+    });
+    connect(m_pdfExporter, &PdfExporter::canceled, this, [this]() {
+        closeProgress(m_pdfProgress);
+    });
+
+    // 画布被清空或整体替换时树图失效（单个节点被删除时保留映射：撤销删除会恢复同一句柄，
+    // 使用时再检查节点是否存活）
+    connect(m_canvasWidget, &CanvasWidget::cleared, this, &MainWindow::resetTreemap);
+
+    // 自动保存日志：先处理上次异常退出留下的日志，再开始记录
+    m_journal = new SceneJournal(this);
+    connect(m_journal, &SceneJournal::failed, this, [this](const QString &error) {
+        statusBar()->showMessage(error, 5000);
+    });
+    QTimer::singleShot(0, this, &MainWindow::recoverAutosave);
+
     // 初始化菜单系统
     createMenu();
 }
@@ -58,6 +198,29 @@ void MainWindow::createMenu()
     fileMenu->addAction(m_openAction);
 
     // 创建矩形菜单
+    QMenu *editMenu = menuBar()->addMenu(tr("编辑"));
+    UndoStack *undoStack = m_canvasWidget->undoStack();
+
+    // 撤销动作
+    m_undoAction = new QAction(tr("撤销(&U)"), this);
+    m_undoAction->setShortcut(QKeySequence::Undo);  // 绑定Ctrl+Z
+    connect(m_undoAction, &QAction::triggered, m_canvasWidget, &CanvasWidget::undo);
+    editMenu->addAction(m_undoAction);
+
+    // 重做动作
+    m_redoAction = new QAction(tr("重做(&R)"), this);
+    m_redoAction->setShortcuts({QKeySequence("Ctrl+Y"), QKeySequence("Ctrl+Shift+Z")});
+    connect(m_redoAction, &QAction::triggered, m_canvasWidget, &CanvasWidget::redo);
+    editMenu->addAction(m_redoAction);
+
+    // 没有可撤销的步骤时禁用动作（按键交给画布，创建连接线时 Ctrl+Z 仍可取消）
+    auto updateUndoActions = [this, undoStack]() {
+        m_undoAction->setEnabled(undoStack->canUndo());
+        m_redoAction->setEnabled(undoStack->canRedo());
+    };
+    connect(undoStack, &UndoStack::changed, this, updateUndoActions);
+    updateUndoActions();
+
     QMenu *recMenu = menuBar()->addMenu(tr("矩形"));
 
     // 新建矩形动作
@@ -65,6 +228,57 @@ void MainWindow::createMenu()
     m_recAction->setShortcut(QKeySequence("Ctrl+R"));  // 绑定Ctrl+R
     connect(m_recAction, &QAction::triggered, this, &MainWindow::onRec);
     recMenu->addAction(m_recAction);
+
+    // 从数据生成树图动作
+    m_treemapAction = new QAction(tr("从数据生成树图(&T)"), this);
+    m_treemapAction->setShortcut(QKeySequence("Ctrl+T"));  // 绑定Ctrl+T
+    connect(m_treemapAction, &QAction::triggered, this, &MainWindow::onTreemap);
+    recMenu->addAction(m_treemapAction);
+
+    // 扫描目录生成磁盘占用树图动作
+    m_scanAction = new QAction(tr("扫描目录生成树图(&D)..."), this);
+    m_scanAction->setShortcut(QKeySequence("Ctrl+D"));  // 绑定Ctrl+D
+    connect(m_scanAction, &QAction::triggered, this, &MainWindow::onScanDirectory);
+    recMenu->addAction(m_scanAction);
+
+    // 修改权重动作
+    m_weightAction = new QAction(tr("修改权重(&W)"), this);
+    m_weightAction->setShortcut(QKeySequence("Ctrl+E"));  // 绑定Ctrl+E
+    connect(m_weightAction, &QAction::triggered, this, &MainWindow::onWeight);
+    recMenu->addAction(m_weightAction);
+
+    QMenu *viewMenu = menuBar()->addMenu(tr("视图"));
+
+    // 性能信息叠加层
+    m_statsAction = new QAction(tr("显示性能信息(&I)"), this);
+    m_statsAction->setShortcut(QKeySequence("F3"));  // 绑定F3
+    m_statsAction->setCheckable(true);
+    connect(m_statsAction, &QAction::toggled, m_canvasWidget, &CanvasWidget::setStatsOverlayVisible);
+    viewMenu->addAction(m_statsAction);
+
+    // 分块渲染（多线程光栅化）
+    m_tiledAction = new QAction(tr("分块渲染(&T)"), this);
+    m_tiledAction->setCheckable(true);
+    connect(m_tiledAction, &QAction::toggled, m_canvasWidget, &CanvasWidget::setTiledRendering);
+    viewMenu->addAction(m_tiledAction);
+
+    // 记录性能跟踪
+    m_traceAction = new QAction(tr("记录性能跟踪(&R)"), this);
+    m_traceAction->setCheckable(true);
+    m_traceAction->setChecked(Tracing::isEnabled());  // 可能已由环境变量开启
+    connect(m_traceAction, &QAction::toggled, this, [](bool on) { Tracing::setEnabled(on); });
+    viewMenu->addAction(m_traceAction);
+
+    // 导出性能跟踪
+    m_exportTraceAction = new QAction(tr("导出性能跟踪(&E)..."), this);
+    connect(m_exportTraceAction, &QAction::triggered, this, &MainWindow::onExportTrace);
+    viewMenu->addAction(m_exportTraceAction);
+
+    // 录制输入（回放时测量交互延迟）
+    m_recordInputAction = new QAction(tr("录制输入(&I)"), this);
+    m_recordInputAction->setCheckable(true);
+    connect(m_recordInputAction, &QAction::toggled, this, &MainWindow::onRecordInput);
+    viewMenu->addAction(m_recordInputAction);
 }
 
 void MainWindow::onNew()
@@ -80,19 +294,27 @@ void MainWindow::onSave()
         this,
         tr("保存文件"),
         QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation),
-        tr("文本文件 (*.txt)")
+        tr("文本文件 (*.txt);;二进制文件 (*.tmap)")
         );
 
     if (!filePath.isEmpty()) {
-        // 确保文件后缀正确
-        if (!filePath.endsWith(".txt", Qt::CaseInsensitive)) {
+        // 确保文件后缀正确（未指定时使用文本格式）
+        if (!filePath.endsWith(".txt", Qt::CaseInsensitive)
+            && !filePath.endsWith(SceneFile::BINARY_SUFFIX, Qt::CaseInsensitive)) {
             filePath += ".txt";
         }
-        // 委托画布执行保存操作
-        m_canvasWidget->saveToFile(filePath);
+        // 委托画布执行保存操作，成功后自动保存日志随文档迁移
+        if (m_canvasWidget->saveToFile(filePath)) {
+            m_journal->setDocumentPath(filePath);
+        }
     }
 }
 void MainWindow::onPdf(){
+    if (m_pdfExporter->isRunning()) {
+        QMessageBox::information(this, tr("提示"), tr("上一次 PDF 导出尚未完成，请等待完成或取消后再导出。"));
+        return;
+    }
+
     QString filePath = QFileDialog::getSaveFileName(
         this,
         tr("保存文件"),
@@ -105,13 +327,96 @@ void MainWindow::onPdf(){
         if (!filePath.endsWith(".pdf", Qt::CaseInsensitive)) {
             filePath += ".pdf";
         }
-        // 委托画布执行保存操作
-        m_canvasWidget->savetopdf(filePath);
+
+        // 页面布局：整个场景一页，或按 A4 分页平铺（每页 1 像素对应 1 点）
+        const QStringList layouts = {tr("单页（整个场景）"), tr("A4 分页平铺")};
+        bool ok = false;
+        const QString layout = QInputDialog::getItem(this, tr("导出 PDF"), tr("页面布局："),
+                                                     layouts, 0, false, &ok);
+        if (!ok) return;
+        SceneExporter::PdfOptions options;
+        options.tiledPages = layout == layouts[1];
+
+        // 进度对话框不阻塞画布，导出期间可以继续编辑
+        if (!m_pdfProgress) {
+            m_pdfProgress = new QProgressDialog(tr("正在导出 PDF..."), tr("取消"), 0, 100, this);
+            m_pdfProgress->setWindowModality(Qt::NonModal);
+            m_pdfProgress->setMinimumDuration(300);
+            m_pdfProgress->setAutoClose(false);
+            m_pdfProgress->setAutoReset(false);
+            connect(m_pdfProgress, &QProgressDialog::canceled, m_pdfExporter, &PdfExporter::cancel);
+        }
+        m_pdfProgress->setValue(0);
+
+        // 在后台线程中绘制当前场景的快照；没有节点时导出与画布等大的空白页
+        m_pdfExporter->start(filePath, m_canvasWidget->snapshot(),
+                             QRectF(0, 0, m_canvasWidget->width(), m_canvasWidget->height()), options);
+    }
+}
+
+void MainWindow::onExportTrace()
+{
+    if (Tracing::eventCount() == 0) {
+        QMessageBox::information(this, tr("提示"), tr("尚未记录任何性能事件，请先开启\"记录性能跟踪\"。"));
+        return;
+    }
+
+    QString filePath = QFileDialog::getSaveFileName(
+        this,
+        tr("导出性能跟踪"),
+        QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation),
+        tr("Chrome 跟踪文件 (*.json)")
+        );
+    if (filePath.isEmpty()) return;
+    if (!filePath.endsWith(".json", Qt::CaseInsensitive)) {
+        filePath += ".json";
+    }
+
+    QString error;
+    if (!Tracing::writeChromeTrace(filePath, &error)) {
+        QMessageBox::warning(this, tr("错误"), error);
     }
 }
+
+void MainWindow::onRecordInput(bool recording)
+{
+    if (recording) {
+        m_inputRecorder->start();
+        statusBar()->showMessage(tr("正在录制画布输入，再次选择\"录制输入\"结束"));
+        return;
+    }
+
+    m_inputRecorder->stop();
+    statusBar()->clearMessage();
+    if (m_inputRecorder->recording().events.isEmpty()) {
+        QMessageBox::information(this, tr("提示"), tr("录制期间画布没有收到任何输入。"));
+        return;
+    }
+
+    QString filePath = QFileDialog::getSaveFileName(
+        this,
+        tr("保存输入录制"),
+        QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation),
+        tr("输入录制 (*.rec)")
+        );
+    if (filePath.isEmpty()) return;
+    if (!filePath.endsWith(".rec", Qt::CaseInsensitive)) {
+        filePath += ".rec";
+    }
+
+    // 起始场景保存在录制文件旁（同名 .tmap），回放时默认使用
+    const QFileInfo info(filePath);
+    const QString scenePath = info.dir().filePath(info.completeBaseName() + SceneFile::BINARY_SUFFIX);
+    QString error;
+    if (!m_inputRecorder->recording().save(filePath, &error)
+        || !SceneFile::save(m_inputRecorder->startScene(), scenePath, &error)) {
+        QMessageBox::warning(this, tr("错误"), error);
+    }
+}
+
 void MainWindow::onRec(){
-    // 在画布中央创建初始矩形
-    const QRect canvasRect = m_canvasWidget->rect();
+    // 在当前可见区域中央创建初始矩形
+    const QRect canvasRect = m_canvasWidget->visibleSceneRect();
     const QPoint center = canvasRect.center();
 
     // 初始矩形尺寸（可自定义）
@@ -128,117 +433,186 @@ void MainWindow::onRec(){
     m_canvasWidget->addTreeNode(initRect, "新建节点");
 }
 
-// == 文件打开 ==
-void MainWindow::onOpen()
+// == 自动布局 ==
+void MainWindow::onTreemap()
 {
-    // 获取打开路径
     QString path = QFileDialog::getOpenFileName(this,
-                                                tr("打开文件"), "",
-                                                tr("文本文件 (*.txt);;所有文件 (*)"));
-
+                                                tr("打开层次数据"), "",
+                                                tr("层次数据 (*.csv *.txt);;所有文件 (*)"));
     if (path.isEmpty()) return;
 
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, tr("错误"), tr("无法打开文件"));
+    TreemapHierarchy hierarchy;
+    QString error;
+    if (!hierarchy.load(path, &error)) {
+        QMessageBox::warning(this, tr("错误"), error);
         return;
     }
 
-    // 清空当前场景
-    m_canvasWidget->clear();
-
-    QTextStream in(&file);
-    QVector<TreeNode*> nodes; // 存储加载的节点
-    QString currentSection;
-    int lineCount = 0;
+    // 选择布局算法（顺序与 TreemapLayout::Algorithm 一致）
+    const QStringList algorithms{tr("正方化"), tr("切片"), tr("条带")};
+    bool ok = false;
+    const QString choice = QInputDialog::getItem(this, tr("布局算法"), tr("算法："),
+                                                 algorithms, 0, false, &ok);
+    if (!ok) return;
 
-    while (!in.atEnd()) {
-        QString line = in.readLine().trimmed();
-        lineCount++;
-
-        if (line.isEmpty()) continue;
-
-        // 检测段标题
-        if (line.startsWith('[') && line.endsWith(']')) {
-            currentSection = line.mid(1, line.length() - 2);
-            continue;
-        }
+    TreemapLayout::Options options;
+    options.algorithm = TreemapLayout::Algorithm(algorithms.indexOf(choice));
+    applyTreemap(hierarchy, options);
+}
 
-        if (currentSection == "Nodes") {
-            // 解析节点行: ID,x,y,width,height,text
-            QStringList parts = line.split(',');
-            if (parts.size() < 6) {
-                qWarning() << "无效节点行 #" << lineCount << ":" << line;
-                continue;
-            }
+void MainWindow::onScanDirectory()
+{
+    const QString root = QFileDialog::getExistingDirectory(this, tr("选择要扫描的目录"));
+    if (root.isEmpty()) return;
+
+    // 目录数事先未知，进度对话框只显示已扫描的数量
+    if (!m_scanProgress) {
+        m_scanProgress = new QProgressDialog(tr("正在扫描目录..."), tr("取消"), 0, 0, this);
+        m_scanProgress->setWindowModality(Qt::WindowModal);
+        m_scanProgress->setMinimumDuration(300);
+        m_scanProgress->setAutoClose(false);
+        m_scanProgress->setAutoReset(false);
+        connect(m_scanProgress, &QProgressDialog::canceled, m_scanner, &DiskScanner::cancel);
+    }
+    m_scanProgress->setLabelText(tr("正在扫描目录..."));
+    m_scanProgress->setValue(0);
 
-            bool ok;
-            int id = parts[0].toInt(&ok);
-            if (!ok || id < 0) continue;
+    m_scanner->start(root);
+}
 
-            int x = parts[1].toInt(&ok);
-            if (!ok) continue;
+void MainWindow::applyTreemap(const TreemapHierarchy &hierarchy, const TreemapLayout::Options &options)
+{
+    TRACE_SCOPE("MainWindow::applyTreemap");
+    TreemapLayout layout;
+    layout.setOptions(options);
+    QString error;
+    if (!layout.setHierarchy(hierarchy, &error)) {
+        QMessageBox::warning(this, tr("错误"), error);
+        return;
+    }
 
-            int y = parts[2].toInt(&ok);
-            if (!ok) continue;
+    // 铺满当前可见区域，结果整体写入场景数据后一次性替换画布
+    layout.layout(m_canvasWidget->visibleSceneRect());
+    SceneData scene;
+    layout.writeTo(&scene);
+    const QVector<NodeId> nodes = m_canvasWidget->setScene(scene); // 会先清空旧的树图记录
+
+    // 父子关系交给画布：缩小时屏幕上过小的子树聚合为一个矩形
+    m_canvasWidget->setHierarchy(nodes, hierarchy.parent, hierarchy.weight);
+
+    // 保留布局状态，之后修改权重时增量更新
+    m_treemap = layout;
+    m_treemapNodes = nodes;
+    m_treemapIndex.reserve(nodes.size());
+    for (int i = 0; i < nodes.size(); ++i) {
+        m_treemapIndex.insert(nodes[i], i);
+    }
+}
 
-            int width = parts[3].toInt(&ok);
-            if (!ok) continue;
+void MainWindow::onWeight()
+{
+    const NodeId node = m_canvasWidget->hoveredNode();
+    const int index = m_treemapIndex.value(node, -1);
+    if (index < 0 || !m_treemap.isLeaf(index) || !m_canvasWidget->store().isAlive(node)) {
+        QMessageBox::information(this, tr("提示"), tr("请将鼠标悬停在自动布局生成的叶节点上"));
+        return;
+    }
 
-            int height = parts[4].toInt(&ok);
-            if (!ok) continue;
+    bool ok = false;
+    const double weight = QInputDialog::getDouble(this, tr("修改权重"), tr("权重："),
+                                                  m_treemap.totalWeight(index), 0, 1e15, 3, &ok);
+    if (!ok) return;
+
+    // 只移动几何发生变化的节点：一次重绘，只更新它们的连接线
+    const double before = m_treemap.totalWeight(index);
+    const QVector<int> moved = m_treemap.setWeight(index, weight);
+    QVector<NodeId> nodes;
+    QVector<QRect> beforeRects;
+    QVector<QRect> afterRects;
+    nodes.reserve(moved.size());
+    beforeRects.reserve(moved.size());
+    afterRects.reserve(moved.size());
+    for (int i : moved) {
+        // 已删除的节点不移动（布局中仍保留其矩形，撤销删除时按删除前的几何恢复）
+        const NodeId id = m_treemapNodes[i];
+        if (!m_canvasWidget->store().isAlive(id)) continue;
+        nodes.append(id);
+        beforeRects.append(m_canvasWidget->store().rect(id));
+        afterRects.append(m_treemap.snappedRect(i));
+    }
 
-            // 合并文本部分（可能包含逗号）
-            QString text = parts.mid(5).join(",");
+    // 布局已经更新，画布上的修改不经过撤销栈，整体作为一条命令入栈（不与其他命令合并）
+    CanvasWidget::Batch batch(m_canvasWidget);
+    m_canvasWidget->setLeafWeight(node, weight);
+    m_canvasWidget->applyNodeGeometries(nodes, afterRects);
+    m_canvasWidget->undoStack()->push(new WeightCommand(this, index, node, before, weight,
+                                                        nodes, beforeRects, afterRects));
+}
 
-            // 创建节点
-            const QRect canvasRect = m_canvasWidget->rect();
-            const QPoint center = canvasRect.center();
+void MainWindow::resetTreemap()
+{
+    m_treemap = TreemapLayout();
+    m_treemapNodes.clear();
+    m_treemapIndex.clear();
+    ++m_treemapGeneration;
+}
 
-            // 初始矩形尺寸（可自定义）
-            QRect initRect(
-                x,
-                y,
-                width,
-                height
-                );
+// == 文件打开 ==
+void MainWindow::onOpen()
+{
+    // 获取打开路径
+    QString path = QFileDialog::getOpenFileName(this,
+                                                tr("打开文件"), "",
+                                                tr("画布文件 (*.txt *.tmap);;所有文件 (*)"));
 
-            // 通知画布添加新节点
-            TreeNode* newnode = m_canvasWidget->addTreeNode(initRect, text);
-            if (id >= nodes.size()) {
-                nodes.resize(id + 1);
-            }
-            nodes[id] = newnode;
-        }
-        else if (currentSection == "Connections") {
-            // 解析连接行: startID,endID
-            QStringList parts = line.split(',');
-            if (parts.size() != 2) {
-                qWarning() << "无效连接行 #" << lineCount << ":" << line;
-                continue;
-            }
+    if (path.isEmpty()) return;
 
-            bool ok;
-            int startID = parts[0].toInt(&ok);
-            if (!ok || startID < 0) continue;
+    // 进度对话框在加载超过 300ms 后才显示，小文件不会闪烁
+    if (!m_loadProgress) {
+        m_loadProgress = new QProgressDialog(tr("正在加载文件..."), tr("取消"), 0, 100, this);
+        m_loadProgress->setWindowModality(Qt::WindowModal);
+        m_loadProgress->setMinimumDuration(300);
+        m_loadProgress->setAutoClose(false);
+        m_loadProgress->setAutoReset(false);
+        connect(m_loadProgress, &QProgressDialog::canceled, m_loader, &SceneLoader::cancel);
+    }
+    m_loadProgress->setValue(0);
+    m_loadingPath = path;
 
-            int endID = parts[1].toInt(&ok);
-            if (!ok || endID < 0) continue;
+    // 在后台线程中解析（格式根据文件头自动识别），完成后整体替换当前场景
+    m_loader->start(path);
+}
 
-            // 检查节点ID是否有效
-            if (startID >= nodes.size() || endID >= nodes.size() ||
-                !nodes[startID] || !nodes[endID]) {
-                qWarning() << "无效节点ID在连接行 #" << lineCount;
-                continue;
+// == 自动保存恢复 ==
+void MainWindow::recoverAutosave()
+{
+    QString documentPath;
+    const QString journalPath = SceneJournal::pendingRecovery();
+    if (!journalPath.isEmpty()) {
+        const auto answer = QMessageBox::question(this, tr("恢复"),
+                                                  tr("程序上次没有正常退出，是否恢复自动保存的内容？"));
+        SceneData scene;
+        SceneJournal::Hierarchy hierarchy;
+        QString error;
+        if (answer == QMessageBox::Yes
+            && SceneJournal::recover(journalPath, &scene, &documentPath, &error, &hierarchy)) {
+            const QVector<NodeId> nodes = m_canvasWidget->setScene(scene);
+
+            // 重建层次细节聚合（树图的布局状态不保存，恢复后不能再增量修改权重）
+            if (!hierarchy.nodes.isEmpty()) {
+                QVector<NodeId> members;
+                members.reserve(hierarchy.nodes.size());
+                for (quint32 id : qAsConst(hierarchy.nodes)) members.append(nodes.value(int(id), INVALID_ID));
+                m_canvasWidget->setHierarchy(members, hierarchy.parents, hierarchy.weights);
             }
-
-            // 创建连接
-            m_canvasWidget->addConnection(nodes[startID],nodes[endID]);
+        } else {
+            if (!error.isEmpty()) QMessageBox::warning(this, tr("错误"), error);
+            documentPath.clear();
+            SceneJournal::discard(journalPath);
         }
     }
 
-    file.close();
-
-    // 刷新画布
-    m_canvasWidget->update();
+    // 之后的每次修改都写入日志（恢复出的场景作为新的基准）
+    m_journal->start(documentPath, &m_canvasWidget->store(), &m_canvasWidget->hierarchy());
+    m_canvasWidget->setJournal(m_journal);
 }
@@ -1,9 +1,19 @@
 #pragma once
 
 #include <QMainWindow>
+#include <QHash>
+#include <QVector>
+#include "sceneids.h"
+#include "treemaplayout.h"
 
 // 前向声明（避免头文件相互包含）
 class CanvasWidget;
+class SceneLoader;
+class DiskScanner;
+class InputRecorder;
+class PdfExporter;
+class QProgressDialog;
+class SceneJournal;
 
 /**
  * @brief 主窗口类，负责管理应用程序的主界面框架
@@ -46,16 +56,89 @@ private slots:
 
     void onPdf();
 
+    /**
+     * @brief 处理"从数据生成树图"菜单动作的槽函数
+     * 读取带权层次数据，按所选算法自动布局后替换当前场景
+     */
+    void onTreemap();
+
+    /**
+     * @brief 处理"扫描目录生成树图"菜单动作的槽函数
+     * 在后台并行扫描所选目录，完成后按磁盘占用布局并替换当前场景
+     */
+    void onScanDirectory();
+
+    /**
+     * @brief 处理"修改权重"菜单动作的槽函数
+     * 修改悬停叶节点的权重，只移动几何发生变化的节点
+     */
+    void onWeight();
+
+    /**
+     * @brief 处理"导出性能跟踪"菜单动作的槽函数
+     * 把已记录的事件保存为 Chrome trace_event JSON（chrome://tracing 或 Perfetto 打开）
+     */
+    void onExportTrace();
+
+    /**
+     * @brief 处理"录制输入"开关的槽函数
+     * 开始录制发送给画布的鼠标和键盘事件；停止时保存为录制文件，供 --replay 回放测量延迟
+     */
+    void onRecordInput(bool recording);
+
+    /**
+     * @brief 启动后检查上次异常退出留下的自动保存日志
+     * 用户选择恢复时重放日志，然后以当前场景为基准开始记录
+     */
+    void recoverAutosave();
+
 private:
     // 核心画布组件（负责所有图形元素的绘制和交互）
     CanvasWidget *m_canvasWidget;
 
+    // 后台文件加载
+    SceneLoader *m_loader;                        // 在线程池中解析场景文件
+    QProgressDialog *m_loadProgress = nullptr;    // 加载进度对话框（可取消）
+    QString m_loadingPath;                        // 正在加载的文件
+
+    // 后台目录扫描
+    DiskScanner *m_scanner;                       // 在工作窃取线程池中扫描目录树
+    QProgressDialog *m_scanProgress = nullptr;    // 扫描进度对话框（可取消）
+
+    // 后台 PDF 导出（导出开始时的场景快照，导出期间可以继续编辑）
+    PdfExporter *m_pdfExporter;
+    QProgressDialog *m_pdfProgress = nullptr;     // 导出进度对话框（非模态，可取消）
+
+    // 自动保存（日志随文档保存/打开迁移到文档旁）
+    SceneJournal *m_journal;
+
     // 菜单栏动作
     QAction *m_newAction;   // "新建"动作
     QAction *m_saveAction;  // "保存"动作
     QAction *m_recAction;
     QAction *m_openAction;
     QAction *m_pdfAction;
+    QAction *m_treemapAction;
+    QAction *m_weightAction;
+    QAction *m_scanAction;         // "扫描目录生成树图"动作
+    QAction *m_undoAction;         // "撤销"动作
+    QAction *m_redoAction;         // "重做"动作
+    QAction *m_statsAction;        // "显示性能信息"开关
+    QAction *m_traceAction;        // "记录性能跟踪"开关
+    QAction *m_tiledAction;        // "分块渲染"开关
+    QAction *m_exportTraceAction;  // "导出性能跟踪"动作
+    QAction *m_recordInputAction;  // "录制输入"开关
+
+    InputRecorder *m_inputRecorder; // 录制画布输入（用于回放测量交互延迟）
+
+    // 自动布局生成的树图（画布节点与布局下标一一对应；节点被删除后映射保留，使用时检查是否存活）
+    TreemapLayout m_treemap;
+    QVector<NodeId> m_treemapNodes;
+    QHash<NodeId, int> m_treemapIndex;
+    quint64 m_treemapGeneration = 0; // 每次替换或清除树图时递增（撤销命令据此判断布局是否仍然有效）
+    class WeightCommand;
+    void resetTreemap();
+    void applyTreemap(const TreemapHierarchy &hierarchy, const TreemapLayout::Options &options); // 布局后整体替换场景
 
     /**
      * @brief 初始化菜单栏
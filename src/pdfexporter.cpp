@@ -0,0 +1,62 @@
+#include "pdfexporter.h"
+#include "tracing.h"
+#include <QtConcurrent>
+
+PdfExporter::PdfExporter(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<Result>::finished, this, &PdfExporter::onFinished);
+}
+
+PdfExporter::~PdfExporter()
+{
+    cancel();
+    m_watcher.waitForFinished();
+}
+
+bool PdfExporter::start(const QString &path, const SceneSnapshot &snapshot, const QRectF &fallback,
+                        const SceneExporter::PdfOptions &options)
+{
+    // 等待上一次导出结束会阻塞界面线程，因此同一时间只允许一个导出
+    if (isRunning()) return false;
+
+    m_cancel = false;
+    const int generation = ++m_generation;
+    m_watcher.setFuture(QtConcurrent::run([this, path, snapshot, fallback, options, generation]() {
+        TRACE_SCOPE("PdfExporter::export");
+        // 绘制会写入文本排版缓存，使用快照的私有副本（列数据仍然共享）
+        const SceneStore store = snapshot.store();
+        Result result;
+        result.path = path;
+        result.ok = SceneExporter::exportPdf(path, store, fallback, &result.error, options, &m_cancel,
+                                             [this, generation](int percent) {
+            // 信号跨线程发送时自动排队到 GUI 线程
+            if (generation == m_generation) emit progressChanged(percent);
+        });
+        result.canceled = !result.ok && m_cancel; // 已写完的文件不因迟到的取消作废
+        return result;
+    }));
+    return true;
+}
+
+void PdfExporter::cancel()
+{
+    m_cancel = true;
+}
+
+bool PdfExporter::isRunning() const
+{
+    return m_watcher.isRunning();
+}
+
+void PdfExporter::onFinished()
+{
+    const Result result = m_watcher.result();
+    if (result.canceled) {
+        emit canceled();
+    } else if (!result.ok) {
+        emit failed(result.error);
+    } else {
+        emit exported(result.path);
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "sceneexporter.h"
+#include "scenesnapshot.h"
+#include <QObject>
+#include <QFutureWatcher>
+#include <atomic>
+
+/**
+ * @brief 后台 PDF 导出
+ *
+ * 在线程池中绘制场景快照（SceneSnapshot），开始导出后界面线程可以继续
+ * 编辑实时场景，导出的内容固定为开始时的状态。支持进度报告和取消；
+ * 取消或失败时目标文件保持不变。
+ */
+class PdfExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PdfExporter(QObject *parent = nullptr);
+    ~PdfExporter() override;
+
+    /**
+     * @brief 开始后台导出
+     * @param path 输出文件路径
+     * @param snapshot 要导出的场景
+     * @param fallback 场景为空时的页面范围
+     * @return 已有导出正在进行时返回 false（不等待，不影响正在进行的导出）
+     */
+    bool start(const QString &path, const SceneSnapshot &snapshot, const QRectF &fallback,
+               const SceneExporter::PdfOptions &options = SceneExporter::PdfOptions());
+
+    void cancel();           ///< 请求取消当前导出
+    bool isRunning() const;  ///< 是否正在导出
+
+signals:
+    void progressChanged(int percent);    ///< 导出进度（0-100）
+    void exported(const QString &path);   ///< 导出成功
+    void failed(const QString &error);    ///< 导出失败
+    void canceled();                      ///< 导出被取消
+
+private:
+    struct Result {
+        bool ok = false;
+        bool canceled = false;
+        QString path;
+        QString error;
+    };
+
+    void onFinished();
+
+    QFutureWatcher<Result> m_watcher; ///< 监视后台任务
+    std::atomic_bool m_cancel{false}; ///< 取消标志（工作线程读取）
+    std::atomic_int m_generation{0};  ///< 导出批次，用于丢弃过期的进度通知
+};
@@ -0,0 +1,408 @@
+#include "sceneexporter.h"
+#include "scenefile.h"
+#include "scenestore.h"
+#include "connection.h"
+#include "treenode.h"
+#include "svgwriter.h"
+#include "tracing.h"
+#include <QFontInfo>
+#include <QFontMetricsF>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QPageSize>
+#include <QImage>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <QtMath>
+#include <iterator>
+
+namespace {
+
+// 单张 PNG 的像素缓冲上限（约 1GB），超过时按比例缩小
+const qint64 MAX_IMAGE_BYTES = qint64(1) << 30;
+
+// 每绘制这么多个元素检查一次取消标志并报告进度
+const int PROGRESS_INTERVAL = 4096;
+
+// PNG 并行绘制的条带高度（像素行）
+const int PNG_BAND_HEIGHT = 128;
+
+// SVG 中每个 path 元素包含的连接线数
+const int SVG_PATH_LINES = 1024;
+
+// TreeNode::fittedFont 缩小后可能的字号（pt）及对应的 SVG 文本样式类
+const int SVG_FITTED_SIZES[] = {8, 9, 10, 11};
+const char* const SVG_FITTED_CLASSES[] = {"s8", "s9", "s10", "s11"};
+
+void setError(QString* error, const QString& message)
+{
+    if (error) *error = message;
+}
+
+// 按已处理的元素槽位数换算进度百分比
+struct Progress
+{
+    const std::atomic_bool* cancelled = nullptr;
+    const SceneExporter::ProgressCallback* callback = nullptr;
+    qint64 total = 0;   ///< 需要处理的元素总数
+    qint64 done = 0;
+    int pending = 0;    ///< 尚未计入 done 的元素数
+    int percent = -1;
+
+    // 处理完一个元素；已取消时返回 false
+    bool step()
+    {
+        return ++pending < PROGRESS_INTERVAL || flush();
+    }
+
+    bool flush()
+    {
+        done += pending;
+        pending = 0;
+        if (cancelled && cancelled->load()) return false;
+        const int current = total > 0 ? int(done * 100 / total) : 100;
+        if (current != percent && callback && *callback) (*callback)(current);
+        percent = current;
+        return true;
+    }
+};
+
+// PDF 分页平铺时的一页：场景区域和与之相交的元素（按槽位顺序，即层叠顺序）
+struct Page
+{
+    QRectF rect;
+    QVector<EdgeId> edges;
+    QVector<NodeId> nodes;
+};
+
+// 按层叠顺序绘制全部连接线和节点；取消时返回 false
+bool drawAll(QPainter* painter, const SceneStore& store, Progress& progress)
+{
+    // 连接线一次提交
+    QVector<QLineF> lines;
+    lines.reserve(store.edgeCount());
+    for (EdgeId conn = 0; conn < EdgeId(store.edgeSlots()); ++conn) {
+        if (!progress.step()) return false;
+        if (store.isEdgeAlive(conn) && !store.edgeLine(conn).isNull()) {
+            lines.append(store.edgeLine(conn));
+        }
+    }
+    Connection::drawLines(painter, lines.constData(), lines.size());
+
+    // 节点（槽位顺序即层叠顺序）
+    for (NodeId node = 0; node < NodeId(store.nodeSlots()); ++node) {
+        if (!progress.step()) return false;
+        if (store.isAlive(node)) {
+            store.drawNode(painter, node, TreeNode::CONTROL_POINT_SIZE,
+                           TreeNode::PLUS_ICON_SIZE);
+        }
+    }
+    return progress.flush();
+}
+
+// 只绘制一页的元素；取消时返回 false
+bool drawPage(QPainter* painter, const SceneStore& store, const Page& page, Progress& progress)
+{
+    QVector<QLineF> lines;
+    lines.reserve(page.edges.size());
+    for (EdgeId conn : page.edges) {
+        if (!progress.step()) return false;
+        lines.append(store.edgeLine(conn));
+    }
+    Connection::drawLines(painter, lines.constData(), lines.size());
+
+    for (NodeId node : page.nodes) {
+        if (!progress.step()) return false;
+        store.drawNode(painter, node, TreeNode::CONTROL_POINT_SIZE, TreeNode::PLUS_ICON_SIZE);
+    }
+    return progress.flush();
+}
+
+} // namespace
+
+QRectF SceneExporter::sceneBounds(const SceneStore& store, const QRectF& fallback)
+{
+    // 计算所有节点的边界矩形（顺序扫描几何列）
+    QRect boundingRect;
+    for (NodeId node = 0; node < NodeId(store.nodeSlots()); ++node) {
+        if (store.isAlive(node)) boundingRect |= store.rect(node);
+    }
+
+    // 如果没有节点，使用默认大小；否则添加边距
+    if (boundingRect.isEmpty()) {
+        return fallback;
+    }
+    return QRectF(boundingRect).adjusted(-20, -20, 20, 20);
+}
+
+void SceneExporter::drawScene(QPainter* painter, const SceneStore& store)
+{
+    Progress progress;
+    drawAll(painter, store, progress);
+}
+
+bool SceneExporter::exportPdf(const QString& path, const SceneStore& store,
+                              const QRectF& fallback, QString* error, const PdfOptions& options,
+                              const std::atomic_bool* cancelled, const ProgressCallback& progress)
+{
+    TRACE_SCOPE("SceneExporter::exportPdf");
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        setError(error, QStringLiteral("无法写入文件 %1").arg(path));
+        return false;
+    }
+
+    // 使用 QPdfWriter（更推荐）
+    QPdfWriter pdfWriter(&file);
+    pdfWriter.setTitle("树图导出");
+    pdfWriter.setCreator("矩形树图绘制器");
+    pdfWriter.setResolution(96);
+
+    // 单页时页面与场景范围一致；分页时按页面大小从左上角平铺
+    const QRectF boundingRect = sceneBounds(store, fallback);
+    const bool tiled = options.tiledPages && options.pageSize.isValid();
+    QVector<Page> pages;
+    qint64 total = qint64(store.nodeSlots()) + store.edgeSlots();
+    if (tiled) {
+        const QSizeF pageSize = options.pageSize.size(QPageSize::Point);
+        pdfWriter.setPageSize(options.pageSize);
+        const int columns = qMax(1, qCeil(boundingRect.width() / pageSize.width()));
+        const int rows = qMax(1, qCeil(boundingRect.height() / pageSize.height()));
+        pages.resize(columns * rows);
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < columns; ++c) {
+                pages[r * columns + c].rect = QRectF(boundingRect.topLeft()
+                    + QPointF(c * pageSize.width(), r * pageSize.height()), pageSize);
+            }
+        }
+
+        // 一遍扫描把元素分到与之相交的页面，总开销与元素数成正比，而不是页数 x 元素数
+        const auto forEachPage = [&](const QRectF& rect, auto func) {
+            const int c0 = qBound(0, qFloor((rect.left() - boundingRect.left()) / pageSize.width()), columns - 1);
+            const int c1 = qBound(0, qFloor((rect.right() - boundingRect.left()) / pageSize.width()), columns - 1);
+            const int r0 = qBound(0, qFloor((rect.top() - boundingRect.top()) / pageSize.height()), rows - 1);
+            const int r1 = qBound(0, qFloor((rect.bottom() - boundingRect.top()) / pageSize.height()), rows - 1);
+            for (int r = r0; r <= r1; ++r) {
+                for (int c = c0; c <= c1; ++c) func(pages[r * columns + c]);
+            }
+        };
+        total = 0;
+        for (EdgeId conn = 0; conn < EdgeId(store.edgeSlots()); ++conn) {
+            if (!store.isEdgeAlive(conn) || store.edgeLine(conn).isNull()) continue;
+            forEachPage(Connection::boundingRect(store.edgeLine(conn)), [&](Page& page) {
+                page.edges.append(conn);
+                total++;
+            });
+        }
+        for (NodeId node = 0; node < NodeId(store.nodeSlots()); ++node) {
+            if (!store.isAlive(node)) continue;
+            forEachPage(QRectF(store.rect(node)).adjusted(-1, -1, 1, 1), [&](Page& page) { // 含边框
+                page.nodes.append(node);
+                total++;
+            });
+        }
+    } else {
+        pdfWriter.setPageSize(QPageSize(boundingRect.size(), QPageSize::Point));
+        pages.resize(1);
+        pages[0].rect = boundingRect;
+    }
+    pdfWriter.setPageMargins(QMarginsF(0, 0, 0, 0));
+
+    QPainter painter;
+    if (!painter.begin(&pdfWriter)) {
+        setError(error, QStringLiteral("无法写入文件 %1").arg(path));
+        return false;
+    }
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    // 进度按绘制的元素数计算（跨页的元素在每页各计一次）
+    Progress tracker;
+    tracker.cancelled = cancelled;
+    tracker.callback = &progress;
+    tracker.total = total;
+    for (int i = 0; i < pages.size(); ++i) {
+        if (i > 0) pdfWriter.newPage();
+        painter.setWindow(pages[i].rect.toRect());
+        const bool drawn = tiled ? drawPage(&painter, store, pages[i], tracker)
+                                 : drawAll(&painter, store, tracker);
+        pages[i] = Page(); // 绘制完即释放该页的元素列表
+        if (!drawn) {
+            painter.end();
+            setError(error, QStringLiteral("导出已取消"));
+            return false; // 未提交的临时文件随 QSaveFile 析构删除
+        }
+    }
+
+    if (!painter.end() || !file.commit()) {
+        setError(error, QStringLiteral("写入文件 %1 失败").arg(path));
+        return false;
+    }
+    return true;
+}
+
+bool SceneExporter::exportPng(const QString& path, const SceneStore& store, qreal scale,
+                              const QRectF& fallback, QString* error)
+{
+    TRACE_SCOPE("SceneExporter::exportPng");
+    const QRectF boundingRect = sceneBounds(store, fallback);
+
+    // 限制像素缓冲大小，过大的场景自动降低缩放倍数
+    const qreal pixels = boundingRect.width() * boundingRect.height() * scale * scale;
+    if (pixels * 4 > MAX_IMAGE_BYTES) {
+        scale *= qSqrt(MAX_IMAGE_BYTES / 4 / pixels);
+    }
+
+    const QSize imageSize = (boundingRect.size() * scale).toSize().expandedTo(QSize(1, 1));
+    QImage image(imageSize, QImage::Format_ARGB32_Premultiplied);
+    if (image.isNull()) {
+        setError(error, QStringLiteral("无法分配 %1x%2 的图像")
+                            .arg(imageSize.width()).arg(imageSize.height()));
+        return false;
+    }
+    image.fill(Qt::white);
+
+    // 先把元素分到与之相交的条带（保持层叠顺序），再并行绘制各条带
+    struct Band {
+        int top = 0;
+        QVector<EdgeId> edges;
+        QVector<NodeId> nodes;
+    };
+    QVector<Band> bands((imageSize.height() + PNG_BAND_HEIGHT - 1) / PNG_BAND_HEIGHT);
+    for (int i = 0; i < bands.size(); ++i) bands[i].top = i * PNG_BAND_HEIGHT;
+    const auto bandRange = [&](const QRectF& rect, int* first, int* last) {
+        *first = qMax(0, int(qFloor((rect.top() - boundingRect.top()) * scale)) / PNG_BAND_HEIGHT);
+        *last = qMin(int(bands.size()) - 1,
+                     int(qFloor((rect.bottom() - boundingRect.top()) * scale)) / PNG_BAND_HEIGHT);
+    };
+    int first, last;
+    for (EdgeId conn = 0; conn < EdgeId(store.edgeSlots()); ++conn) {
+        if (!store.isEdgeAlive(conn) || store.edgeLine(conn).isNull()) continue;
+        bandRange(Connection::boundingRect(store.edgeLine(conn)), &first, &last);
+        for (int b = first; b <= last; ++b) bands[b].edges.append(conn);
+    }
+    for (NodeId node = 0; node < NodeId(store.nodeSlots()); ++node) {
+        if (!store.isAlive(node)) continue;
+        bandRange(QRectF(store.rect(node)).adjusted(-1, -1, 1, 1), &first, &last); // 含边框
+        for (int b = first; b <= last; ++b) bands[b].nodes.append(node);
+    }
+
+    // 各条带直接包装整幅图像中互不重叠的行，不复制像素（先取指针，避免在线程中分离）
+    uchar* const bits = image.bits();
+    const qsizetype bytesPerLine = image.bytesPerLine();
+    QtConcurrent::blockingMap(bands, [&](Band& band) {
+        TRACE_SCOPE("SceneExporter::renderBand");
+        const int height = qMin(PNG_BAND_HEIGHT, imageSize.height() - band.top);
+        QImage target(bits + band.top * bytesPerLine, imageSize.width(), height,
+                      bytesPerLine, image.format());
+
+        // 文本排版缓存不能跨线程共享，每个条带使用自己的副本（列数据仍然共享）
+        const SceneStore local = store.snapshot();
+        QPainter painter(&target);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.translate(0, -band.top);
+        painter.scale(scale, scale);
+        painter.translate(-boundingRect.topLeft());
+
+        QVector<QLineF> lines;
+        lines.reserve(band.edges.size());
+        for (EdgeId conn : qAsConst(band.edges)) lines.append(local.edgeLine(conn));
+        Connection::drawLines(&painter, lines.constData(), lines.size());
+        for (NodeId node : qAsConst(band.nodes)) {
+            local.drawNode(&painter, node, TreeNode::CONTROL_POINT_SIZE, TreeNode::PLUS_ICON_SIZE,
+                           TreeNode::detailFor(local.rect(node), scale));
+        }
+        band = Band(); // 绘制完即释放元素列表
+    });
+
+    if (!image.save(path, "PNG")) {
+        setError(error, QStringLiteral("无法写入文件 %1").arg(path));
+        return false;
+    }
+    return true;
+}
+
+bool SceneExporter::writeSvg(QIODevice* device, const SceneStore& store, const QRectF& fallback)
+{
+    TRACE_SCOPE("SceneExporter::writeSvg");
+    const QRectF boundingRect = sceneBounds(store, fallback);
+
+    // 样式与画布绘制一致，元素只带几何属性；字号与画布相同按 TreeNode::fittedFont 选择，
+    // 默认字体之外的几种字号各对应一个样式类
+    const QFont baseFont;
+    const QByteArray border = TreeNode::BORDER_COLOR.name().toLatin1();
+    QByteArray styleSheet =
+        "path{fill:none;stroke:" + Connection::LINE_COLOR.name().toLatin1()
+        + ";stroke-width:" + QByteArray::number(Connection::LINE_WIDTH) + "}"
+        + "rect{fill:" + TreeNode::FILL_COLOR.name().toLatin1() + ";stroke:" + border + ";stroke-width:1}"
+        + "rect.b{fill:#ffffff;stroke:none}"
+        + "rect.f{fill:" + border + ";stroke:none}"
+        + "text{fill:" + TreeNode::TEXT_COLOR.name().toLatin1() + ";font-family:sans-serif;font-size:"
+        + QByteArray::number(QFontInfo(baseFont).pixelSize())
+        + "px;text-anchor:middle;dominant-baseline:central}";
+    for (int i = 0; i < int(std::size(SVG_FITTED_SIZES)); ++i) {
+        QFont font = baseFont;
+        font.setPointSize(SVG_FITTED_SIZES[i]);
+        styleSheet += QByteArray("text.") + SVG_FITTED_CLASSES[i] + "{font-size:"
+                      + QByteArray::number(QFontInfo(font).pixelSize()) + "px}";
+    }
+    const auto classFor = [&baseFont](const QFont& font) -> const char* {
+        if (font.pointSize() == baseFont.pointSize() && font.pixelSize() == baseFont.pixelSize()) {
+            return nullptr;
+        }
+        for (int i = 0; i < int(std::size(SVG_FITTED_SIZES)); ++i) {
+            if (font.pointSize() == SVG_FITTED_SIZES[i]) return SVG_FITTED_CLASSES[i];
+        }
+        return nullptr;
+    };
+
+    SvgWriter svg(device);
+    svg.begin(boundingRect, styleSheet);
+    svg.writeRect(boundingRect, "b");
+
+    // 连接线按块合并为 path，位于所有节点之下
+    QVector<QLineF> lines;
+    lines.reserve(SVG_PATH_LINES);
+    for (EdgeId conn = 0; conn < EdgeId(store.edgeSlots()); ++conn) {
+        if (!store.isEdgeAlive(conn) || store.edgeLine(conn).isNull()) continue;
+        lines.append(store.edgeLine(conn));
+        if (lines.size() == SVG_PATH_LINES) {
+            svg.writeLines(lines.constData(), lines.size());
+            lines.clear();
+        }
+    }
+    svg.writeLines(lines.constData(), lines.size());
+
+    // 节点按槽位顺序（层叠顺序）写入；细节层次按 1:1 显示时选择，文本单行省略（不换行）
+    for (NodeId node = 0; node < NodeId(store.nodeSlots()); ++node) {
+        if (svg.hasError()) return false;
+        if (!store.isAlive(node)) continue;
+        const QRect rect = store.rect(node);
+        const TreeNode::DetailLevel detail = TreeNode::detailFor(rect, 1.0);
+        svg.writeRect(rect, detail == TreeNode::FilledRect ? "f" : nullptr);
+        if (detail != TreeNode::FullDetail || store.text(node).isEmpty()) continue;
+
+        const QRect textRect = rect.adjusted(TEXT_MARGIN, TEXT_MARGIN, -TEXT_MARGIN, -TEXT_MARGIN);
+        const QFont font = TreeNode::fittedFont(baseFont, textRect);
+        const QString text = QFontMetricsF(font).elidedText(store.text(node).toString(), Qt::ElideRight,
+                                                            textRect.width());
+        if (!text.isEmpty()) svg.writeText(QRectF(textRect).center(), text, classFor(font));
+    }
+    return svg.end();
+}
+
+bool SceneExporter::exportSvg(const QString& path, const SceneStore& store,
+                              const QRectF& fallback, QString* error)
+{
+    TRACE_SCOPE("SceneExporter::exportSvg");
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        setError(error, QStringLiteral("无法写入文件 %1").arg(path));
+        return false;
+    }
+    if (!writeSvg(&file, store, fallback) || !file.commit()) {
+        setError(error, QStringLiteral("写入文件 %1 失败").arg(path));
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QPageSize>
+#include <QRectF>
+#include <QString>
+#include <atomic>
+#include <functional>
+
+class QIODevice;
+class QPainter;
+class SceneStore;
+
+/**
+ * @brief 场景导出（PDF / PNG / SVG）
+ *
+ * 只依赖 SceneStore 和无状态的绘制函数，不需要 CanvasWidget 实例，
+ * 因此既用于画布的“保存为 PDF”，也用于无界面批量渲染；
+ * 各函数只访问传入的场景，可以在工作线程中并行调用（每个线程使用各自的 SceneStore）。
+ */
+namespace SceneExporter
+{
+    using ProgressCallback = std::function<void(int)>; ///< 参数为 0-100 的百分比
+
+    /// PDF 页面布局（1 个场景像素对应 1 点）
+    struct PdfOptions {
+        bool tiledPages = false;                        ///< 按页面大小分页平铺；否则整个场景放在一页
+        QPageSize pageSize = QPageSize(QPageSize::A4);  ///< 分页平铺时的页面大小
+    };
+
+    /**
+     * @brief 计算导出范围（所有节点的外接矩形加 20 像素边距）
+     * @param fallback 没有节点时使用的范围
+     */
+    QRectF sceneBounds(const SceneStore& store, const QRectF& fallback);
+
+    /// 按画布的层叠顺序绘制：先连接线，后节点
+    void drawScene(QPainter* painter, const SceneStore& store);
+
+    /**
+     * @brief 导出为 PDF（单页时页面大小与场景范围一致，分页时每页只绘制与其相交的元素）
+     *
+     * 先写入临时文件，成功后才替换目标文件；取消或失败时目标文件保持不变。
+     * @param cancelled 非空时在绘制过程中检查，置位后尽快返回 false
+     * @param progress 进度回调（在调用线程中调用）
+     * @return 是否成功，失败时写入 error
+     */
+    bool exportPdf(const QString& path, const SceneStore& store, const QRectF& fallback,
+                   QString* error = nullptr, const PdfOptions& options = PdfOptions(),
+                   const std::atomic_bool* cancelled = nullptr,
+                   const ProgressCallback& progress = {});
+
+    /**
+     * @brief 导出为 PNG
+     *
+     * 图像按行切分为条带，各条带在线程池中并行绘制，直接写入整幅图像的像素缓冲；
+     * 节点按其像素尺寸选择细节层次，与画布相同。
+     * @param scale 场景单位到像素的缩放倍数（图像过大时自动降低）
+     * @return 是否成功，失败时写入 error
+     */
+    bool exportPng(const QString& path, const SceneStore& store, qreal scale,
+                   const QRectF& fallback, QString* error = nullptr);
+
+    /**
+     * @brief 以 SVG 格式流式写入设备（不构建 DOM，内存占用与场景规模无关）
+     * @return 所有写入是否成功
+     */
+    bool writeSvg(QIODevice* device, const SceneStore& store, const QRectF& fallback);
+
+    /**
+     * @brief 导出为 SVG（写入临时文件，成功后替换目标文件）
+     * @return 是否成功，失败时写入 error
+     */
+    bool exportSvg(const QString& path, const SceneStore& store, const QRectF& fallback,
+                   QString* error = nullptr);
+}
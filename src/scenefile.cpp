@@ -0,0 +1,349 @@
+#include "scenefile.h"
+#include "tracing.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+// === SceneData ===
+void SceneData::reserve(int nodes, int edgeCount)
+{
+    x.reserve(nodes);
+    y.reserve(nodes);
+    width.reserve(nodes);
+    height.reserve(nodes);
+    textOffsets.reserve(nodes + 1);
+    edges.reserve(edgeCount * 2);
+}
+
+void SceneData::addNode(const QRect& rect, QStringView text)
+{
+    x.append(rect.x());
+    y.append(rect.y());
+    width.append(rect.width());
+    height.append(rect.height());
+    textData.append(text);
+    textOffsets.append(quint32(textData.size()));
+}
+
+void SceneData::clear()
+{
+    x.clear();
+    y.clear();
+    width.clear();
+    height.clear();
+    textOffsets = {0};
+    textData.clear();
+    edges.clear();
+}
+
+namespace {
+
+// 二进制文件头（小端序），之后依次为：
+//   x[n] y[n] width[n] height[n]  (int32)
+//   textOffsets[n+1]              (uint32)
+//   edges[2e]                     (uint32)
+//   textData[t]                   (UTF-16LE)
+const char BINARY_MAGIC[8] = {'T', 'M', 'A', 'P', 'B', 'I', 'N', '\0'};
+const qint64 HEADER_SIZE = 24;
+
+struct BinaryHeader {
+    quint32 version;
+    quint32 nodeCount;
+    quint32 edgeCount;
+    quint32 textUnits;
+};
+
+void setError(QString* error, const QString& message)
+{
+    if (error) *error = message;
+}
+
+// 整列写入：小端主机直接写出内存，否则先转换字节序
+template <typename T>
+bool writeColumn(QIODevice& out, const T* data, qsizetype count)
+{
+    const qint64 bytes = qint64(count) * sizeof(T);
+    if (bytes == 0) return true;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    return out.write(reinterpret_cast<const char*>(data), bytes) == bytes;
+#else
+    QByteArray buffer(bytes, Qt::Uninitialized);
+    qToLittleEndian<T>(data, count, buffer.data());
+    return out.write(buffer) == bytes;
+#endif
+}
+
+// 整列读取：从映射内存按列拷贝（小端主机上等价于 memcpy）
+template <typename T>
+const uchar* readColumn(const uchar* src, QVector<T>& column, qsizetype count)
+{
+    column.resize(count);
+    if (count > 0) {
+        qFromLittleEndian<T>(src, count, column.data());
+    }
+    return src + qint64(count) * sizeof(T);
+}
+
+} // namespace
+
+// === 格式分派 ===
+bool SceneFile::isBinary(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    char magic[sizeof(BINARY_MAGIC)];
+    return file.read(magic, sizeof(magic)) == qint64(sizeof(magic))
+           && std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+}
+
+bool SceneFile::load(const QString& path, SceneData* scene, QString* error)
+{
+    TRACE_SCOPE("SceneFile::load");
+    return isBinary(path) ? loadBinary(path, scene, error) : loadText(path, scene, error);
+}
+
+bool SceneFile::save(const SceneData& scene, const QString& path, QString* error)
+{
+    TRACE_SCOPE("SceneFile::save");
+    return path.endsWith(QLatin1String(BINARY_SUFFIX), Qt::CaseInsensitive)
+               ? saveBinary(scene, path, error)
+               : saveText(scene, path, error);
+}
+
+// === 文本格式 ===
+bool SceneFile::loadText(const QString& path, SceneData* scene, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        setError(error, QStringLiteral("无法打开文件"));
+        return false;
+    }
+
+    scene->clear();
+
+    QTextStream in(&file);
+    QVector<int> idToIndex; // 文件中的节点ID -> 场景中的下标（-1 表示不存在）
+    QString currentSection;
+    int lineCount = 0;
+
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        lineCount++;
+
+        if (line.isEmpty()) continue;
+
+        // 检测段标题
+        if (line.startsWith('[') && line.endsWith(']')) {
+            currentSection = line.mid(1, line.length() - 2);
+            continue;
+        }
+
+        if (currentSection == "Nodes") {
+            // 解析节点行: ID,x,y,width,height,text
+            QStringList parts = line.split(',');
+            if (parts.size() < 6) {
+                qWarning() << "无效节点行 #" << lineCount << ":" << line;
+                continue;
+            }
+
+            bool ok;
+            int id = parts[0].toInt(&ok);
+            if (!ok || id < 0) continue;
+
+            int x = parts[1].toInt(&ok);
+            if (!ok) continue;
+
+            int y = parts[2].toInt(&ok);
+            if (!ok) continue;
+
+            int width = parts[3].toInt(&ok);
+            if (!ok) continue;
+
+            int height = parts[4].toInt(&ok);
+            if (!ok) continue;
+
+            // 合并文本部分（可能包含逗号）
+            QString text = parts.mid(5).join(",");
+
+            if (id >= idToIndex.size()) {
+                const int oldSize = idToIndex.size();
+                idToIndex.resize(id + 1);
+                std::fill(idToIndex.begin() + oldSize, idToIndex.end(), -1);
+            }
+            idToIndex[id] = scene->nodeCount();
+            scene->addNode(QRect(x, y, width, height), text);
+        }
+        else if (currentSection == "Connections") {
+            // 解析连接行: startID,endID
+            QStringList parts = line.split(',');
+            if (parts.size() != 2) {
+                qWarning() << "无效连接行 #" << lineCount << ":" << line;
+                continue;
+            }
+
+            bool ok;
+            int startID = parts[0].toInt(&ok);
+            if (!ok || startID < 0) continue;
+
+            int endID = parts[1].toInt(&ok);
+            if (!ok || endID < 0) continue;
+
+            // 检查节点ID是否有效
+            if (startID >= idToIndex.size() || endID >= idToIndex.size() ||
+                idToIndex[startID] < 0 || idToIndex[endID] < 0) {
+                qWarning() << "无效节点ID在连接行 #" << lineCount;
+                continue;
+            }
+
+            scene->addEdge(idToIndex[startID], idToIndex[endID]);
+        }
+    }
+
+    return true;
+}
+
+bool SceneFile::saveText(const SceneData& scene, const QString& path, QString* error)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        setError(error, QStringLiteral("无法保存文件"));
+        return false;
+    }
+
+    QTextStream out(&file);
+
+    // 写入节点信息（ID 即节点下标）
+    out << "[Nodes]\n";
+    for (int i = 0; i < scene.nodeCount(); ++i) {
+        out << i << ',' << scene.x[i] << ',' << scene.y[i] << ','
+            << scene.width[i] << ',' << scene.height[i] << ','
+            << scene.text(i) << '\n';
+    }
+
+    // 写入连接线信息
+    out << "\n[Connections]\n";
+    for (int i = 0; i < scene.edgeCount(); ++i) {
+        out << scene.edges[2 * i] << ',' << scene.edges[2 * i + 1] << '\n';
+    }
+
+    out.flush();
+    if (out.status() != QTextStream::Ok || !file.commit()) {
+        setError(error, QStringLiteral("无法保存文件"));
+        return false;
+    }
+    return true;
+}
+
+// === 二进制格式 ===
+bool SceneFile::loadBinary(const QString& path, SceneData* scene, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(error, QStringLiteral("无法打开文件"));
+        return false;
+    }
+
+    const qint64 fileSize = file.size();
+    const uchar* data = fileSize > 0 ? file.map(0, fileSize) : nullptr;
+    if (!data) {
+        setError(error, QStringLiteral("文件格式无效"));
+        return false;
+    }
+    const bool ok = readBinary(data, fileSize, scene, nullptr, error);
+    file.unmap(const_cast<uchar*>(data));
+    return ok;
+}
+
+bool SceneFile::readBinary(const uchar* data, qint64 size, SceneData* scene, qint64* consumed,
+                           QString* error)
+{
+    if (size < HEADER_SIZE || std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+        setError(error, QStringLiteral("文件格式无效"));
+        return false;
+    }
+
+    BinaryHeader header;
+    qFromLittleEndian<quint32>(data + sizeof(BINARY_MAGIC), 4, &header);
+    if (header.version > BINARY_VERSION) {
+        setError(error, QStringLiteral("不支持的文件版本 %1").arg(header.version));
+        return false;
+    }
+
+    // 根据文件头校验各列总长度，防止越界读取
+    const qint64 n = header.nodeCount, e = header.edgeCount, t = header.textUnits;
+    const qint64 expected = HEADER_SIZE + 4 * 4 * n + 4 * (n + 1) + 4 * 2 * e + 2 * t;
+    if (n > INT_MAX / 2 || e > INT_MAX / 4 || t > INT_MAX || size < expected) {
+        setError(error, QStringLiteral("文件已损坏"));
+        return false;
+    }
+
+    scene->clear();
+    const uchar* p = data + HEADER_SIZE;
+    p = readColumn(p, scene->x, n);
+    p = readColumn(p, scene->y, n);
+    p = readColumn(p, scene->width, n);
+    p = readColumn(p, scene->height, n);
+    p = readColumn(p, scene->textOffsets, n + 1);
+    p = readColumn(p, scene->edges, 2 * e);
+
+    scene->textData.resize(t);
+    if (t > 0) {
+        qFromLittleEndian<quint16>(p, t, scene->textData.data());
+    }
+
+    // 校验字符串表偏移和连接线端点
+    bool valid = scene->textOffsets.first() == 0 && scene->textOffsets.last() == quint32(t);
+    for (qint64 i = 0; valid && i < n; ++i) {
+        valid = scene->textOffsets[i] <= scene->textOffsets[i + 1];
+    }
+    for (qint64 i = 0; valid && i < 2 * e; ++i) {
+        valid = scene->edges[i] < quint32(n);
+    }
+    if (!valid) {
+        scene->clear();
+        setError(error, QStringLiteral("文件已损坏"));
+        return false;
+    }
+    if (consumed) *consumed = expected;
+    return true;
+}
+
+bool SceneFile::saveBinary(const SceneData& scene, const QString& path, QString* error)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        setError(error, QStringLiteral("无法保存文件"));
+        return false;
+    }
+
+    if (!writeBinary(scene, file) || !file.commit()) {
+        setError(error, QStringLiteral("无法保存文件"));
+        return false;
+    }
+    return true;
+}
+
+bool SceneFile::writeBinary(const SceneData& scene, QIODevice& device)
+{
+    const int n = scene.nodeCount();
+    const BinaryHeader header{BINARY_VERSION, quint32(n), quint32(scene.edgeCount()),
+                              quint32(scene.textData.size())};
+    uchar headerBytes[HEADER_SIZE];
+    std::memcpy(headerBytes, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    qToLittleEndian<quint32>(&header, 4, headerBytes + sizeof(BINARY_MAGIC));
+
+    return device.write(reinterpret_cast<const char*>(headerBytes), HEADER_SIZE) == HEADER_SIZE
+           && writeColumn(device, scene.x.constData(), n)
+           && writeColumn(device, scene.y.constData(), n)
+           && writeColumn(device, scene.width.constData(), n)
+           && writeColumn(device, scene.height.constData(), n)
+           && writeColumn(device, scene.textOffsets.constData(), n + 1)
+           && writeColumn(device, scene.edges.constData(), scene.edges.size())
+           && writeColumn(device, reinterpret_cast<const quint16*>(scene.textData.constData()),
+                          scene.textData.size());
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QRect>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+class QIODevice;
+
+/**
+ * @brief 场景的列式数据表示（用于文件读写和整体构建画布）
+ *
+ * 节点按 ID 顺序存放，几何属性按列存储；所有文本首尾相接存放在一个
+ * 字符串表中，通过偏移量访问；连接线以 (起点ID, 终点ID) 成对存放。
+ */
+struct SceneData
+{
+    QVector<qint32> x, y, width, height; ///< 节点几何（列式存储）
+    QVector<quint32> textOffsets{0};     ///< 第 i 个文本位于 [textOffsets[i], textOffsets[i+1])
+    QString textData;                    ///< 字符串表
+    QVector<quint32> edges;              ///< 连接线端点 ID，每两个一组
+
+    int nodeCount() const { return x.size(); }
+    int edgeCount() const { return edges.size() / 2; }
+
+    QRect rect(int i) const { return QRect(x[i], y[i], width[i], height[i]); }
+    QStringView text(int i) const
+    {
+        return QStringView(textData).mid(textOffsets[i], textOffsets[i + 1] - textOffsets[i]);
+    }
+
+    void reserve(int nodes, int edgeCount);
+    void addNode(const QRect& rect, QStringView text);
+    void addEdge(int from, int to) { edges.append(from); edges.append(to); }
+    void clear();
+};
+
+/**
+ * @brief 场景文件读写
+ *
+ * 支持两种格式：
+ * - 文本格式（.txt）：[Nodes]/[Connections] 两段，每行一条记录
+ * - 二进制格式（.tmap）：带版本号的文件头 + 列式节点几何 + 字符串表
+ *   + 紧凑连接线数组，读取时通过 QFile::map 映射后按列整体拷贝，
+ *   不对单条记录分配内存
+ *
+ * 读取时根据文件头的魔数识别格式，写入时根据后缀选择格式。
+ */
+namespace SceneFile
+{
+    constexpr char BINARY_SUFFIX[] = ".tmap";    ///< 二进制格式后缀
+    constexpr quint32 BINARY_VERSION = 1;        ///< 当前二进制格式版本
+
+    bool load(const QString& path, SceneData* scene, QString* error = nullptr);
+    bool save(const SceneData& scene, const QString& path, QString* error = nullptr);
+
+    bool isBinary(const QString& path); ///< 检查文件头魔数
+
+    bool loadText(const QString& path, SceneData* scene, QString* error = nullptr);
+    bool saveText(const SceneData& scene, const QString& path, QString* error = nullptr);
+    bool loadBinary(const QString& path, SceneData* scene, QString* error = nullptr);
+    bool saveBinary(const SceneData& scene, const QString& path, QString* error = nullptr);
+
+    /// 二进制格式写入任意设备（供自动保存日志嵌入完整场景）
+    bool writeBinary(const SceneData& scene, QIODevice& device);
+    /**
+     * @brief 从内存解析二进制格式
+     * @param size 可用字节数；成功时 consumed 返回实际占用的字节数
+     */
+    bool readBinary(const uchar* data, qint64 size, SceneData* scene, qint64* consumed = nullptr,
+                    QString* error = nullptr);
+}
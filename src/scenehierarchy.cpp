@@ -0,0 +1,235 @@
+#include "scenehierarchy.h"
+#include "tracing.h"
+#include <QPainter>
+
+bool SceneHierarchy::build(const QVector<NodeId>& nodes, const QVector<int>& parents,
+                           const QVector<double>& weights, const SceneStore& store)
+{
+    TRACE_SCOPE("SceneHierarchy::build");
+    clear();
+    const int count = nodes.size();
+    if (parents.size() != count) return false;
+
+    // 子节点表（CSR，保持输入顺序即绘制顺序）
+    QVector<int> childStart(count + 1, 0);
+    QVector<int> roots;
+    for (int i = 0; i < count; ++i) {
+        const int p = parents[i];
+        if (p < -1 || p >= count || p == i) return false;
+        if (p < 0) roots.append(i);
+        else childStart[p + 1]++;
+    }
+    for (int i = 0; i < count; ++i) childStart[i + 1] += childStart[i];
+    QVector<int> children(childStart[count]);
+    QVector<int> fill = childStart;
+    for (int i = 0; i < count; ++i) {
+        if (parents[i] >= 0) children[fill[parents[i]]++] = i;
+    }
+
+    // 从根出发的先序遍历；无法到达的节点说明存在环
+    QVector<int> order;
+    order.reserve(count);
+    QVector<int> stack = roots;
+    while (!stack.isEmpty()) {
+        const int entry = stack.takeLast();
+        order.append(entry);
+        for (int c = childStart[entry]; c < childStart[entry + 1]; ++c) stack.append(children[c]);
+    }
+    if (order.size() != count) return false;
+
+    m_nodes = nodes;
+    m_parent = parents;
+    m_childStart = childStart;
+    m_children = children;
+    m_roots = roots;
+    m_weight.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const double weight = i < weights.size() ? weights[i] : 0.0;
+        m_weight.append(qIsFinite(weight) ? qMax(0.0, weight) : 0.0);
+    }
+    m_bounds.resize(count);
+    m_leafCount.fill(0, count);
+    m_total.fill(0, count);
+    m_dominant.fill(-1, count);
+
+    NodeId maxNode = 0;
+    for (NodeId node : nodes) maxNode = qMax(maxNode, node);
+    m_entryOf.fill(-1, count > 0 ? int(maxNode) + 1 : 0);
+    for (int i = 0; i < count; ++i) m_entryOf[nodes[i]] = i;
+
+    // 逆先序中子节点总在父节点之前，一遍即可汇总
+    for (int k = count - 1; k >= 0; --k) summarize(order[k], store);
+    return true;
+}
+
+void SceneHierarchy::clear()
+{
+    *this = SceneHierarchy();
+}
+
+QString SceneHierarchy::summary(NodeId node, const SceneStore& store) const
+{
+    const int entry = m_entryOf[node];
+    QString text = store.text(node).toString();
+    text += QStringLiteral("（%1 项").arg(m_leafCount[entry]);
+    if (m_dominant[entry] >= 0) {
+        text += QStringLiteral("，最大：%1").arg(store.text(m_nodes[m_dominant[entry]]).toString());
+    }
+    text += QStringLiteral("）");
+    return text;
+}
+
+bool SceneHierarchy::summarize(int entry, const SceneStore& store)
+{
+    const NodeId node = m_nodes.at(entry);
+    const bool alive = store.isAlive(node);
+    QRect bounds = alive ? store.rect(node) : QRect();
+    int leaves = 0;
+    double total = 0;
+    int dominant = -1;
+    if (isLeaf(entry)) {
+        if (alive) {
+            leaves = 1;
+            total = m_weight.at(entry);
+            dominant = entry;
+        }
+    } else {
+        for (int c = m_childStart.at(entry); c < m_childStart.at(entry + 1); ++c) {
+            const int child = m_children.at(c);
+            bounds |= m_bounds.at(child);
+            leaves += m_leafCount.at(child);
+            total += m_total.at(child);
+            const int d = m_dominant.at(child);
+            if (d >= 0 && (dominant < 0 || m_weight.at(d) > m_weight.at(dominant))) dominant = d;
+        }
+    }
+
+    // 只写入变化的值，快照共享的块不被无谓复制
+    if (bounds != m_bounds.at(entry)) m_bounds[entry] = bounds;
+    const bool changed = leaves != m_leafCount.at(entry) || total != m_total.at(entry)
+                         || dominant != m_dominant.at(entry);
+    if (changed) {
+        m_leafCount[entry] = leaves;
+        m_total[entry] = total;
+        m_dominant[entry] = dominant;
+    }
+    return changed;
+}
+
+QRect SceneHierarchy::propagate(int entry, const SceneStore& store, bool changed)
+{
+    // 沿祖先路径重新汇总；汇总信息变化的祖先需要重新排版并重绘
+    QRect dirty;
+    for (int e = entry; e >= 0; e = m_parent.at(e)) {
+        if (summarize(e, store)) changed = true;
+        if (changed && !isLeaf(e)) {
+            m_summaryLayouts.remove(e);
+            if (store.isAlive(m_nodes.at(e))) dirty |= store.rect(m_nodes.at(e));
+        }
+    }
+    return dirty;
+}
+
+QRect SceneHierarchy::refresh(NodeId node, const SceneStore& store, bool textChanged)
+{
+    if (!contains(node)) return QRect();
+    const int entry = m_entryOf.at(node);
+    m_summaryLayouts.remove(entry); // 尺寸或文本可能已变化
+
+    QRect dirty = propagate(entry, store, false);
+
+    // 文本变化还会影响以该节点为最大叶节点的祖先
+    if (textChanged) {
+        for (int e = m_parent.at(entry); e >= 0; e = m_parent.at(e)) {
+            if (m_dominant.at(e) != entry) break;
+            m_summaryLayouts.remove(e);
+            if (store.isAlive(m_nodes.at(e))) dirty |= store.rect(m_nodes.at(e));
+        }
+    }
+    return dirty;
+}
+
+QRect SceneHierarchy::setWeight(NodeId node, double weight, const SceneStore& store)
+{
+    if (!contains(node)) return QRect();
+    const int entry = m_entryOf.at(node);
+    if (!isLeaf(entry) || !qIsFinite(weight)) return QRect();
+    m_weight[entry] = qMax(0.0, weight);
+    return propagate(entry, store, false);
+}
+
+QVector<double> SceneHierarchy::weights() const
+{
+    QVector<double> result;
+    result.reserve(m_weight.size());
+    for (int i = 0; i < m_weight.size(); ++i) result.append(m_weight.at(i));
+    return result;
+}
+
+bool SceneHierarchy::isCollapsed(int entry, qreal scale, int collapsePixels) const
+{
+    if (isLeaf(entry)) return false;
+    const QRect& bounds = m_bounds[entry];
+    return qMax(bounds.width(), bounds.height()) * scale < collapsePixels;
+}
+
+NodeId SceneHierarchy::topAt(const QPoint& pos, qreal scale, int collapsePixels,
+                             const SceneStore& store) const
+{
+    // 后绘制的根节点在上层，逆序查找
+    for (int i = m_roots.size() - 1; i >= 0; --i) {
+        const NodeId hit = hitTest(m_roots[i], pos, scale, collapsePixels, store);
+        if (hit != INVALID_ID) return hit;
+    }
+    return INVALID_ID;
+}
+
+NodeId SceneHierarchy::hitTest(int entry, const QPoint& pos, qreal scale, int collapsePixels,
+                               const SceneStore& store) const
+{
+    if (!m_bounds[entry].contains(pos)) return INVALID_ID;
+
+    const NodeId node = m_nodes[entry];
+    const bool alive = store.isAlive(node);
+    if (alive && isCollapsed(entry, scale, collapsePixels)) {
+        return store.rect(node).contains(pos) ? node : INVALID_ID;
+    }
+
+    // 子节点绘制在父节点之上，后绘制的兄弟节点在上层
+    for (int c = m_childStart[entry + 1] - 1; c >= m_childStart[entry]; --c) {
+        const NodeId hit = hitTest(m_children[c], pos, scale, collapsePixels, store);
+        if (hit != INVALID_ID) return hit;
+    }
+    return alive && store.rect(node).contains(pos) ? node : INVALID_ID;
+}
+
+void SceneHierarchy::drawAggregate(QPainter* painter, NodeId node, const SceneStore& store,
+                                   TreeNode::DetailLevel detail) const
+{
+    // 只有完整细节才显示汇总文本；文本只在排版缓存失效时生成
+    TreeNode::TextLayout* layout = nullptr;
+    QString text;
+    if (detail == TreeNode::FullDetail) {
+        layout = &m_summaryLayouts[m_entryOf[node]];
+        if (!layout->valid || layout->baseFont != painter->font()) text = summary(node, store);
+    }
+    TreeNode::drawAggregate(painter, store.rect(node), text, layout, detail);
+}
+
+qsizetype SceneHierarchy::memoryUsage() const
+{
+    return m_nodes.capacity() * qsizetype(sizeof(NodeId))
+           + (m_parent.capacity() + m_childStart.capacity() + m_children.capacity()
+              + m_roots.capacity() + m_leafCount.capacity() + m_dominant.capacity()
+              + m_entryOf.capacity()) * qsizetype(sizeof(int))
+           + (m_weight.capacity() + m_total.capacity()) * qsizetype(sizeof(double))
+           + m_bounds.capacity() * qsizetype(sizeof(QRect));
+}
+
+SceneHierarchy SceneHierarchy::snapshot() const
+{
+    // 与 SceneStore::snapshot 相同：各列（按块）隐式共享，排版缓存不跨线程共享
+    SceneHierarchy copy(*this);
+    copy.m_summaryLayouts.clear();
+    return copy;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <QHash>
+#include <QPoint>
+#include <QRect>
+#include <QString>
+#include <QVector>
+#include "sceneids.h"
+#include "chunkedcolumn.h"
+#include "scenestore.h"
+#include "treenode.h"
+
+class QPainter;
+
+/**
+ * @brief 节点的层次结构与层次细节聚合
+ *
+ * 记录自动布局生成的节点之间的父子关系，并为每棵子树预先计算汇总信息：
+ * 外接矩形、存活叶节点数、叶节点总权重和权重最大的叶节点。
+ *
+ * 子树在屏幕上小于阈值时整体绘制为一个聚合矩形（显示汇总信息），
+ * 不再访问其子节点；放大后再逐层展开。绘制和命中检测都从根节点向下
+ * 遍历并按子树外接矩形裁剪，访问的节点数取决于屏幕上可见的像素，
+ * 与叶节点总数无关。
+ *
+ * 层次结构中的节点不放入 SpatialIndex，由画布单独查询，并绘制在其他
+ * 节点之下。被删除的节点保留在结构中作为容器，其子节点照常绘制。
+ *
+ * 结构本身建立后不变，随编辑变化的汇总列分块存放，快照只复制被修改的块。
+ */
+class SceneHierarchy
+{
+public:
+    SceneHierarchy() = default;
+
+    /**
+     * @brief 建立层次结构并计算所有子树的汇总信息
+     * @param nodes 层次结构各节点对应的画布节点
+     * @param parents 父节点下标（-1 表示根节点）
+     * @param weights 叶节点权重（负数和非有限值按 0 处理，内部节点的权重被忽略）
+     * @return 父节点越界或存在环时返回 false（结构保持为空）
+     */
+    bool build(const QVector<NodeId>& nodes, const QVector<int>& parents,
+               const QVector<double>& weights, const SceneStore& store);
+    void clear();
+
+    bool isEmpty() const { return m_nodes.isEmpty(); }
+    bool contains(NodeId node) const { return node < quint32(m_entryOf.size()) && m_entryOf[node] >= 0; }
+    const QVector<NodeId>& nodes() const { return m_nodes; } ///< 按层次结构下标排列
+    const QVector<int>& parents() const { return m_parent; } ///< 父节点下标（build 的输入）
+    QVector<double> weights() const; ///< 叶节点当前权重（按层次结构下标排列，可再次用于 build）
+
+    int leafCount(NodeId node) const { return m_leafCount[m_entryOf[node]]; } ///< 子树中存活的叶节点数
+    double totalWeight(NodeId node) const { return m_total[m_entryOf[node]]; } ///< 子树中存活叶节点的权重之和
+    QString summary(NodeId node, const SceneStore& store) const; ///< 聚合矩形显示的汇总文本
+
+    /**
+     * @brief 节点增删、移动或文本修改后更新其所在路径上的外接矩形和汇总信息
+     * @param textChanged 节点文本是否变化（会影响以它为最大叶节点的祖先）
+     * @return 汇总信息变化的祖先节点区域（需要重绘；只有几何变化时为空）
+     */
+    QRect refresh(NodeId node, const SceneStore& store, bool textChanged = false);
+
+    /**
+     * @brief 修改叶节点权重（更新祖先的总权重和最大叶节点）
+     * @return 汇总信息变化的祖先节点区域
+     */
+    QRect setWeight(NodeId node, double weight, const SceneStore& store);
+
+    /**
+     * @brief 按绘制顺序（父节点在前）遍历与区域相交的可见节点
+     *
+     * func(NodeId node, bool collapsed)：collapsed 为 true 时该节点代表整棵子树，
+     * 其子节点不会被访问。子树外接矩形的较长边在屏幕上小于 collapsePixels 时聚合。
+     */
+    template <typename Func>
+    void forEachVisible(const QRect& sceneRect, qreal scale, int collapsePixels,
+                        const SceneStore& store, Func func) const;
+
+    /// 节点在当前缩放下是否绘制为聚合矩形（代表整棵子树）
+    bool isAggregated(NodeId node, qreal scale, int collapsePixels) const
+    {
+        return contains(node) && isCollapsed(m_entryOf[node], scale, collapsePixels);
+    }
+
+    /// 包含指定点的最上层可见节点（聚合的子树返回其根节点），没有时返回 INVALID_ID
+    NodeId topAt(const QPoint& pos, qreal scale, int collapsePixels, const SceneStore& store) const;
+
+    /// 绘制聚合矩形（完整细节时显示汇总文本，并使用和维护其排版缓存）
+    void drawAggregate(QPainter* painter, NodeId node, const SceneStore& store,
+                       TreeNode::DetailLevel detail) const;
+
+    qsizetype memoryUsage() const; ///< 占用的内存（字节，估算值）
+
+    /// 共享数据的副本（不含排版缓存），供工作线程只读绘制
+    SceneHierarchy snapshot() const;
+
+private:
+    bool isLeaf(int entry) const { return m_childStart[entry] == m_childStart[entry + 1]; }
+    bool isCollapsed(int entry, qreal scale, int collapsePixels) const;
+    bool summarize(int entry, const SceneStore& store); ///< 由子节点重新汇总，返回汇总信息是否变化
+    QRect propagate(int entry, const SceneStore& store, bool changed); ///< 自下而上汇总到根
+    NodeId hitTest(int entry, const QPoint& pos, qreal scale, int collapsePixels,
+                   const SceneStore& store) const;
+
+    // 按层次结构下标存放
+    QVector<NodeId> m_nodes;      ///< 对应的画布节点
+    QVector<int> m_parent;        ///< 父节点下标（-1 表示根）
+    QVector<int> m_childStart;    ///< CSR：节点 i 的子节点为 m_children[m_childStart[i] .. m_childStart[i+1])
+    QVector<int> m_children;
+    QVector<int> m_roots;
+    ChunkedColumn<double> m_weight;   ///< 叶节点自身的权重
+    ChunkedColumn<QRect> m_bounds;    ///< 子树中存活节点的外接矩形
+    ChunkedColumn<int> m_leafCount;   ///< 子树中存活的叶节点数
+    ChunkedColumn<double> m_total;    ///< 子树中存活叶节点的权重之和
+    ChunkedColumn<int> m_dominant;    ///< 子树中权重最大的存活叶节点（-1 表示没有）
+    QVector<int> m_entryOf;       ///< 画布节点 -> 层次结构下标（-1 表示不在结构中）
+
+    mutable QHash<int, TreeNode::TextLayout> m_summaryLayouts; ///< 汇总文本的排版缓存（惰性生成）
+};
+
+template <typename Func>
+void SceneHierarchy::forEachVisible(const QRect& sceneRect, qreal scale, int collapsePixels,
+                                    const SceneStore& store, Func func) const
+{
+    // 显式栈深度优先遍历：子节点逆序入栈，出栈顺序即绘制顺序
+    thread_local QVector<int> stack; // 每个线程复用容量
+    stack.clear();
+    for (int i = m_roots.size() - 1; i >= 0; --i) stack.append(m_roots[i]);
+    while (!stack.isEmpty()) {
+        const int entry = stack.takeLast();
+        if (!m_bounds[entry].intersects(sceneRect)) continue; // 整棵子树不可见
+
+        const NodeId node = m_nodes[entry];
+        const bool alive = store.isAlive(node);
+        const bool collapsed = alive && isCollapsed(entry, scale, collapsePixels);
+        if (alive && store.rect(node).intersects(sceneRect)) func(node, collapsed);
+        if (collapsed) continue;
+        for (int c = m_childStart[entry + 1] - 1; c >= m_childStart[entry]; --c) {
+            stack.append(m_children[c]);
+        }
+    }
+}
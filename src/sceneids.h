@@ -0,0 +1,7 @@
+#pragma once
+
+#include <QtGlobal>
+
+using NodeId = quint32; ///< 节点句柄（SceneStore 中的槽位下标，在节点被删除或场景清空前保持不变）
+using EdgeId = quint32; ///< 连接线句柄
+constexpr quint32 INVALID_ID = 0xFFFFFFFFu; ///< 无效句柄
@@ -0,0 +1,635 @@
+#include "scenejournal.h"
+#include "scenefile.h"
+#include "scenehierarchy.h"
+#include "scenestore.h"
+#include "tracing.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+// 日志文件头：魔数、版本、文档路径（UTF-16LE），之后为二进制场景格式的基准和修改记录
+const char JOURNAL_MAGIC[8] = {'T', 'M', 'A', 'P', 'J', 'R', 'N', '\0'};
+const quint32 JOURNAL_VERSION = 2; // 2：增加层次结构记录
+const char JOURNAL_SUFFIX[] = ".journal";
+
+// 修改记录：类型（1 字节）+ 负载长度（4 字节）+ 负载（小端序）
+enum RecordType : quint8 {
+    NodeAdded = 1,  // 节点句柄、x、y、宽、高、文本
+    NodeRemoved,    // 节点句柄
+    NodeRevived,    // 同 NodeAdded
+    NodeDiscarded,  // 无负载（移除最后一个槽位）
+    EdgeAdded,      // 连接线句柄、起点、终点
+    EdgeRemoved,    // 连接线句柄
+    EdgeRevived,    // 同 EdgeAdded
+    EdgeDiscarded,  // 无负载
+    Geometry,       // 节点句柄、x、y、宽、高
+    Text,           // 节点句柄、文本
+    HierarchyBase,  // 条目数，每个条目：节点句柄、父节点下标、权重（只出现在基准中）
+    Weight          // 节点句柄、权重
+};
+const int RECORD_HEADER_BYTES = 5;
+
+void setError(QString* error, const QString& message)
+{
+    if (error) *error = message;
+}
+
+QString sessionMarkerPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+           + QStringLiteral("/autosave.session");
+}
+
+// === 编码 ===
+void putU32(QByteArray& out, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    out.append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+void putF64(QByteArray& out, double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uchar bytes[8];
+    qToLittleEndian(bits, bytes);
+    out.append(reinterpret_cast<const char*>(bytes), 8);
+}
+
+void putRect(QByteArray& out, const QRect& rect)
+{
+    putU32(out, quint32(rect.x()));
+    putU32(out, quint32(rect.y()));
+    putU32(out, quint32(rect.width()));
+    putU32(out, quint32(rect.height()));
+}
+
+void putText(QByteArray& out, QStringView text)
+{
+    putU32(out, quint32(text.size()));
+    const qsizetype at = out.size();
+    out.resize(at + text.size() * 2);
+    if (!text.isEmpty()) {
+        qToLittleEndian<quint16>(text.utf16(), text.size(), out.data() + at);
+    }
+}
+
+// === 解码（越界时 ok 置为 false，之后的读取都返回 0）===
+struct Reader
+{
+    const uchar* p;
+    const uchar* end;
+    bool ok = true;
+
+    bool has(qint64 bytes) { ok = ok && end - p >= bytes; return ok; }
+    quint32 u32()
+    {
+        if (!has(4)) return 0;
+        const quint32 value = qFromLittleEndian<quint32>(p);
+        p += 4;
+        return value;
+    }
+    double f64()
+    {
+        if (!has(8)) return 0;
+        const quint64 bits = qFromLittleEndian<quint64>(p);
+        p += 8;
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    QRect rect()
+    {
+        const qint32 x = qint32(u32()), y = qint32(u32());
+        const qint32 w = qint32(u32()), h = qint32(u32());
+        return QRect(x, y, w, h);
+    }
+    QString text()
+    {
+        const quint32 length = u32();
+        if (!has(qint64(length) * 2)) return QString();
+        QString result(int(length), Qt::Uninitialized);
+        qFromLittleEndian<quint16>(p, length, result.data());
+        p += qint64(length) * 2;
+        return result;
+    }
+};
+
+// 基准：保留槽位布局的完整场景（已删除的槽位写入占位数据，随后由删除记录标记）
+struct Snapshot
+{
+    SceneData scene;
+    QByteArray removals;  ///< 已删除槽位对应的删除记录
+    QByteArray hierarchy; ///< 层次结构记录（没有层次结构时为空）
+};
+
+Snapshot takeSnapshot(const SceneStore& store, const SceneHierarchy& hierarchy)
+{
+    Snapshot snapshot;
+    snapshot.scene.reserve(store.nodeSlots(), store.edgeSlots());
+    for (NodeId node = 0; node < NodeId(store.nodeSlots()); ++node) {
+        if (store.isAlive(node)) {
+            snapshot.scene.addNode(store.rect(node), store.text(node));
+        } else {
+            snapshot.scene.addNode(QRect(), QStringView());
+        }
+    }
+
+    // 连接线槽位只会在节点槽位之后创建，存在连接线槽位时一定有节点 0 可作占位端点
+    QByteArray deadNodes;
+    for (EdgeId edge = 0; edge < EdgeId(store.edgeSlots()); ++edge) {
+        if (store.isEdgeAlive(edge)) {
+            snapshot.scene.addEdge(store.edgeFrom(edge), store.edgeTo(edge));
+        } else {
+            snapshot.scene.addEdge(0, 0);
+            snapshot.removals.append(char(EdgeRemoved));
+            putU32(snapshot.removals, 4);
+            putU32(snapshot.removals, edge);
+        }
+    }
+    for (NodeId node = 0; node < NodeId(store.nodeSlots()); ++node) {
+        if (!store.isAlive(node)) {
+            deadNodes.append(char(NodeRemoved));
+            putU32(deadNodes, 4);
+            putU32(deadNodes, node);
+        }
+    }
+    snapshot.removals += deadNodes; // 先删除占位连接线，再删除节点
+
+    // 层次结构只保存建立参数，恢复时重新 build
+    const QVector<NodeId>& nodes = hierarchy.nodes();
+    if (!nodes.isEmpty()) {
+        const QVector<int>& parents = hierarchy.parents();
+        const QVector<double> weights = hierarchy.weights();
+        snapshot.hierarchy.reserve(RECORD_HEADER_BYTES + 4 + nodes.size() * 16);
+        snapshot.hierarchy.append(char(HierarchyBase));
+        putU32(snapshot.hierarchy, 4 + quint32(nodes.size()) * 16);
+        putU32(snapshot.hierarchy, quint32(nodes.size()));
+        for (int i = 0; i < nodes.size(); ++i) {
+            putU32(snapshot.hierarchy, nodes[i]);
+            putU32(snapshot.hierarchy, quint32(parents[i]));
+            putF64(snapshot.hierarchy, weights[i]);
+        }
+    }
+    return snapshot;
+}
+
+// 重放过程中的层次结构（节点为槽位句柄）
+struct HierarchyState
+{
+    SceneJournal::Hierarchy input;
+    QHash<NodeId, int> entryOf;
+};
+
+// 恢复出的场景只含存活节点（按槽位顺序重新编号）：层次结构的节点换成新 ID，
+// 已删除的容器节点（本来就不绘制）去掉，其子节点挂到最近的存活祖先
+SceneJournal::Hierarchy remapHierarchy(const SceneJournal::Hierarchy& in, const SceneStore& store)
+{
+    QVector<quint32> fileIds(store.nodeSlots(), INVALID_ID);
+    quint32 next = 0;
+    for (NodeId node = 0; node < NodeId(store.nodeSlots()); ++node) {
+        if (store.isAlive(node)) fileIds[node] = next++;
+    }
+
+    const int count = in.nodes.size();
+    QVector<int> entries(count, -1); // 原下标 -> 新下标（-1 表示已去掉）
+    SceneJournal::Hierarchy out;
+    for (int i = 0; i < count; ++i) {
+        const NodeId node = in.nodes[i];
+        if (node >= NodeId(store.nodeSlots()) || fileIds[node] == INVALID_ID) continue;
+        entries[i] = out.nodes.size();
+        out.nodes.append(fileIds[node]);
+        out.weights.append(in.weights[i]);
+    }
+    for (int i = 0; i < count; ++i) {
+        if (entries[i] < 0) continue;
+        int parent = in.parents[i];
+        for (int steps = 0; parent >= 0 && entries[parent] < 0; ++steps) {
+            if (steps == count) return SceneJournal::Hierarchy(); // 存在环
+            parent = in.parents[parent];
+        }
+        out.parents.append(parent < 0 ? -1 : entries[parent]);
+    }
+    return out;
+}
+
+// 重放一条修改记录；记录与场景状态不符时返回 false
+bool applyRecord(SceneStore& store, HierarchyState& hierarchy, quint8 type, Reader& in)
+{
+    const auto nodeAlive = [&store](NodeId node) { return store.isAlive(node); };
+    const auto edgeInRange = [&store](EdgeId edge) { return edge < EdgeId(store.edgeSlots()); };
+
+    switch (type) {
+    case NodeAdded:
+    case NodeRevived: {
+        const NodeId node = in.u32();
+        const QRect rect = in.rect();
+        const QString text = in.text();
+        if (!in.ok) return false;
+        if (type == NodeAdded) {
+            if (node != NodeId(store.nodeSlots())) return false;
+            store.addNode(rect, text);
+        } else {
+            if (node >= NodeId(store.nodeSlots()) || nodeAlive(node)) return false;
+            store.reviveNode(node, rect, text);
+        }
+        return true;
+    }
+    case NodeRemoved: {
+        const NodeId node = in.u32();
+        if (!in.ok || !nodeAlive(node) || !store.edgesOf(node).isEmpty()) return false;
+        store.removeNode(node);
+        return true;
+    }
+    case NodeDiscarded: {
+        const NodeId last = NodeId(store.nodeSlots() - 1);
+        if (store.nodeSlots() == 0 || !store.edgesOf(last).isEmpty()) return false;
+        store.discardLastNode();
+        return true;
+    }
+    case EdgeAdded:
+    case EdgeRevived: {
+        const EdgeId edge = in.u32();
+        const NodeId from = in.u32(), to = in.u32();
+        if (!in.ok || !nodeAlive(from) || !nodeAlive(to)) return false;
+        if (type == EdgeAdded) {
+            if (edge != EdgeId(store.edgeSlots())) return false;
+            store.addEdge(from, to);
+        } else {
+            if (!edgeInRange(edge) || store.isEdgeAlive(edge)) return false;
+            store.reviveEdge(edge, from, to);
+        }
+        return true;
+    }
+    case EdgeRemoved: {
+        const EdgeId edge = in.u32();
+        if (!in.ok || !edgeInRange(edge) || !store.isEdgeAlive(edge)) return false;
+        store.removeEdge(edge);
+        return true;
+    }
+    case EdgeDiscarded:
+        if (store.edgeSlots() == 0) return false;
+        store.discardLastEdge();
+        return true;
+    case Geometry: {
+        const NodeId node = in.u32();
+        const QRect rect = in.rect();
+        if (!in.ok || !nodeAlive(node)) return false;
+        store.setRect(node, rect);
+        store.updateEdgeLines(node);
+        return true;
+    }
+    case Text: {
+        const NodeId node = in.u32();
+        const QString text = in.text();
+        if (!in.ok || !nodeAlive(node)) return false;
+        store.setText(node, text);
+        return true;
+    }
+    case HierarchyBase: {
+        const quint32 count = in.u32();
+        if (!in.has(qint64(count) * 16)) return false;
+        HierarchyState state;
+        state.input.nodes.reserve(int(count));
+        state.input.parents.reserve(int(count));
+        state.input.weights.reserve(int(count));
+        state.entryOf.reserve(int(count));
+        for (quint32 i = 0; i < count; ++i) {
+            const NodeId node = in.u32();
+            const qint32 parent = qint32(in.u32());
+            const double weight = in.f64();
+            if (node >= NodeId(store.nodeSlots()) || parent < -1 || parent >= qint32(count)) return false;
+            state.input.nodes.append(node);
+            state.input.parents.append(parent);
+            state.input.weights.append(weight);
+            state.entryOf.insert(node, int(i));
+        }
+        hierarchy = std::move(state);
+        return true;
+    }
+    case Weight: {
+        const NodeId node = in.u32();
+        const double weight = in.f64();
+        const auto it = hierarchy.entryOf.constFind(node);
+        if (!in.ok || it == hierarchy.entryOf.constEnd()) return false;
+        hierarchy.input.weights[*it] = weight;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+SceneJournal::SceneJournal(QObject* parent)
+    : QObject(parent)
+{
+    m_writer.setMaxThreadCount(1);
+    m_timer.setInterval(DEFAULT_FLUSH_INTERVAL);
+    connect(&m_timer, &QTimer::timeout, this, &SceneJournal::flush);
+}
+
+SceneJournal::~SceneJournal()
+{
+    // 正常退出：日志已无用
+    m_timer.stop();
+    m_writer.waitForDone();
+    if (isActive()) discard(m_path);
+}
+
+QString SceneJournal::journalPathFor(const QString& documentPath)
+{
+    if (documentPath.isEmpty()) {
+        return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
+               + QStringLiteral("/untitled") + QLatin1String(JOURNAL_SUFFIX);
+    }
+    return documentPath + QLatin1String(JOURNAL_SUFFIX);
+}
+
+QString SceneJournal::pendingRecovery()
+{
+    QFile marker(sessionMarkerPath());
+    if (!marker.open(QIODevice::ReadOnly)) return QString();
+    const QString path = QString::fromUtf8(marker.readAll()).trimmed();
+    return QFileInfo::exists(path) ? path : QString();
+}
+
+void SceneJournal::discard(const QString& journalPath)
+{
+    QFile::remove(journalPath);
+    QFile::remove(sessionMarkerPath());
+}
+
+bool SceneJournal::recover(const QString& journalPath, SceneData* scene, QString* documentPath,
+                           QString* error, Hierarchy* hierarchy)
+{
+    TRACE_SCOPE("SceneJournal::recover");
+    QFile file(journalPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(error, QStringLiteral("无法打开自动保存文件 %1").arg(journalPath));
+        return false;
+    }
+    const qint64 size = file.size();
+    const uchar* data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data || size < qint64(sizeof(JOURNAL_MAGIC)) + 8
+        || std::memcmp(data, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0) {
+        setError(error, QStringLiteral("自动保存文件格式无效"));
+        return false;
+    }
+
+    Reader in{data + sizeof(JOURNAL_MAGIC), data + size};
+    const quint32 version = in.u32();
+    const QString document = in.text();
+    if (!in.ok || version > JOURNAL_VERSION) {
+        setError(error, QStringLiteral("自动保存文件格式无效"));
+        return false;
+    }
+
+    // 基准
+    SceneData base;
+    qint64 consumed = 0;
+    if (!SceneFile::readBinary(in.p, in.end - in.p, &base, &consumed, error)) {
+        return false;
+    }
+    in.p += consumed;
+    SceneStore store;
+    store.append(base);
+    base.clear();
+
+    // 逐条重放，遇到不完整或与场景不符的记录即停止（异常退出时最后一条可能只写了一半）
+    HierarchyState state;
+    while (in.has(RECORD_HEADER_BYTES)) {
+        const quint8 type = *in.p++;
+        const quint32 length = in.u32();
+        if (!in.has(length)) break;
+        Reader record{in.p, in.p + length};
+        if (!applyRecord(store, state, type, record)) break;
+        in.p += length;
+    }
+
+    *scene = store.toSceneData();
+    if (documentPath) *documentPath = document;
+    if (hierarchy) *hierarchy = remapHierarchy(state.input, store);
+    return true;
+}
+
+void SceneJournal::start(const QString& documentPath, const SceneStore* store,
+                         const SceneHierarchy* hierarchy)
+{
+    m_store = store;
+    m_hierarchy = hierarchy;
+    m_documentPath = documentPath;
+    m_path = journalPathFor(documentPath);
+    QDir().mkpath(QFileInfo(sessionMarkerPath()).absolutePath());
+
+    // 会话标记指向当前日志，异常退出后据此恢复
+    QSaveFile marker(sessionMarkerPath());
+    if (marker.open(QIODevice::WriteOnly)) {
+        marker.write(m_path.toUtf8());
+        marker.commit();
+    }
+
+    compact();
+    m_timer.start();
+}
+
+void SceneJournal::setDocumentPath(const QString& documentPath)
+{
+    if (!isActive() || documentPath == m_documentPath) return;
+
+    const QString oldPath = m_path;
+    start(documentPath, m_store, m_hierarchy);
+    if (oldPath != m_path) {
+        // 新日志写完后再删除旧日志（写入线程按顺序执行）
+        QtConcurrent::run(&m_writer, [oldPath]() { QFile::remove(oldPath); });
+    }
+}
+
+void SceneJournal::setFlushInterval(int msec)
+{
+    m_timer.setInterval(msec);
+}
+
+// === 修改记录 ===
+void SceneJournal::beginRecord(quint8 type, quint32 payloadBytes)
+{
+    m_lastGeometryNode = INVALID_ID;
+    m_buffer.append(char(type));
+    putU32(m_buffer, payloadBytes);
+}
+
+void SceneJournal::appendNode(quint8 type, NodeId node, const QRect& rect, QStringView text)
+{
+    beginRecord(type, 4 + 16 + 4 + quint32(text.size()) * 2);
+    putU32(m_buffer, node);
+    putRect(m_buffer, rect);
+    putText(m_buffer, text);
+}
+
+void SceneJournal::appendEdge(quint8 type, EdgeId edge, NodeId from, NodeId to)
+{
+    beginRecord(type, 12);
+    putU32(m_buffer, edge);
+    putU32(m_buffer, from);
+    putU32(m_buffer, to);
+}
+
+void SceneJournal::nodeAdded(NodeId node, const QRect& rect, QStringView text)
+{
+    if (isActive()) appendNode(NodeAdded, node, rect, text);
+}
+
+void SceneJournal::nodeRemoved(NodeId node)
+{
+    if (!isActive()) return;
+    beginRecord(NodeRemoved, 4);
+    putU32(m_buffer, node);
+}
+
+void SceneJournal::nodeRevived(NodeId node, const QRect& rect, QStringView text)
+{
+    if (isActive()) appendNode(NodeRevived, node, rect, text);
+}
+
+void SceneJournal::nodeDiscarded()
+{
+    if (isActive()) beginRecord(NodeDiscarded, 0);
+}
+
+void SceneJournal::edgeAdded(EdgeId edge, NodeId from, NodeId to)
+{
+    if (isActive()) appendEdge(EdgeAdded, edge, from, to);
+}
+
+void SceneJournal::edgeRemoved(EdgeId edge)
+{
+    if (!isActive()) return;
+    beginRecord(EdgeRemoved, 4);
+    putU32(m_buffer, edge);
+}
+
+void SceneJournal::edgeRevived(EdgeId edge, NodeId from, NodeId to)
+{
+    if (isActive()) appendEdge(EdgeRevived, edge, from, to);
+}
+
+void SceneJournal::edgeDiscarded()
+{
+    if (isActive()) beginRecord(EdgeDiscarded, 0);
+}
+
+void SceneJournal::geometryChanged(NodeId node, const QRect& rect)
+{
+    if (!isActive()) return;
+
+    // 拖拽时同一节点的连续移动只保留最后位置
+    if (node == m_lastGeometryNode) {
+        m_buffer.chop(16);
+    } else {
+        beginRecord(Geometry, 4 + 16);
+        putU32(m_buffer, node);
+        m_lastGeometryNode = node;
+    }
+    putRect(m_buffer, rect);
+}
+
+void SceneJournal::textChanged(NodeId node, QStringView text)
+{
+    if (!isActive()) return;
+    beginRecord(Text, 4 + 4 + quint32(text.size()) * 2);
+    putU32(m_buffer, node);
+    putText(m_buffer, text);
+}
+
+void SceneJournal::weightChanged(NodeId node, double weight)
+{
+    if (!isActive()) return;
+    beginRecord(Weight, 4 + 8);
+    putU32(m_buffer, node);
+    putF64(m_buffer, weight);
+}
+
+void SceneJournal::sceneReset()
+{
+    if (isActive()) compact();
+}
+
+// === 写入 ===
+void SceneJournal::flush()
+{
+    if (m_buffer.isEmpty()) return;
+
+    // 记录总量超过基准时重新写入基准，均摊后写入量仍与修改量成正比
+    if (m_recordBytes + m_buffer.size() > qMax(MIN_COMPACT_BYTES, m_baseBytes)) {
+        compact();
+        return;
+    }
+
+    const QByteArray records = m_buffer;
+    const QString path = m_path;
+    m_recordBytes += records.size();
+    m_buffer.clear();
+    m_lastGeometryNode = INVALID_ID;
+
+    QtConcurrent::run(&m_writer, [this, path, records]() {
+        TRACE_SCOPE("SceneJournal::append");
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)
+            || file.write(records) != records.size() || !file.flush()) {
+            reportFailure(QStringLiteral("无法写入自动保存文件 %1").arg(path));
+        }
+    });
+}
+
+void SceneJournal::compact()
+{
+    if (!isActive()) return;
+    TRACE_SCOPE("SceneJournal::compact");
+
+    // 界面线程只取写时复制快照（不复制场景内容），序列化和写文件都在后台线程；
+    // 缓存的记录已包含在基准中
+    const SceneStore store = m_store->snapshot();
+    const SceneHierarchy hierarchy = m_hierarchy ? m_hierarchy->snapshot() : SceneHierarchy();
+    m_buffer.clear();
+    m_lastGeometryNode = INVALID_ID;
+    m_recordBytes = 0;
+    m_baseBytes = 24 + qint64(store.nodeSlots()) * 20 + qint64(store.edgeSlots()) * 8
+                  + qint64(store.textSize()) * 2 + qint64(hierarchy.nodes().size()) * 16;
+
+    const QString path = m_path;
+    const QString documentPath = m_documentPath;
+    QtConcurrent::run(&m_writer, [this, path, documentPath, store, hierarchy]() {
+        TRACE_SCOPE("SceneJournal::writeBase");
+        const Snapshot snapshot = takeSnapshot(store, hierarchy);
+        QByteArray header(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        putU32(header, JOURNAL_VERSION);
+        putText(header, documentPath);
+
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile file(path);
+        const bool ok = file.open(QIODevice::WriteOnly)
+                        && file.write(header) == header.size()
+                        && SceneFile::writeBinary(snapshot.scene, file)
+                        && file.write(snapshot.removals) == snapshot.removals.size()
+                        && file.write(snapshot.hierarchy) == snapshot.hierarchy.size()
+                        && file.commit();
+        if (!ok) {
+            reportFailure(QStringLiteral("无法写入自动保存文件 %1").arg(path));
+        }
+    });
+}
+
+void SceneJournal::reportFailure(const QString& error)
+{
+    // 在写入线程中调用，转到界面线程发出信号
+    QMetaObject::invokeMethod(this, [this, error]() { emit failed(error); }, Qt::QueuedConnection);
+}
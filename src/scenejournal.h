@@ -0,0 +1,119 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QRect>
+#include <QString>
+#include <QStringView>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include "sceneids.h"
+
+class SceneStore;
+class SceneHierarchy;
+struct SceneData;
+
+/**
+ * @brief 自动保存日志（只追加写入，异常退出后恢复）
+ *
+ * 日志文件由两部分组成：
+ * - 基准：某一时刻的完整场景（二进制场景格式，保留槽位布局，
+ *   已删除的槽位以占位记录加删除记录表示，使句柄与画布一致）和
+ *   层次结构的建立参数（恢复后重建层次细节聚合）
+ * - 修改记录：之后的移动/缩放、文本修改、增删节点和连接线，
+ *   每条记录带长度前缀，写到一半的最后一条记录在恢复时被忽略
+ *
+ * 修改记录先缓存在内存中（同一节点连续的几何记录原地覆盖，拖拽只保留
+ * 最后位置），定时交给后台线程追加到文件末尾，保存开销只与修改量有关。
+ * 记录总量超过基准大小时重新写入基准（压缩），均摊后仍与修改量成正比。
+ *
+ * 正常退出时删除日志；启动时通过会话标记找到上次异常退出留下的日志。
+ */
+class SceneJournal : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DEFAULT_FLUSH_INTERVAL = 2000;   ///< 默认写入间隔（毫秒）
+    static const qint64 MIN_COMPACT_BYTES = 1 << 20;  ///< 记录少于此大小时不压缩
+
+    explicit SceneJournal(QObject* parent = nullptr);
+    ~SceneJournal() override; ///< 等待写入完成，并删除日志（正常退出）
+
+    /// 文档对应的日志路径（文档旁的 .journal 文件；未命名文档放在应用数据目录）
+    static QString journalPathFor(const QString& documentPath);
+
+    /// 上次异常退出留下的日志路径（没有时为空）
+    static QString pendingRecovery();
+
+    /// 恢复出的层次结构（SceneHierarchy::build 的输入，节点为恢复出的场景中的 ID）
+    struct Hierarchy
+    {
+        QVector<quint32> nodes;
+        QVector<int> parents;
+        QVector<double> weights;
+    };
+
+    /**
+     * @brief 读取日志并重放修改记录
+     * @param scene 恢复出的场景
+     * @param documentPath 日志所属文档（未命名时为空）
+     * @param hierarchy 恢复出的层次结构（没有时为空；已删除的容器节点被去掉，
+     *                  其子节点挂到最近的存活祖先）
+     * @return 基准无法读取时返回 false；损坏或不完整的修改记录之后的内容被忽略
+     */
+    static bool recover(const QString& journalPath, SceneData* scene, QString* documentPath = nullptr,
+                        QString* error = nullptr, Hierarchy* hierarchy = nullptr);
+
+    static void discard(const QString& journalPath); ///< 删除日志和会话标记
+
+    /**
+     * @brief 以当前场景为基准开始记录
+     * @param store 画布场景（之后压缩时读取，须在日志生命周期内有效）
+     * @param hierarchy 画布的层次结构（同上）
+     */
+    void start(const QString& documentPath, const SceneStore* store, const SceneHierarchy* hierarchy);
+    bool isActive() const { return m_store != nullptr; }
+
+    void setDocumentPath(const QString& documentPath); ///< 文档另存或打开后迁移到新的日志文件
+    void setFlushInterval(int msec);
+
+    // === 修改记录（由 CanvasWidget 在场景变化后调用）===
+    void nodeAdded(NodeId node, const QRect& rect, QStringView text);
+    void nodeRemoved(NodeId node);
+    void nodeRevived(NodeId node, const QRect& rect, QStringView text);
+    void nodeDiscarded();
+    void edgeAdded(EdgeId edge, NodeId from, NodeId to);
+    void edgeRemoved(EdgeId edge);
+    void edgeRevived(EdgeId edge, NodeId from, NodeId to);
+    void edgeDiscarded();
+    void geometryChanged(NodeId node, const QRect& rect);
+    void textChanged(NodeId node, QStringView text);
+    void weightChanged(NodeId node, double weight); ///< 层次结构中叶节点的权重
+    void sceneReset(); ///< 场景或层次结构被整体替换（清空、导入等），重新写入基准
+
+public slots:
+    void flush();   ///< 把缓存的记录交给后台线程写入
+    void compact(); ///< 立即重新写入基准
+
+signals:
+    void failed(const QString& error); ///< 后台写入失败
+
+private:
+    void beginRecord(quint8 type, quint32 payloadBytes);
+    void appendNode(quint8 type, NodeId node, const QRect& rect, QStringView text);
+    void appendEdge(quint8 type, EdgeId edge, NodeId from, NodeId to);
+    void reportFailure(const QString& error);
+
+    const SceneStore* m_store = nullptr;
+    const SceneHierarchy* m_hierarchy = nullptr;
+    QString m_documentPath;
+    QString m_path;                 ///< 当前日志文件
+    QByteArray m_buffer;            ///< 尚未写入的修改记录
+    NodeId m_lastGeometryNode = INVALID_ID; ///< 缓存末尾是否为该节点的几何记录（可原地覆盖）
+    qint64 m_recordBytes = 0;       ///< 基准之后已写入的记录大小
+    qint64 m_baseBytes = 0;         ///< 基准大小（估算）
+    QTimer m_timer;
+    QThreadPool m_writer;           ///< 单线程，写入任务按提交顺序执行
+};
@@ -0,0 +1,367 @@
+#include "sceneloader.h"
+#include "tracing.h"
+#include <QFile>
+#include <QHash>
+#include <QStringView>
+#include <QtConcurrent>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+const qint64 CHUNK_BYTES = 1 << 22;  // 每块约 4MB，在行边界处切分
+const int CANCEL_CHECK_LINES = 4096; // 每解析若干行检查一次取消标志
+
+enum Section { OtherSection, NodesSection, ConnectionsSection };
+
+// 文本文件中的一块（按行边界切分）
+struct Chunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+
+    // 第一阶段：行数和块内最后一个段标题
+    int lineCount = 0;
+    Section lastSection = OtherSection;
+    bool hasHeader = false;
+
+    // 第二阶段的输入
+    int firstLine = 0;               // 块首行的全局行号（从 1 开始）
+    Section startSection = OtherSection;
+
+    // 第二阶段的输出
+    QVector<qint32> ids;             // 节点在文件中的 ID
+    SceneData nodes;                 // 节点几何与文本（不含连接线）
+    QVector<qint32> edgeIds;         // 连接线端点 ID，每两个一组
+    QVector<int> edgeLines;          // 连接线所在行号（用于报告无效 ID）
+};
+
+Section sectionFor(QStringView name)
+{
+    if (name == QLatin1String("Nodes")) return NodesSection;
+    if (name == QLatin1String("Connections")) return ConnectionsSection;
+    return OtherSection;
+}
+
+// 段标题行形如 "[Nodes]"（已去除首尾空白）
+bool parseHeader(QStringView line, Section* section)
+{
+    if (line.size() < 2 || line.front() != QLatin1Char('[') || line.back() != QLatin1Char(']')) return false;
+    *section = sectionFor(line.mid(1, line.size() - 2));
+    return true;
+}
+
+// 对原始字节做快速判断：去除行首空白后是否以 '[' 开头
+bool mayBeHeader(const char* line, const char* end)
+{
+    while (line < end && (*line == ' ' || *line == '\t' || *line == '\r')) ++line;
+    return line < end && *line == '[';
+}
+
+// 第一阶段：统计行数并找出块内的段标题（只对以 '[' 开头的行解码）
+void scanChunk(Chunk& chunk)
+{
+    const char* p = chunk.begin;
+    while (p < chunk.end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+        const char* lineEnd = nl ? nl : chunk.end;
+        if (mayBeHeader(p, lineEnd)) {
+            const QString line = QString::fromUtf8(p, lineEnd - p);
+            Section section;
+            if (parseHeader(QStringView(line).trimmed(), &section)) {
+                chunk.lastSection = section;
+                chunk.hasHeader = true;
+            }
+        }
+        chunk.lineCount++;
+        p = lineEnd + 1;
+    }
+}
+
+// 从 from 开始查找下一个逗号
+qsizetype nextComma(QStringView line, qsizetype from)
+{
+    return line.indexOf(u',', from);
+}
+
+// 解析节点行: ID,x,y,width,height,text
+bool parseNode(QStringView line, Chunk& chunk)
+{
+    // 先定位前五个逗号：不足六个字段的行视为格式错误
+    qsizetype commas[5];
+    qsizetype pos = 0;
+    for (int i = 0; i < 5; ++i) {
+        commas[i] = nextComma(line, pos);
+        if (commas[i] < 0) return false;
+        pos = commas[i] + 1;
+    }
+
+    // 数字无效的行直接跳过（与逐行解析时的行为一致）
+    qint32 fields[5];
+    qsizetype fieldStart = 0;
+    for (int i = 0; i < 5; ++i) {
+        bool ok;
+        fields[i] = line.mid(fieldStart, commas[i] - fieldStart).toInt(&ok);
+        if (!ok) return true;
+        fieldStart = commas[i] + 1;
+    }
+    if (fields[0] < 0) return true;
+
+    // 第五个逗号之后的全部内容都是文本（可能包含逗号）
+    chunk.ids.append(fields[0]);
+    chunk.nodes.addNode(QRect(fields[1], fields[2], fields[3], fields[4]), line.mid(pos));
+    return true;
+}
+
+// 解析连接行: startID,endID
+bool parseConnection(QStringView line, int lineNumber, Chunk& chunk)
+{
+    const qsizetype comma = nextComma(line, 0);
+    if (comma < 0 || nextComma(line, comma + 1) >= 0) return false;
+
+    bool ok;
+    const int startID = line.left(comma).toInt(&ok);
+    if (!ok || startID < 0) return true;
+    const int endID = line.mid(comma + 1).toInt(&ok);
+    if (!ok || endID < 0) return true;
+
+    chunk.edgeIds.append(startID);
+    chunk.edgeIds.append(endID);
+    chunk.edgeLines.append(lineNumber);
+    return true;
+}
+
+// 第二阶段：解码并解析块内的所有记录
+void parseChunk(Chunk& chunk, const std::atomic_bool* cancelled,
+                std::atomic<qint64>& bytesDone, const std::function<void()>& reportProgress)
+{
+    TRACE_SCOPE("SceneLoader::parseChunk"); // 在工作线程中，跟踪中按线程分行显示
+    const QString text = QString::fromUtf8(chunk.begin, chunk.end - chunk.begin);
+    const QStringView view(text);
+    Section section = chunk.startSection;
+    int lineNumber = chunk.firstLine;
+
+    qsizetype pos = 0;
+    while (pos <= view.size()) {
+        if (cancelled && (lineNumber - chunk.firstLine) % CANCEL_CHECK_LINES == 0
+            && cancelled->load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        qsizetype nl = view.indexOf(u'\n', pos);
+        if (nl < 0) nl = view.size();
+        const QStringView line = view.mid(pos, nl - pos).trimmed();
+        pos = nl + 1;
+
+        if (!line.isEmpty() && !parseHeader(line, &section)) {
+            bool valid = true;
+            if (section == NodesSection) {
+                valid = parseNode(line, chunk);
+                if (!valid) qWarning() << "无效节点行 #" << lineNumber << ":" << line;
+            } else if (section == ConnectionsSection) {
+                valid = parseConnection(line, lineNumber, chunk);
+                if (!valid) qWarning() << "无效连接行 #" << lineNumber << ":" << line;
+            }
+        }
+        lineNumber++;
+    }
+
+    bytesDone += chunk.end - chunk.begin;
+    reportProgress();
+}
+
+// 按行边界把 [data, data+size) 切分为若干块
+QVector<Chunk> splitChunks(const char* data, qint64 size)
+{
+    QVector<Chunk> chunks;
+    const char* p = data;
+    const char* end = data + size;
+    while (p < end) {
+        const char* chunkEnd = p + qMin(CHUNK_BYTES, qint64(end - p));
+        if (chunkEnd < end) {
+            const char* nl = static_cast<const char*>(std::memchr(chunkEnd, '\n', end - chunkEnd));
+            chunkEnd = nl ? nl + 1 : end;
+        }
+        Chunk chunk;
+        chunk.begin = p;
+        chunk.end = chunkEnd;
+        chunks.append(chunk);
+        p = chunkEnd;
+    }
+    return chunks;
+}
+
+bool parseText(const char* data, qint64 size, SceneData* scene,
+               const std::atomic_bool* cancelled, const SceneLoader::ProgressCallback& progress)
+{
+    // 跳过 UTF-8 BOM
+    if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+        data += 3;
+        size -= 3;
+    }
+
+    QVector<Chunk> chunks = splitChunks(data, size);
+
+    // 第一阶段（并行）：行数与段标题，用于确定每块起始所在的段和行号
+    QtConcurrent::blockingMap(chunks, scanChunk);
+    int line = 1;
+    Section section = OtherSection;
+    for (Chunk& chunk : chunks) {
+        chunk.firstLine = line;
+        chunk.startSection = section;
+        line += chunk.lineCount;
+        if (chunk.hasHeader) section = chunk.lastSection;
+    }
+
+    // 第二阶段（并行）：解码和分词
+    std::atomic<qint64> bytesDone{0};
+    std::atomic_int lastPercent{-1};
+    auto reportProgress = [&]() {
+        if (!progress || size == 0) return;
+        const int percent = int(bytesDone.load() * 100 / size);
+        if (lastPercent.exchange(percent) != percent) progress(percent);
+    };
+    QtConcurrent::blockingMap(chunks, [&](Chunk& chunk) {
+        parseChunk(chunk, cancelled, bytesDone, reportProgress);
+    });
+    if (cancelled && cancelled->load()) return false;
+
+    // 合并（按块顺序，保持文件中的节点顺序）
+    int nodeCount = 0, edgeCount = 0, maxId = -1;
+    for (const Chunk& chunk : qAsConst(chunks)) {
+        nodeCount += chunk.ids.size();
+        edgeCount += chunk.edgeLines.size();
+        for (qint32 id : chunk.ids) maxId = qMax(maxId, id);
+    }
+
+    scene->clear();
+    scene->reserve(nodeCount, edgeCount);
+
+    // ID 较稠密时用数组映射，否则用哈希表，避免超大 ID 占用过多内存
+    const bool denseIds = maxId < 4 * nodeCount + 1024;
+    QVector<int> idToIndex(denseIds ? maxId + 1 : 0, -1);
+    QHash<int, int> sparseIdToIndex;
+    for (const Chunk& chunk : qAsConst(chunks)) {
+        const quint32 textBase = scene->textOffsets.last();
+        for (int i = 0; i < chunk.ids.size(); ++i) {
+            const int index = scene->nodeCount() + i;
+            if (denseIds) idToIndex[chunk.ids[i]] = index;
+            else sparseIdToIndex.insert(chunk.ids[i], index);
+            scene->textOffsets.append(textBase + chunk.nodes.textOffsets[i + 1]);
+        }
+        scene->x += chunk.nodes.x;
+        scene->y += chunk.nodes.y;
+        scene->width += chunk.nodes.width;
+        scene->height += chunk.nodes.height;
+        scene->textData += chunk.nodes.textData;
+    }
+
+    auto indexOf = [&](int id) {
+        if (denseIds) return id < idToIndex.size() ? idToIndex[id] : -1;
+        return sparseIdToIndex.value(id, -1);
+    };
+    for (const Chunk& chunk : qAsConst(chunks)) {
+        for (int i = 0; i < chunk.edgeLines.size(); ++i) {
+            const int start = indexOf(chunk.edgeIds[2 * i]);
+            const int end = indexOf(chunk.edgeIds[2 * i + 1]);
+            if (start < 0 || end < 0) {
+                qWarning() << "无效节点ID在连接行 #" << chunk.edgeLines[i];
+                continue;
+            }
+            scene->addEdge(start, end);
+        }
+    }
+
+    if (progress) progress(100);
+    return true;
+}
+
+} // namespace
+
+SceneLoader::SceneLoader(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<Result>::finished, this, &SceneLoader::onFinished);
+}
+
+SceneLoader::~SceneLoader()
+{
+    cancel();
+    m_watcher.waitForFinished();
+}
+
+bool SceneLoader::load(const QString &path, SceneData *scene, QString *error,
+                       const std::atomic_bool *cancelled, const ProgressCallback &progress)
+{
+    TRACE_SCOPE("SceneLoader::load");
+    // 二进制格式本身就是按列整体拷贝，无需再分块
+    if (SceneFile::isBinary(path)) {
+        const bool ok = SceneFile::loadBinary(path, scene, error);
+        if (ok && progress) progress(100);
+        return ok;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = QStringLiteral("无法打开文件");
+        return false;
+    }
+
+    // 优先映射文件，避免把整个文件读入一份额外的缓冲区
+    qint64 size = file.size();
+    const uchar* mapped = size > 0 ? file.map(0, size) : nullptr;
+    QByteArray buffer;
+    const char* data = reinterpret_cast<const char*>(mapped);
+    if (!mapped) {
+        buffer = file.readAll();
+        data = buffer.constData();
+        size = buffer.size();
+    }
+
+    if (!parseText(data, size, scene, cancelled, progress)) {
+        if (error) *error = QStringLiteral("加载已取消");
+        return false;
+    }
+    return true;
+}
+
+void SceneLoader::start(const QString &path)
+{
+    if (isRunning()) {
+        cancel();
+        m_watcher.waitForFinished();
+    }
+
+    m_cancel = false;
+    const int generation = ++m_generation;
+    m_watcher.setFuture(QtConcurrent::run([this, path, generation]() {
+        Result result;
+        result.ok = load(path, &result.scene, &result.error, &m_cancel, [this, generation](int percent) {
+            // 信号跨线程发送时自动排队到 GUI 线程
+            if (generation == m_generation) emit progressChanged(percent);
+        });
+        result.canceled = m_cancel;
+        return result;
+    }));
+}
+
+void SceneLoader::cancel()
+{
+    m_cancel = true;
+}
+
+bool SceneLoader::isRunning() const
+{
+    return m_watcher.isRunning();
+}
+
+void SceneLoader::onFinished()
+{
+    const Result result = m_watcher.result();
+    if (result.canceled) {
+        emit canceled();
+    } else if (!result.ok) {
+        emit failed(result.error);
+    } else {
+        emit loaded(result.scene);
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "scenefile.h"
+#include <QObject>
+#include <QFutureWatcher>
+#include <atomic>
+#include <functional>
+
+/**
+ * @brief 后台场景加载器
+ *
+ * 在线程池中读取并解析场景文件，GUI 线程只在加载完成后收到完整的
+ * SceneData。文本格式按行边界切分为若干块，各块并行解码并用 QStringView
+ * 分词（不为每个字段生成临时字符串），最后按块顺序合并；二进制格式
+ * 直接交给 SceneFile::loadBinary。支持进度报告和取消。
+ */
+class SceneLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    using ProgressCallback = std::function<void(int)>; ///< 参数为 0-100 的百分比
+
+    explicit SceneLoader(QObject *parent = nullptr);
+    ~SceneLoader() override;
+
+    /**
+     * @brief 开始后台加载（会先取消尚未完成的加载）
+     * @param path 场景文件路径
+     */
+    void start(const QString &path);
+
+    void cancel();           ///< 请求取消当前加载
+    bool isRunning() const;  ///< 是否正在加载
+
+    /**
+     * @brief 同步加载场景文件（可在任意线程调用）
+     * @param path 场景文件路径
+     * @param scene 输出的场景数据
+     * @param error 失败时的错误信息
+     * @param cancelled 非空时在解析过程中检查，置位后尽快返回 false
+     * @param progress 进度回调（可能在工作线程中调用）
+     * @return 是否加载成功
+     */
+    static bool load(const QString &path, SceneData *scene, QString *error = nullptr,
+                     const std::atomic_bool *cancelled = nullptr,
+                     const ProgressCallback &progress = {});
+
+signals:
+    void progressChanged(int percent);     ///< 加载进度（0-100）
+    void loaded(const SceneData &scene);   ///< 加载成功
+    void failed(const QString &error);     ///< 加载失败
+    void canceled();                       ///< 加载被取消
+
+private:
+    struct Result {
+        bool ok = false;
+        bool canceled = false;
+        SceneData scene;
+        QString error;
+    };
+
+    void onFinished();
+
+    QFutureWatcher<Result> m_watcher; ///< 监视后台任务
+    std::atomic_bool m_cancel{false}; ///< 取消标志（工作线程读取）
+    std::atomic_int m_generation{0};  ///< 加载批次，用于丢弃过期的进度通知
+};
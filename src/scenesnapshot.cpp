@@ -0,0 +1,7 @@
+#include "scenesnapshot.h"
+
+SceneSnapshot::SceneSnapshot(const SceneStore& store, const SpatialIndex& index,
+                             const SceneHierarchy& hierarchy)
+    : m_data(new Data{store.snapshot(), index, hierarchy.snapshot()})
+{
+}
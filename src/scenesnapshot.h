@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QSharedPointer>
+#include "scenestore.h"
+#include "spatialindex.h"
+#include "scenehierarchy.h"
+
+/**
+ * @brief 场景在某一时刻的不可变快照
+ *
+ * 同时保留节点与连接线、空间索引和层次结构，三者的列数据都按块隐式共享：
+ * 创建快照不复制场景内容，之后界面线程修改实时场景时只复制被修改的块，
+ * 快照看到的内容保持不变。快照本身可以在线程间任意复制和传递。
+ *
+ * 除绘制外，工作线程（导出、自动保存、分块渲染）无需加锁即可读取。
+ * 绘制会写入 SceneStore / SceneHierarchy 的文本排版缓存，因此不能直接用
+ * store() 和 hierarchy() 绘制：绘制线程应先复制它们（只增加引用计数），
+ * 再用自己的副本绘制。
+ */
+class SceneSnapshot
+{
+public:
+    SceneSnapshot() = default; ///< 空快照
+    SceneSnapshot(const SceneStore& store, const SpatialIndex& index, const SceneHierarchy& hierarchy);
+
+    bool isNull() const { return !m_data; }
+
+    const SceneStore& store() const { return m_data->store; }
+    const SpatialIndex& index() const { return m_data->index; }
+    const SceneHierarchy& hierarchy() const { return m_data->hierarchy; }
+
+private:
+    struct Data {
+        SceneStore store;
+        SpatialIndex index;
+        SceneHierarchy hierarchy;
+    };
+    QSharedPointer<const Data> m_data;
+};
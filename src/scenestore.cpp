@@ -0,0 +1,420 @@
+#include "scenestore.h"
+#include "connection.h"
+#include "scenefile.h"
+
+namespace {
+
+// 字符串池中的废弃文本超过此长度且超过一半时压缩
+const qsizetype TEXT_COMPACT_THRESHOLD = 1 << 16;
+
+// 字符串池每块的字符数（超长文本单独占一块）
+const int TEXT_CHUNK_SIZE = 1 << 16;
+
+} // namespace
+
+void SceneStore::reserve(int nodes, int edges)
+{
+    const int n = m_rects.size() + nodes;
+    m_rects.reserve(n);
+    m_flags.reserve(n);
+    m_textChunk.reserve(n);
+    m_textOffset.reserve(n);
+    m_textLength.reserve(n);
+    m_firstOut.reserve(n);
+    m_firstIn.reserve(n);
+
+    const int e = m_edgeFrom.size() + edges;
+    m_edgeFrom.reserve(e);
+    m_edgeTo.reserve(e);
+    m_edgeLines.reserve(e);
+    m_nextOut.reserve(e);
+    m_nextIn.reserve(e);
+    m_prevOut.reserve(e);
+    m_prevIn.reserve(e);
+}
+
+void SceneStore::clear()
+{
+    m_rects.clear();
+    m_flags.clear();
+    m_textChunk.clear();
+    m_textOffset.clear();
+    m_textLength.clear();
+    m_firstOut.clear();
+    m_firstIn.clear();
+    m_aliveNodes = 0;
+
+    m_textChunks.clear();
+    m_textSize = 0;
+    m_textGarbage = 0;
+
+    m_edgeFrom.clear();
+    m_edgeTo.clear();
+    m_edgeLines.clear();
+    m_nextOut.clear();
+    m_nextIn.clear();
+    m_prevOut.clear();
+    m_prevIn.clear();
+    m_edgeIndex.clear();
+    m_aliveEdges = 0;
+
+    m_textLayouts.clear();
+}
+
+// === 节点 ===
+NodeId SceneStore::addNode(const QRect& rect, QStringView text)
+{
+    const NodeId node = m_rects.size();
+    m_rects.append(rect);
+    m_flags.append(Alive);
+    quint32 chunk, offset;
+    appendText(text, &chunk, &offset);
+    m_textChunk.append(chunk);
+    m_textOffset.append(offset);
+    m_textLength.append(quint32(text.size()));
+    m_firstOut.append(INVALID_ID);
+    m_firstIn.append(INVALID_ID);
+    m_aliveNodes++;
+    return node;
+}
+
+void SceneStore::removeNode(NodeId node)
+{
+    if (!isAlive(node)) return;
+    Q_ASSERT(m_firstOut.at(node) == INVALID_ID && m_firstIn.at(node) == INVALID_ID);
+
+    m_flags[node] = 0;
+    m_textGarbage += m_textLength.at(node);
+    m_textLength[node] = 0;
+    m_textLayouts.remove(node);
+    m_aliveNodes--;
+    compactTextPool();
+}
+
+void SceneStore::reviveNode(NodeId node, const QRect& rect, QStringView text)
+{
+    Q_ASSERT(!isAlive(node) && m_firstOut.at(node) == INVALID_ID && m_firstIn.at(node) == INVALID_ID);
+
+    m_rects[node] = rect;
+    m_flags[node] = Alive;
+    appendText(text, &m_textChunk[node], &m_textOffset[node]);
+    m_textLength[node] = quint32(text.size());
+    m_aliveNodes++;
+}
+
+void SceneStore::discardLastNode()
+{
+    const NodeId node = m_rects.size() - 1;
+    Q_ASSERT(m_firstOut.at(node) == INVALID_ID && m_firstIn.at(node) == INVALID_ID);
+
+    // 文本位于池尾时直接截断，否则计入废弃文本
+    const quint32 length = m_textLength.at(node);
+    const int chunk = int(m_textChunk.at(node));
+    if (chunk == m_textChunks.size() - 1
+        && m_textOffset.at(node) + length == quint32(m_textChunks.last().size())) {
+        m_textChunks.last().chop(length);
+        if (m_textChunks.last().isEmpty()) m_textChunks.removeLast();
+        m_textSize -= length;
+    } else {
+        m_textGarbage += length;
+    }
+    if (m_flags.at(node) & Alive) m_aliveNodes--;
+    m_textLayouts.remove(node);
+
+    m_rects.removeLast();
+    m_flags.removeLast();
+    m_textChunk.removeLast();
+    m_textOffset.removeLast();
+    m_textLength.removeLast();
+    m_firstOut.removeLast();
+    m_firstIn.removeLast();
+    compactTextPool();
+}
+
+void SceneStore::setRect(NodeId node, const QRect& rect)
+{
+    if (rect.size() != m_rects.at(node).size()) {
+        m_textLayouts.remove(node);
+    }
+    m_rects[node] = rect;
+}
+
+QStringView SceneStore::text(NodeId node) const
+{
+    const quint32 length = m_textLength[node];
+    if (length == 0) return QStringView();
+    return QStringView(m_textChunks.at(int(m_textChunk[node]))).mid(m_textOffset[node], length);
+}
+
+void SceneStore::setText(NodeId node, QStringView text)
+{
+    // 新文本追加到池尾，旧文本留待压缩
+    m_textGarbage += m_textLength.at(node);
+    appendText(text, &m_textChunk[node], &m_textOffset[node]);
+    m_textLength[node] = quint32(text.size());
+    m_textLayouts.remove(node);
+    compactTextPool();
+}
+
+void SceneStore::setFlag(NodeId node, NodeFlag flag, bool on)
+{
+    if (on) m_flags[node] |= flag;
+    else m_flags[node] &= ~flag;
+}
+
+void SceneStore::appendText(QStringView text, quint32* chunk, quint32* offset)
+{
+    // 文本不跨块：最后一块放不下时开新块，已满的块此后不再修改（快照继续共享）
+    if (m_textChunks.isEmpty() || m_textChunks.last().size() + text.size() > TEXT_CHUNK_SIZE) {
+        m_textChunks.append(QString());
+        m_textChunks.last().reserve(qMax(TEXT_CHUNK_SIZE, int(text.size())));
+    }
+    *chunk = quint32(m_textChunks.size() - 1);
+    *offset = quint32(m_textChunks.last().size());
+    m_textChunks.last().append(text);
+    m_textSize += text.size();
+}
+
+void SceneStore::compactTextPool()
+{
+    if (m_textGarbage < TEXT_COMPACT_THRESHOLD || m_textGarbage * 2 < m_textSize) return;
+
+    // 旧块在重建期间仍被 text() 引用，重建完成后整体替换
+    const QVector<QString> oldChunks = m_textChunks;
+    m_textChunks.clear();
+    m_textSize = 0;
+    for (int i = 0; i < m_rects.size(); ++i) {
+        const quint32 length = m_textLength.at(i);
+        const QStringView current = length > 0
+            ? QStringView(oldChunks.at(int(m_textChunk.at(i)))).mid(m_textOffset.at(i), length)
+            : QStringView();
+        appendText(current, &m_textChunk[i], &m_textOffset[i]);
+    }
+    m_textGarbage = 0;
+}
+
+void SceneStore::drawNode(QPainter* painter, NodeId node, int controlSize, int plusSize,
+                          TreeNode::DetailLevel detail) const
+{
+    // 只有完整细节才需要文本排版缓存，缩小显示的节点不占用缓存
+    TreeNode::TextLayout* layout = detail == TreeNode::FullDetail ? &m_textLayouts[node] : nullptr;
+    TreeNode::draw(painter, m_rects.at(node), text(node), hasFlag(node, Hovered), layout,
+                   controlSize, plusSize, detail);
+}
+
+// === 连接线 ===
+EdgeId SceneStore::addEdge(NodeId from, NodeId to)
+{
+    const EdgeId edge = linkEdge(from, to);
+    setEdgeLine(edge, Connection::lineBetween(m_rects.at(from), m_rects.at(to)));
+    return edge;
+}
+
+EdgeId SceneStore::linkEdge(NodeId from, NodeId to)
+{
+    const EdgeId edge = m_edgeFrom.size();
+    m_edgeFrom.append(from);
+    m_edgeTo.append(to);
+    m_edgeLines.append(QLineF());
+    m_nextOut.append(INVALID_ID);
+    m_nextIn.append(INVALID_ID);
+    m_prevOut.append(INVALID_ID);
+    m_prevIn.append(INVALID_ID);
+    insertLinks(edge, from, to);
+    m_aliveEdges++;
+    return edge;
+}
+
+void SceneStore::insertLinks(EdgeId edge, NodeId from, NodeId to)
+{
+    // 插入到两端节点的链表头
+    const EdgeId out = m_firstOut.at(from);
+    m_nextOut[edge] = out;
+    m_prevOut[edge] = INVALID_ID;
+    if (out != INVALID_ID) m_prevOut[out] = edge;
+    m_firstOut[from] = edge;
+
+    const EdgeId in = m_firstIn.at(to);
+    m_nextIn[edge] = in;
+    m_prevIn[edge] = INVALID_ID;
+    if (in != INVALID_ID) m_prevIn[in] = edge;
+    m_firstIn[to] = edge;
+}
+
+void SceneStore::removeEdge(EdgeId edge)
+{
+    if (!isEdgeAlive(edge)) return;
+
+    unlinkEdge(edge);
+    m_edgeIndex.remove(edge);
+    m_edgeFrom[edge] = m_edgeTo[edge] = INVALID_ID;
+    m_nextOut[edge] = m_nextIn[edge] = m_prevOut[edge] = m_prevIn[edge] = INVALID_ID;
+    m_aliveEdges--;
+}
+
+void SceneStore::reviveEdge(EdgeId edge, NodeId from, NodeId to)
+{
+    Q_ASSERT(!isEdgeAlive(edge));
+
+    m_edgeFrom[edge] = from;
+    m_edgeTo[edge] = to;
+    insertLinks(edge, from, to);
+    m_aliveEdges++;
+    setEdgeLine(edge, Connection::lineBetween(m_rects.at(from), m_rects.at(to)));
+}
+
+void SceneStore::discardLastEdge()
+{
+    const EdgeId edge = m_edgeFrom.size() - 1;
+    if (isEdgeAlive(edge)) {
+        unlinkEdge(edge);
+        m_edgeIndex.remove(edge);
+        m_aliveEdges--;
+    }
+    m_edgeFrom.removeLast();
+    m_edgeTo.removeLast();
+    m_edgeLines.removeLast();
+    m_nextOut.removeLast();
+    m_nextIn.removeLast();
+    m_prevOut.removeLast();
+    m_prevIn.removeLast();
+}
+
+void SceneStore::unlinkEdge(EdgeId edge)
+{
+    // 从起点的出边链表和终点的入边链表中摘除：双向链表直接改写前后邻居，
+    // 不必从链表头查找（否则删除高度数节点的全部连接线与度数的平方成正比）
+    const EdgeId prevOut = m_prevOut.at(edge), nextOut = m_nextOut.at(edge);
+    if (prevOut != INVALID_ID) m_nextOut[prevOut] = nextOut;
+    else m_firstOut[m_edgeFrom.at(edge)] = nextOut;
+    if (nextOut != INVALID_ID) m_prevOut[nextOut] = prevOut;
+
+    const EdgeId prevIn = m_prevIn.at(edge), nextIn = m_nextIn.at(edge);
+    if (prevIn != INVALID_ID) m_nextIn[prevIn] = nextIn;
+    else m_firstIn[m_edgeTo.at(edge)] = nextIn;
+    if (nextIn != INVALID_ID) m_prevIn[nextIn] = prevIn;
+}
+
+void SceneStore::setEdgeLine(EdgeId edge, const QLineF& line)
+{
+    m_edgeLines[edge] = line;
+    // 被节点完全遮住的线段长度为 0，不绘制也不进索引
+    if (line.isNull()) m_edgeIndex.remove(edge);
+    else m_edgeIndex.insert(edge, Connection::boundingRect(line));
+}
+
+QVector<EdgeId> SceneStore::edgesOf(NodeId node) const
+{
+    QVector<EdgeId> edges;
+    for (EdgeId e = m_firstOut[node]; e != INVALID_ID; e = m_nextOut[e]) {
+        edges.append(e);
+    }
+    for (EdgeId e = m_firstIn[node]; e != INVALID_ID; e = m_nextIn[e]) {
+        if (m_edgeFrom[e] != node) edges.append(e); // 自环已在出边中
+    }
+    return edges;
+}
+
+void SceneStore::updateEdgeLines(NodeId node)
+{
+    // 只有端点移动的连接线需要重新裁剪，其余沿用缓存的线段
+    recomputeEdgeLines(edgesOf(node));
+}
+
+void SceneStore::recomputeEdgeLines(const QVector<EdgeId>& edges)
+{
+    if (edges.isEmpty()) return;
+
+    // 收集两端几何后整批裁剪
+    QVector<QRect> starts, ends;
+    starts.reserve(edges.size());
+    ends.reserve(edges.size());
+    for (EdgeId e : edges) {
+        starts.append(m_rects.at(m_edgeFrom.at(e)));
+        ends.append(m_rects.at(m_edgeTo.at(e)));
+    }
+    QVector<QLineF> lines(edges.size());
+    Connection::clipLines(starts.constData(), ends.constData(), lines.data(), lines.size());
+    for (int i = 0; i < edges.size(); ++i) {
+        setEdgeLine(edges[i], lines[i]);
+    }
+}
+
+// === 与列式文件数据互相转换 ===
+QVector<NodeId> SceneStore::append(const SceneData& scene)
+{
+    reserve(scene.nodeCount(), scene.edgeCount());
+
+    QVector<NodeId> created;
+    created.reserve(scene.nodeCount());
+    for (int i = 0; i < scene.nodeCount(); ++i) {
+        created.append(addNode(scene.rect(i), scene.text(i)));
+    }
+    // 连接线先只建立邻接关系，线段在全部添加后整批裁剪
+    const EdgeId firstEdge = m_edgeFrom.size();
+    for (int i = 0; i < scene.edgeCount(); ++i) {
+        linkEdge(created[scene.edges[2 * i]], created[scene.edges[2 * i + 1]]);
+    }
+    const int added = m_edgeFrom.size() - int(firstEdge);
+    if (added > 0) {
+        QVector<QRect> starts, ends;
+        starts.reserve(added);
+        ends.reserve(added);
+        for (EdgeId e = firstEdge; e < EdgeId(m_edgeFrom.size()); ++e) {
+            starts.append(m_rects.at(m_edgeFrom.at(e)));
+            ends.append(m_rects.at(m_edgeTo.at(e)));
+        }
+        QVector<QLineF> lines(added);
+        Connection::clipLines(starts.constData(), ends.constData(), lines.data(), added);
+        m_edgeIndex.reserve(added);
+        for (int i = 0; i < added; ++i) setEdgeLine(firstEdge + i, lines[i]);
+    }
+    return created;
+}
+
+SceneData SceneStore::toSceneData() const
+{
+    SceneData scene;
+    scene.reserve(m_aliveNodes, m_aliveEdges);
+    scene.textData.reserve(textSize());
+
+    // 跳过已删除的槽位，存活节点按槽位顺序重新编号（即文件中的 ID）
+    QVector<quint32> fileIds(m_rects.size(), INVALID_ID);
+    for (int i = 0; i < m_rects.size(); ++i) {
+        if (!(m_flags[i] & Alive)) continue;
+        fileIds[i] = quint32(scene.nodeCount());
+        scene.addNode(m_rects[i], text(i));
+    }
+    for (int e = 0; e < m_edgeFrom.size(); ++e) {
+        if (m_edgeFrom[e] == INVALID_ID) continue;
+        scene.addEdge(fileIds[m_edgeFrom[e]], fileIds[m_edgeTo[e]]);
+    }
+    return scene;
+}
+
+qsizetype SceneStore::memoryUsage() const
+{
+    // 按容量计算各列；文本排版缓存按条目粗略估计
+    const qsizetype nodeBytes = m_rects.capacity() * qsizetype(sizeof(QRect))
+                              + m_flags.capacity() * qsizetype(sizeof(quint8))
+                              + (m_textChunk.capacity() + m_textOffset.capacity() + m_textLength.capacity())
+                                * qsizetype(sizeof(quint32))
+                              + (m_firstOut.capacity() + m_firstIn.capacity()) * qsizetype(sizeof(EdgeId));
+    const qsizetype edgeBytes = (m_edgeFrom.capacity() + m_edgeTo.capacity()) * qsizetype(sizeof(NodeId))
+                              + m_edgeLines.capacity() * qsizetype(sizeof(QLineF))
+                              + (m_nextOut.capacity() + m_nextIn.capacity() + m_prevOut.capacity()
+                                 + m_prevIn.capacity()) * qsizetype(sizeof(EdgeId));
+    qsizetype textChars = 0;
+    for (const QString& chunk : m_textChunks) textChars += chunk.capacity();
+    const qsizetype textBytes = textChars * qsizetype(sizeof(QChar))
+                              + m_textLayouts.size() * qsizetype(sizeof(TreeNode::TextLayout) + 64);
+    return qsizetype(sizeof(*this)) + nodeBytes + edgeBytes + textBytes;
+}
+
+SceneStore SceneStore::snapshot() const
+{
+    // 各列按块隐式共享，只有被修改的块才复制；排版缓存含字体对象，不跨线程共享
+    SceneStore copy(*this);
+    copy.m_textLayouts.clear();
+    return copy;
+}
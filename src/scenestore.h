@@ -0,0 +1,151 @@
+#pragma once
+
+#include <QHash>
+#include <QLineF>
+#include <QRect>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+#include "sceneids.h"
+#include "chunkedcolumn.h"
+#include "spatialindex.h"
+#include "treenode.h"
+
+struct SceneData; // 前向声明
+
+/**
+ * @brief 画布场景的列式存储
+ *
+ * 节点和连接线不再逐个 new，而是按列存放在连续数组中：
+ * - 节点：几何（QRect）、状态标志（存活/悬停/选中）、文本句柄
+ *   （指向共享字符串池的偏移和长度）、出边/入边链表头
+ * - 连接线：起点/终点句柄、缓存的线段、出边/入边双向链表指针
+ *
+ * 句柄即数组下标。删除只把槽位标记为无效，不移动其他元素，因此句柄
+ * 保持稳定、遍历顺序（即绘制的层叠顺序）保持不变；槽位在 clear 时回收。
+ * 与节点相连的连接线通过侵入式链表访问，增删连接线不分配内存。
+ * 连接线线段另有空间索引，绘制时只访问与区域相交的连接线。
+ *
+ * 各列和字符串池都分块存放（ChunkedColumn），复制整个场景只增加引用计数；
+ * 之后修改一个节点只复制它所在的块，因此快照的保留开销与修改量成正比。
+ *
+ * 文本排版缓存只为实际以完整细节绘制过的节点建立。drawNode 虽为 const，
+ * 但会写入该缓存，因此同一个 SceneStore 不能被多个线程同时用于绘制
+ * （其余 const 接口可以并发读取）。需要并发绘制时，每个线程先复制一份
+ * （只增加引用计数），再用自己的副本绘制。
+ */
+class SceneStore
+{
+public:
+    /// 节点状态标志
+    enum NodeFlag : quint8 {
+        Alive = 0x01,    ///< 槽位有效
+        Hovered = 0x02,  ///< 悬停
+        Selected = 0x04  ///< 选中
+    };
+
+    SceneStore() = default;
+
+    void reserve(int nodes, int edges); ///< 为批量添加预留容量
+    void clear();                       ///< 清空场景并回收所有槽位
+
+    // === 节点 ===
+    NodeId addNode(const QRect& rect, QStringView text);
+    void removeNode(NodeId node); ///< 删除节点（相连的连接线需先由调用者删除）
+    void reviveNode(NodeId node, const QRect& rect, QStringView text); ///< 在原槽位恢复已删除的节点
+    void discardLastNode();       ///< 彻底移除最后一个槽位（撤销添加；相连的连接线需先移除）
+
+    int nodeCount() const { return m_aliveNodes; }     ///< 存活节点数
+    int nodeSlots() const { return m_rects.size(); }   ///< 槽位数（遍历上界）
+    bool isAlive(NodeId node) const { return node < quint32(m_flags.size()) && (m_flags[node] & Alive); }
+
+    QRect rect(NodeId node) const { return m_rects[node]; }
+    void setRect(NodeId node, const QRect& rect);   ///< 尺寸变化时使文本缓存失效
+    QPoint center(NodeId node) const { return m_rects[node].center(); }
+    QStringView text(NodeId node) const;
+    qsizetype textSize() const { return m_textSize - m_textGarbage; } ///< 所有节点文本的字符总数
+    void setText(NodeId node, QStringView text);    ///< 使文本缓存失效
+
+    bool hasFlag(NodeId node, NodeFlag flag) const { return m_flags[node] & flag; }
+    void setFlag(NodeId node, NodeFlag flag, bool on);
+
+    /**
+     * @brief 绘制单个节点（完整细节时使用并维护文本排版缓存，非线程安全）
+     */
+    void drawNode(QPainter* painter, NodeId node, int controlSize, int plusSize,
+                  TreeNode::DetailLevel detail = TreeNode::FullDetail) const;
+
+    // === 连接线 ===
+    EdgeId addEdge(NodeId from, NodeId to);
+    void removeEdge(EdgeId edge);
+    void reviveEdge(EdgeId edge, NodeId from, NodeId to); ///< 在原槽位恢复已删除的连接线
+    void discardLastEdge();                                ///< 彻底移除最后一个连接线槽位（撤销添加）
+
+    int edgeCount() const { return m_aliveEdges; }          ///< 存活连接线数
+    int edgeSlots() const { return m_edgeFrom.size(); }     ///< 槽位数（遍历上界）
+    bool isEdgeAlive(EdgeId edge) const { return m_edgeFrom[edge] != INVALID_ID; }
+    NodeId edgeFrom(EdgeId edge) const { return m_edgeFrom[edge]; }
+    NodeId edgeTo(EdgeId edge) const { return m_edgeTo[edge]; }
+    const QLineF& edgeLine(EdgeId edge) const { return m_edgeLines[edge]; }
+    QVector<EdgeId> edgesIn(const QRect& rect) const { return m_edgeIndex.query(rect); } ///< 线段与区域相交的连接线
+
+    /// 与节点相连的所有连接线（自环只出现一次）
+    QVector<EdgeId> edgesOf(NodeId node) const;
+
+    /// 遍历与节点相连的连接线（自环会被访问两次）
+    template <typename Func>
+    void forEachEdgeOf(NodeId node, Func func) const
+    {
+        for (EdgeId e = m_firstOut[node]; e != INVALID_ID; e = m_nextOut[e]) func(e);
+        for (EdgeId e = m_firstIn[node]; e != INVALID_ID; e = m_nextIn[e]) func(e);
+    }
+
+    void updateEdgeLines(NodeId node); ///< 节点移动后重新裁剪相连连接线的线段（其余线段不变）
+    void recomputeEdgeLines(const QVector<EdgeId>& edges); ///< 批量重新裁剪指定连接线（多个节点同时移动时）
+
+    // === 与列式文件数据互相转换 ===
+    QVector<NodeId> append(const SceneData& scene); ///< 批量追加，返回新节点句柄
+    SceneData toSceneData() const;                  ///< 按层叠顺序导出存活的节点和连接线
+
+    qsizetype memoryUsage() const; ///< 占用的内存（字节，估算值）
+
+    /// 共享列数据的副本（不含文本排版缓存），供工作线程只读绘制；创建开销与场景规模无关
+    SceneStore snapshot() const;
+
+private:
+    void appendText(QStringView text, quint32* chunk, quint32* offset); ///< 文本追加到字符串池末尾
+    void compactTextPool();
+    EdgeId linkEdge(NodeId from, NodeId to);              ///< 添加连接线并接入邻接链表（线段待计算）
+    void insertLinks(EdgeId edge, NodeId from, NodeId to); ///< 插入两端节点的邻接链表头
+    void unlinkEdge(EdgeId edge);                         ///< 从两端节点的邻接链表中摘除（常数时间）
+    void setEdgeLine(EdgeId edge, const QLineF& line);    ///< 更新线段及其空间索引
+
+    // 节点列
+    ChunkedColumn<QRect> m_rects;
+    ChunkedColumn<quint8> m_flags;
+    ChunkedColumn<quint32> m_textChunk;   ///< 文本所在的字符串池块
+    ChunkedColumn<quint32> m_textOffset;  ///< 文本在块中的偏移
+    ChunkedColumn<quint32> m_textLength;  ///< 文本长度
+    ChunkedColumn<EdgeId> m_firstOut;     ///< 出边链表头
+    ChunkedColumn<EdgeId> m_firstIn;      ///< 入边链表头
+    int m_aliveNodes = 0;
+
+    // 字符串池：文本只追加到最后一块，单个文本不跨块（修改或删除后的旧文本
+    // 计入 m_textGarbage，过多时整体压缩）
+    QVector<QString> m_textChunks;
+    qsizetype m_textSize = 0;       ///< 池中的字符总数
+    qsizetype m_textGarbage = 0;
+
+    // 连接线列（已删除的连接线起点为 INVALID_ID）
+    ChunkedColumn<NodeId> m_edgeFrom;
+    ChunkedColumn<NodeId> m_edgeTo;
+    ChunkedColumn<QLineF> m_edgeLines;    ///< 裁剪到两端节点边框的线段（端点移动时更新）
+    ChunkedColumn<EdgeId> m_nextOut;
+    ChunkedColumn<EdgeId> m_nextIn;
+    ChunkedColumn<EdgeId> m_prevOut;      ///< 出边链表中的前一条（链表头为 INVALID_ID）
+    ChunkedColumn<EdgeId> m_prevIn;
+    SpatialIndex m_edgeIndex;             ///< 存活且线段非空的连接线（按线段外接矩形）
+    int m_aliveEdges = 0;
+
+    mutable QHash<NodeId, TreeNode::TextLayout> m_textLayouts; ///< 文本排版缓存（惰性生成）
+};
@@ -0,0 +1,226 @@
+#include "spatialindex.h"
+#include <algorithm>
+#include <iterator>
+
+int SpatialIndex::levelFor(const QRect& rect)
+{
+    // 选择格子边长不小于节点较长边的最低层
+    const qint64 size = qMax(1, qMax(rect.width(), rect.height()));
+    int level = 0;
+    while (level < MAX_LEVEL && (qint64(1) << (BASE_CELL_SHIFT + level)) < size) {
+        ++level;
+    }
+    return level;
+}
+
+quint64 SpatialIndex::cellKey(int level, int cx, int cy)
+{
+    // 层号占高 6 位，两个格子坐标各占 29 位（按补码截断，足以覆盖 int 坐标范围）
+    return (quint64(level) << 58)
+           | (quint64(quint32(cx) & 0x1FFFFFFFu) << 29)
+           | quint64(quint32(cy) & 0x1FFFFFFFu);
+}
+
+int SpatialIndex::cellCoord(int v, int level)
+{
+    // 算术右移即向下取整，负坐标同样适用
+    return int(qint64(v) >> (BASE_CELL_SHIFT + level));
+}
+
+const QVector<NodeId>* SpatialIndex::findCell(quint64 key) const
+{
+    if (m_cells.isEmpty()) return nullptr;
+    const QHash<quint64, QVector<NodeId>>& shard = m_cells.at(int(qHash(key) & (CELL_SHARDS - 1)));
+    auto it = shard.constFind(key);
+    return it == shard.constEnd() ? nullptr : &*it;
+}
+
+QHash<quint64, QVector<NodeId>>& SpatialIndex::shardFor(quint64 key)
+{
+    if (m_cells.isEmpty()) m_cells.resize(CELL_SHARDS);
+    return m_cells[int(qHash(key) & (CELL_SHARDS - 1))];
+}
+
+void SpatialIndex::addToCells(NodeId node, const QRect& rect, int level)
+{
+    const int x0 = cellCoord(rect.left(), level), x1 = cellCoord(rect.right(), level);
+    const int y0 = cellCoord(rect.top(), level), y1 = cellCoord(rect.bottom(), level);
+    for (int cx = x0; cx <= x1; ++cx) {
+        for (int cy = y0; cy <= y1; ++cy) {
+            const quint64 key = cellKey(level, cx, cy);
+            shardFor(key)[key].append(node);
+        }
+    }
+}
+
+void SpatialIndex::removeFromCells(NodeId node, const QRect& rect, int level)
+{
+    const int x0 = cellCoord(rect.left(), level), x1 = cellCoord(rect.right(), level);
+    const int y0 = cellCoord(rect.top(), level), y1 = cellCoord(rect.bottom(), level);
+    for (int cx = x0; cx <= x1; ++cx) {
+        for (int cy = y0; cy <= y1; ++cy) {
+            const quint64 key = cellKey(level, cx, cy);
+            if (!findCell(key)) continue; // 先只读查找，不存在时不复制分片
+            QHash<quint64, QVector<NodeId>>& shard = shardFor(key);
+            auto it = shard.find(key);
+            // 格内顺序无关（层叠顺序由插入序号决定），与末尾元素交换后删除，不移动其余元素
+            const int pos = it->indexOf(node);
+            if (pos >= 0) {
+                (*it)[pos] = it->constLast();
+                it->removeLast();
+            }
+            if (it->isEmpty()) {
+                shard.erase(it);
+            }
+        }
+    }
+}
+
+void SpatialIndex::insert(NodeId node, const QRect& rect)
+{
+    if (node >= quint32(m_items.size())) {
+        m_items.resize(node + 1);
+    }
+    Item& item = m_items[node];
+    if (item.level >= 0) {
+        update(node, rect);
+        return;
+    }
+
+    const int level = levelFor(rect);
+    item = Item{rect, m_nextOrder++, level};
+    m_levelCounts[level]++;
+    m_count++;
+    addToCells(node, rect, level);
+}
+
+void SpatialIndex::reserve(int count)
+{
+    m_items.reserve(m_items.size() + count);
+}
+
+void SpatialIndex::update(NodeId node, const QRect& rect)
+{
+    if (node >= quint32(m_items.size()) || m_items.at(node).level < 0) return;
+    Item* it = &m_items[node];
+
+    const int level = levelFor(rect);
+    const QRect& old = it->rect;
+    const bool sameCells = level == it->level
+                           && cellCoord(old.left(), level) == cellCoord(rect.left(), level)
+                           && cellCoord(old.right(), level) == cellCoord(rect.right(), level)
+                           && cellCoord(old.top(), level) == cellCoord(rect.top(), level)
+                           && cellCoord(old.bottom(), level) == cellCoord(rect.bottom(), level);
+
+    // 拖拽中的小步移动通常仍在原格子内，只需更新记录的几何区域
+    if (!sameCells) {
+        removeFromCells(node, old, it->level);
+        m_levelCounts[it->level]--;
+        addToCells(node, rect, level);
+        m_levelCounts[level]++;
+        it->level = level;
+    }
+    it->rect = rect;
+}
+
+void SpatialIndex::remove(NodeId node)
+{
+    if (node >= quint32(m_items.size()) || m_items.at(node).level < 0) return;
+    Item& item = m_items[node];
+
+    removeFromCells(node, item.rect, item.level);
+    m_levelCounts[item.level]--;
+    item.level = -1;
+    m_count--;
+}
+
+void SpatialIndex::clear()
+{
+    m_cells.clear();
+    m_items.clear();
+    m_count = 0;
+    std::fill(std::begin(m_levelCounts), std::end(m_levelCounts), 0);
+    m_nextOrder = 0;
+}
+
+NodeId SpatialIndex::topAt(const QPoint& pos) const
+{
+    NodeId best = INVALID_ID;
+    quint64 bestOrder = 0;
+
+    for (int level = 0; level <= MAX_LEVEL; ++level) {
+        if (m_levelCounts[level] == 0) continue;
+
+        const QVector<NodeId>* cell = findCell(cellKey(level, cellCoord(pos.x(), level),
+                                                       cellCoord(pos.y(), level)));
+        if (!cell) continue;
+
+        for (NodeId node : *cell) {
+            const Item& item = m_items[node];
+            if ((best == INVALID_ID || item.order > bestOrder) && item.rect.contains(pos)) {
+                best = node;
+                bestOrder = item.order;
+            }
+        }
+    }
+    return best;
+}
+
+QVector<NodeId> SpatialIndex::query(const QRect& rect) const
+{
+    if (rect.isEmpty() || m_count == 0) return {};
+
+    QVector<QPair<quint64, NodeId>> hits;
+
+    // 查询区域覆盖的格子数超过节点总数时，直接线性扫描更快
+    qint64 cellCount = 0;
+    for (int level = 0; level <= MAX_LEVEL; ++level) {
+        if (m_levelCounts[level] == 0) continue;
+        cellCount += qint64(cellCoord(rect.right(), level) - cellCoord(rect.left(), level) + 1)
+                     * (cellCoord(rect.bottom(), level) - cellCoord(rect.top(), level) + 1);
+    }
+
+    if (cellCount > m_count) {
+        for (int i = 0; i < m_items.size(); ++i) {
+            const Item& item = m_items[i];
+            if (item.level >= 0 && item.rect.intersects(rect)) {
+                hits.append({item.order, NodeId(i)});
+            }
+        }
+    } else {
+        for (int level = 0; level <= MAX_LEVEL; ++level) {
+            if (m_levelCounts[level] == 0) continue;
+
+            const int x0 = cellCoord(rect.left(), level), x1 = cellCoord(rect.right(), level);
+            const int y0 = cellCoord(rect.top(), level), y1 = cellCoord(rect.bottom(), level);
+            for (int cx = x0; cx <= x1; ++cx) {
+                for (int cy = y0; cy <= y1; ++cy) {
+                    const QVector<NodeId>* cell = findCell(cellKey(level, cx, cy));
+                    if (!cell) continue;
+
+                    for (NodeId node : *cell) {
+                        const Item& item = m_items[node];
+                        if (item.rect.intersects(rect)) {
+                            hits.append({item.order, node});
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // 跨格子的节点可能被收集多次，按插入序号排序后去重
+    std::sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+    hits.erase(std::unique(hits.begin(), hits.end(), [](const auto& a, const auto& b) {
+        return a.first == b.first;
+    }), hits.end());
+
+    QVector<NodeId> result;
+    result.reserve(hits.size());
+    for (const auto& hit : qAsConst(hits)) {
+        result.append(hit.second);
+    }
+    return result;
+}
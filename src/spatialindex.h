@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QHash>
+#include <QPoint>
+#include <QRect>
+#include <QVector>
+#include "sceneids.h"
+#include "chunkedcolumn.h"
+
+/**
+ * @brief 节点的空间索引（分层均匀网格）
+ *
+ * 第 L 层的网格边长为 BASE_CELL_SIZE * 2^L，每个节点按其较长边放入
+ * 恰好能容纳它的那一层，因此最多覆盖 4 个格子。点查询只需在每个非空层
+ * 查看一个格子，层数与最大/最小节点尺寸之比成对数关系。
+ *
+ * 节点句柄是连续的数组下标，索引记录直接按句柄存放在数组中。
+ * 每个节点记录插入序号，查询时序号大的节点位于上层，
+ * 与“后添加的节点在上层”的绘制顺序保持一致。
+ *
+ * SceneStore 也用它按线段外接矩形索引连接线（此时句柄为 EdgeId）。
+ *
+ * 索引记录分块存放，格子表按键分成 CELL_SHARDS 个散列表，复制索引后
+ * 修改少量节点只复制涉及的记录块和散列表，供场景快照廉价地保留旧版本。
+ */
+class SpatialIndex
+{
+public:
+    SpatialIndex() = default;
+
+    /**
+     * @brief 插入节点（新节点位于所有已有节点之上）
+     * @param node 节点句柄
+     * @param rect 节点几何区域
+     */
+    void insert(NodeId node, const QRect& rect);
+
+    /**
+     * @brief 节点几何变化后更新索引（保持原有层叠顺序）
+     * @param node 节点句柄
+     * @param rect 新的几何区域
+     */
+    void update(NodeId node, const QRect& rect);
+
+    void reserve(int count);     ///< 为批量插入预留空间
+    void remove(NodeId node); ///< 从索引中移除节点
+    void clear();                ///< 清空索引
+
+    /**
+     * @brief 查找包含指定点的最上层节点
+     * @param pos 检测坐标点
+     * @return 节点句柄，不存在时返回 INVALID_ID
+     */
+    NodeId topAt(const QPoint& pos) const;
+
+    /**
+     * @brief 查找与指定区域相交的所有节点
+     * @param rect 查询区域
+     * @return 按层叠顺序（自底向上）排列的节点列表
+     */
+    QVector<NodeId> query(const QRect& rect) const;
+
+private:
+    struct Item {
+        QRect rect;      ///< 当前几何区域
+        quint64 order;   ///< 插入序号（越大越靠上）
+        int level = -1;  ///< 所在网格层（-1 表示不在索引中）
+    };
+
+    static int levelFor(const QRect& rect);
+    static quint64 cellKey(int level, int cx, int cy);
+    static int cellCoord(int v, int level);
+
+    void addToCells(NodeId node, const QRect& rect, int level);
+    void removeFromCells(NodeId node, const QRect& rect, int level);
+    const QVector<NodeId>* findCell(quint64 key) const; ///< 格内节点，空格子返回 nullptr
+    QHash<quint64, QVector<NodeId>>& shardFor(quint64 key);
+
+    static const int CELL_SHARDS = 64;
+
+    QVector<QHash<quint64, QVector<NodeId>>> m_cells; ///< 格子 -> 格内节点（按键分片，惰性创建）
+    ChunkedColumn<Item> m_items;                      ///< 节点句柄 -> 索引记录
+    int m_count = 0;                         ///< 索引中的节点数
+    int m_levelCounts[32] = {};                 ///< 每层节点数（用于跳过空层）
+    quint64 m_nextOrder = 0;                    ///< 下一个插入序号
+
+    static const int BASE_CELL_SHIFT = 6; ///< 最底层格子边长 64 像素
+    static const int MAX_LEVEL = 31;
+};
@@ -0,0 +1,127 @@
+#include "svgwriter.h"
+#include <QIODevice>
+
+SvgWriter::SvgWriter(QIODevice* device)
+    : m_device(device)
+{
+    m_buffer.reserve(BUFFER_SIZE + 4096);
+}
+
+void SvgWriter::begin(const QRectF& viewBox, const QByteArray& styleSheet)
+{
+    m_buffer += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"";
+    appendNumber(viewBox.width());
+    m_buffer += "\" height=\"";
+    appendNumber(viewBox.height());
+    m_buffer += "\" viewBox=\"";
+    appendNumber(viewBox.x());
+    m_buffer += ' ';
+    appendNumber(viewBox.y());
+    m_buffer += ' ';
+    appendNumber(viewBox.width());
+    m_buffer += ' ';
+    appendNumber(viewBox.height());
+    m_buffer += "\">\n<style>";
+    m_buffer += styleSheet;
+    m_buffer += "</style>\n";
+    flushIfFull();
+}
+
+void SvgWriter::writeLines(const QLineF* lines, int count)
+{
+    if (count <= 0) return;
+    m_buffer += "<path d=\"";
+    for (int i = 0; i < count; ++i) {
+        m_buffer += 'M';
+        appendNumber(lines[i].x1());
+        m_buffer += ' ';
+        appendNumber(lines[i].y1());
+        m_buffer += 'L';
+        appendNumber(lines[i].x2());
+        m_buffer += ' ';
+        appendNumber(lines[i].y2());
+    }
+    m_buffer += "\"/>\n";
+    flushIfFull();
+}
+
+void SvgWriter::writeRect(const QRectF& rect, const char* cls)
+{
+    m_buffer += "<rect";
+    if (cls) {
+        m_buffer += " class=\"";
+        m_buffer += cls;
+        m_buffer += '"';
+    }
+    m_buffer += " x=\"";
+    appendNumber(rect.x());
+    m_buffer += "\" y=\"";
+    appendNumber(rect.y());
+    m_buffer += "\" width=\"";
+    appendNumber(rect.width());
+    m_buffer += "\" height=\"";
+    appendNumber(rect.height());
+    m_buffer += "\"/>\n";
+    flushIfFull();
+}
+
+void SvgWriter::writeText(const QPointF& center, QStringView text, const char* cls)
+{
+    m_buffer += "<text x=\"";
+    appendNumber(center.x());
+    m_buffer += "\" y=\"";
+    appendNumber(center.y());
+    if (cls) {
+        m_buffer += "\" class=\"";
+        m_buffer += cls;
+    }
+    m_buffer += "\">";
+    appendEscaped(text);
+    m_buffer += "</text>\n";
+    flushIfFull();
+}
+
+bool SvgWriter::end()
+{
+    m_buffer += "</svg>\n";
+    flush();
+    return !m_error;
+}
+
+void SvgWriter::appendNumber(qreal value)
+{
+    // 保留一位小数，整数不带小数点
+    const qint64 tenths = qRound64(value * 10);
+    if (tenths % 10 == 0) {
+        m_buffer += QByteArray::number(tenths / 10);
+    } else {
+        m_buffer += QByteArray::number(tenths / 10.0, 'f', 1);
+    }
+}
+
+void SvgWriter::appendEscaped(QStringView text)
+{
+    // XML 特殊字符转义；XML 1.0 不允许的控制字符替换为空格
+    const QByteArray utf8 = text.toUtf8();
+    for (const char c : utf8) {
+        switch (c) {
+        case '&': m_buffer += "&amp;"; break;
+        case '<': m_buffer += "&lt;"; break;
+        case '>': m_buffer += "&gt;"; break;
+        default: m_buffer += uchar(c) < 0x20 ? ' ' : c; break;
+        }
+    }
+}
+
+void SvgWriter::flushIfFull()
+{
+    if (m_buffer.size() >= BUFFER_SIZE) flush();
+}
+
+void SvgWriter::flush()
+{
+    if (m_buffer.isEmpty()) return;
+    if (!m_error && m_device->write(m_buffer) != m_buffer.size()) m_error = true;
+    m_buffer.resize(0); // 保留容量，避免重复分配
+}
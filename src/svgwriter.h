@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QByteArray>
+#include <QLineF>
+#include <QRectF>
+#include <QStringView>
+
+class QIODevice;
+
+/**
+ * @brief 流式 SVG 写入器
+ *
+ * 元素直接格式化为 UTF-8 写入缓冲区，缓冲区满 BUFFER_SIZE 后整块写入设备，
+ * 不构建 DOM，内存占用与场景规模无关。样式由 begin() 写入的样式表统一给出，
+ * 各元素只带几何属性，使百万节点的文件保持紧凑。
+ */
+class SvgWriter
+{
+public:
+    static const int BUFFER_SIZE = 64 * 1024;
+
+    explicit SvgWriter(QIODevice* device);
+
+    /**
+     * @brief 写入文件头
+     * @param viewBox 画面范围（场景坐标，1 个场景像素对应 1 个 SVG 用户单位）
+     * @param styleSheet CSS 样式表
+     */
+    void begin(const QRectF& viewBox, const QByteArray& styleSheet);
+
+    void writeLines(const QLineF* lines, int count);                ///< 写入一个由多条线段组成的 path
+    void writeRect(const QRectF& rect, const char* cls = nullptr);  ///< 写入矩形（可指定样式类）
+    void writeText(const QPointF& center, QStringView text, const char* cls = nullptr); ///< 写入以 center 为中心的单行文本
+
+    /// 写入文件尾并刷新缓冲区，返回所有写入是否成功
+    bool end();
+    bool hasError() const { return m_error; }
+
+private:
+    void appendNumber(qreal value);
+    void appendEscaped(QStringView text);
+    void flushIfFull();
+    void flush();
+
+    QIODevice* m_device;
+    QByteArray m_buffer;
+    bool m_error = false;
+};
@@ -0,0 +1,262 @@
+#include "tilerenderer.h"
+#include "tracing.h"
+#include <QPainter>
+#include <QRegion>
+#include <QThread>
+#include <QtConcurrent>
+#include <QtMath>
+
+namespace {
+
+// 向下取整的整数除法（负坐标的分块下标同样向下取整）
+int floorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+} // namespace
+
+TileRenderer::TileRenderer(DrawFunction draw, QObject* parent)
+    : QObject(parent)
+    , m_draw(draw)
+{
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+TileRenderer::~TileRenderer()
+{
+    // 工作线程只访问快照（各自持有引用），排队的分块直接丢弃
+    m_liveGeneration.store(++m_generation);
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void TileRenderer::setBackground(const QColor& color)
+{
+    if (m_background == color) return;
+    m_background = color;
+    invalidateAll();
+}
+
+quint64 TileRenderer::tileKey(int tx, int ty)
+{
+    return (quint64(quint32(tx)) << 32) | quint32(ty);
+}
+
+QRect TileRenderer::tileSceneRect(quint64 key, qreal scale)
+{
+    const int tx = int(quint32(key >> 32));
+    const int ty = int(quint32(key));
+    const qreal size = TILE_SIZE / scale;
+    return QRectF(tx * size, ty * size, size, size).toAlignedRect();
+}
+
+QRect TileRenderer::tileRange(const QRect& widgetRect, const QPoint& origin)
+{
+    return QRect(QPoint(floorDiv(widgetRect.left() - origin.x(), TILE_SIZE),
+                        floorDiv(widgetRect.top() - origin.y(), TILE_SIZE)),
+                 QPoint(floorDiv(widgetRect.right() - origin.x(), TILE_SIZE),
+                        floorDiv(widgetRect.bottom() - origin.y(), TILE_SIZE)));
+}
+
+// === 失效 ===
+void TileRenderer::invalidate(const QRect& sceneRect)
+{
+    if (sceneRect.isEmpty()) return;
+    m_version++;
+
+    // 场景区域换算为当前缩放倍数下的分块范围；缓存的分块数与视口大小相当，直接逐个检查
+    if (!m_tiles.isEmpty()) {
+        const QRect range(QPoint(qFloor(sceneRect.left() * m_scale / TILE_SIZE),
+                                 qFloor(sceneRect.top() * m_scale / TILE_SIZE)),
+                          QPoint(qFloor((sceneRect.right() + 1) * m_scale / TILE_SIZE),
+                                 qFloor((sceneRect.bottom() + 1) * m_scale / TILE_SIZE)));
+        for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+            if (range.contains(int(quint32(it.key() >> 32)), int(quint32(it.key())))) {
+                it->stale = true;
+                it->invalidated = m_version;
+            }
+        }
+    }
+
+    // 后备分块不再重新绘制，内容过期的直接丢弃
+    for (auto it = m_fallback.begin(); it != m_fallback.end();) {
+        if (tileSceneRect(it.key(), m_fallbackScale).intersects(sceneRect)) it = m_fallback.erase(it);
+        else ++it;
+    }
+}
+
+void TileRenderer::invalidateAll()
+{
+    m_version++;
+    for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+        it->stale = true;
+        it->invalidated = m_version;
+    }
+    m_fallback.clear();
+}
+
+// === 合成 ===
+bool TileRenderer::paint(QPainter* painter, const QRect& widgetRect, const QRect& visibleRect,
+                         qreal scale, const QPointF& offset, qreal dpr,
+                         const SceneStore& store, const SpatialIndex& index,
+                         const SceneHierarchy& hierarchy)
+{
+    TRACE_SCOPE("TileRenderer::paint");
+
+    // 缩放倍数改变：当前分块转为后备，正在绘制的分块结果作废
+    if (scale != m_scale || dpr != m_dpr) {
+        m_fallback.clear();
+        for (auto it = m_tiles.cbegin(); it != m_tiles.cend(); ++it) {
+            if (!it->image.isNull()) m_fallback.insert(it.key(), it->image);
+        }
+        m_fallbackScale = m_scale;
+        m_tiles.clear();
+        m_scale = scale;
+        m_dpr = dpr;
+        m_liveGeneration.store(++m_generation);
+    }
+
+    // 分块按整数像素对齐，避免贴图时重采样
+    const QPoint origin = offset.toPoint();
+    const QRect range = tileRange(widgetRect, origin);
+    QRegion missing;
+    bool upToDate = true;
+    for (int ty = range.top(); ty <= range.bottom(); ++ty) {
+        for (int tx = range.left(); tx <= range.right(); ++tx) {
+            const QPoint topLeft(origin.x() + tx * TILE_SIZE, origin.y() + ty * TILE_SIZE);
+            const auto it = m_tiles.constFind(tileKey(tx, ty));
+            if (it == m_tiles.cend() || it->image.isNull()) {
+                missing += QRect(topLeft, QSize(TILE_SIZE, TILE_SIZE));
+                upToDate = false;
+                continue;
+            }
+            painter->drawImage(topLeft, it->image);
+            if (it->stale) upToDate = false;
+        }
+    }
+    if (!missing.isEmpty() && !m_fallback.isEmpty()) {
+        drawFallback(painter, missing.intersected(widgetRect), scale, offset);
+    }
+
+    // 先调度可见分块，再预取外围一圈（平移时新露出的区域通常已经绘制好）
+    const QRect visible = tileRange(visibleRect, origin);
+    const QRect prefetch = visible.adjusted(-1, -1, 1, 1);
+    for (int ty = visible.top(); ty <= visible.bottom(); ++ty) {
+        for (int tx = visible.left(); tx <= visible.right(); ++tx) {
+            schedule(tileKey(tx, ty), store, index, hierarchy);
+        }
+    }
+    for (int ty = prefetch.top(); ty <= prefetch.bottom(); ++ty) {
+        for (int tx = prefetch.left(); tx <= prefetch.right(); ++tx) {
+            if (!visible.contains(tx, ty)) schedule(tileKey(tx, ty), store, index, hierarchy);
+        }
+    }
+
+    evict(prefetch);
+    return upToDate;
+}
+
+void TileRenderer::drawFallback(QPainter* painter, const QRegion& region, qreal scale, const QPointF& offset)
+{
+    // 旧缩放倍数的分块按场景坐标换算到当前视图后拉伸显示
+    painter->save();
+    painter->setClipRegion(region);
+    const QRectF bounds(region.boundingRect());
+    for (auto it = m_fallback.cbegin(); it != m_fallback.cend(); ++it) {
+        const int tx = int(quint32(it.key() >> 32));
+        const int ty = int(quint32(it.key()));
+        const qreal size = TILE_SIZE / m_fallbackScale * scale;
+        const QRectF target(tx * size + offset.x(), ty * size + offset.y(), size, size);
+        if (target.intersects(bounds)) painter->drawImage(target, *it);
+    }
+    painter->restore();
+}
+
+void TileRenderer::evict(const QRect& keep)
+{
+    // 缓存超过保留范围的两倍时，丢弃范围外已完成的分块
+    const int keepCount = keep.width() * keep.height();
+    if (m_tiles.size() <= 2 * keepCount) return;
+    for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+        const bool inside = keep.contains(int(quint32(it.key() >> 32)), int(quint32(it.key())));
+        if (!inside && !it->pending) it = m_tiles.erase(it);
+        else ++it;
+    }
+}
+
+// === 并行绘制 ===
+void TileRenderer::schedule(quint64 key, const SceneStore& store, const SpatialIndex& index,
+                            const SceneHierarchy& hierarchy)
+{
+    Tile& tile = m_tiles[key];
+    if (tile.pending || !tile.stale) return;
+
+    // 同一版本的所有分块共用一份快照
+    if (m_snapshot.isNull() || m_snapshotVersion != m_version) {
+        m_snapshot = SceneSnapshot(store, index, hierarchy);
+        m_snapshotVersion = m_version;
+    }
+
+    tile.pending = true;
+    m_pending++;
+
+    const SceneSnapshot snapshot = m_snapshot;
+    const quint64 generation = m_generation;
+    const quint64 version = m_snapshotVersion;
+    const DrawFunction draw = m_draw;
+    const qreal scale = m_scale;
+    const qreal dpr = m_dpr;
+    const QColor background = m_background;
+    QtConcurrent::run(&m_pool, [=]() {
+        QImage image;
+        if (m_liveGeneration.load() == generation) {
+            image = renderTile(snapshot, draw, key, scale, dpr, background);
+        }
+        QMetaObject::invokeMethod(this, [=]() { tileFinished(key, generation, version, image); },
+                                  Qt::QueuedConnection);
+    });
+}
+
+QImage TileRenderer::renderTile(const SceneSnapshot& snapshot, DrawFunction draw, quint64 key,
+                                qreal scale, qreal dpr, const QColor& background)
+{
+    TRACE_SCOPE("TileRenderer::renderTile");
+    const int tx = int(quint32(key >> 32));
+    const int ty = int(quint32(key));
+
+    QImage image(QSize(TILE_SIZE, TILE_SIZE) * dpr, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(background);
+
+    // 文本排版缓存不能跨线程共享，每个分块使用自己的副本（列数据仍然共享）
+    const SceneStore store = snapshot.store();
+    const SceneHierarchy hierarchy = snapshot.hierarchy();
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setTransform(QTransform(scale, 0, 0, scale, -tx * TILE_SIZE, -ty * TILE_SIZE));
+    draw(&painter, store, snapshot.index(), hierarchy, tileSceneRect(key, scale), scale);
+    return image;
+}
+
+void TileRenderer::tileFinished(quint64 key, quint64 generation, quint64 version, const QImage& image)
+{
+    m_pending--;
+    if (generation == m_generation) {
+        const auto it = m_tiles.find(key);
+        if (it != m_tiles.end()) {
+            it->pending = false;
+            if (!image.isNull()) {
+                it->image = image;
+                it->stale = it->invalidated > version; // 绘制期间又被修改时需要重新绘制
+            }
+            emit tileReady(tileSceneRect(key, m_scale));
+        }
+    }
+
+    // 全部完成后释放快照和后备分块
+    if (m_pending == 0) {
+        m_snapshot = SceneSnapshot();
+        m_fallback.clear();
+    }
+}
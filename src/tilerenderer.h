@@ -0,0 +1,103 @@
+#pragma once
+
+#include <QColor>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPointF>
+#include <QRect>
+#include <QThreadPool>
+#include <atomic>
+#include "scenesnapshot.h"
+
+class QPainter;
+class QRegion;
+
+/**
+ * @brief 分块并行光栅化
+ *
+ * 把视口切成 TILE_SIZE 像素的分块，在线程池中从场景的只读快照并行绘制到
+ * QImage；界面线程只负责把已完成的分块贴到屏幕上，大场景的绘制不会阻塞输入。
+ *
+ * - 分块网格以场景原点为基准，与平移量无关，平移时已绘制的分块直接复用
+ * - 场景修改只使相交的分块过期；过期分块在新结果到达前继续显示（双缓冲）
+ * - 缩放倍数改变后，旧倍数的分块作为后备按比例拉伸显示，直到新分块全部完成
+ * - 快照是 SceneStore、SpatialIndex 和 SceneHierarchy 的隐式共享副本，创建开销与场景规模无关；
+ *   只在有分块正在绘制时持有，此时界面线程修改场景才会复制一次列数据
+ */
+class TileRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int TILE_SIZE = 256; ///< 分块边长（控件像素）
+
+    /// 绘制与场景区域相交的内容（painter 已设置视图变换，在工作线程中调用），返回绘制的节点数
+    using DrawFunction = int (*)(QPainter* painter, const SceneStore& store, const SpatialIndex& index,
+                                 const SceneHierarchy& hierarchy, const QRect& sceneRect, qreal scale);
+
+    explicit TileRenderer(DrawFunction draw, QObject* parent = nullptr);
+    ~TileRenderer() override; ///< 丢弃排队的分块并等待正在绘制的分块结束
+
+    void setBackground(const QColor& color); ///< 分块的底色（修改后所有分块过期）
+
+    void invalidate(const QRect& sceneRect); ///< 使与场景区域相交的分块过期
+    void invalidateAll();                     ///< 使所有分块过期（场景整体替换时）
+
+    /**
+     * @brief 把已完成的分块贴到控件上，并调度缺失或过期的分块
+     * @param painter 控件坐标的 painter（不带视图变换）
+     * @param widgetRect 需要重绘的控件区域
+     * @param visibleRect 整个可见的控件区域（按此调度，并预取外围一圈分块）
+     * @param scale 视图缩放倍数
+     * @param offset 场景原点在控件中的位置
+     * @param dpr 设备像素比
+     * @return 重绘区域内的分块是否都已是最新
+     */
+    bool paint(QPainter* painter, const QRect& widgetRect, const QRect& visibleRect,
+               qreal scale, const QPointF& offset, qreal dpr,
+               const SceneStore& store, const SpatialIndex& index, const SceneHierarchy& hierarchy);
+
+    int cachedTiles() const { return m_tiles.size(); } ///< 缓存的分块数
+    int pendingTiles() const { return m_pending; }     ///< 正在绘制或排队的分块数
+
+signals:
+    void tileReady(const QRect& sceneRect); ///< 分块绘制完成（场景坐标），需要重绘该区域
+
+private:
+    struct Tile {
+        QImage image;            ///< 最近一次完成的绘制结果（可能已过期）
+        bool stale = true;       ///< 是否需要重新绘制
+        bool pending = false;    ///< 是否已交给线程池
+        quint64 invalidated = 0; ///< 最近一次过期时的场景版本
+    };
+
+    static quint64 tileKey(int tx, int ty);
+    static QRect tileSceneRect(quint64 key, qreal scale);
+    static QRect tileRange(const QRect& widgetRect, const QPoint& origin); ///< 覆盖控件区域的分块下标范围
+    static QImage renderTile(const SceneSnapshot& snapshot, DrawFunction draw, quint64 key,
+                             qreal scale, qreal dpr, const QColor& background);
+
+    void schedule(quint64 key, const SceneStore& store, const SpatialIndex& index,
+                  const SceneHierarchy& hierarchy);
+    void tileFinished(quint64 key, quint64 generation, quint64 version, const QImage& image);
+    void drawFallback(QPainter* painter, const QRegion& region, qreal scale, const QPointF& offset);
+    void evict(const QRect& keep);
+
+    DrawFunction m_draw;
+    QColor m_background = Qt::white;
+    QThreadPool m_pool;
+
+    QHash<quint64, Tile> m_tiles;      ///< 当前缩放倍数的分块
+    qreal m_scale = 0;                 ///< m_tiles 对应的缩放倍数
+    qreal m_dpr = 1;                   ///< m_tiles 对应的设备像素比
+    QHash<quint64, QImage> m_fallback; ///< 上一缩放倍数的分块（新分块完成前的后备）
+    qreal m_fallbackScale = 0;
+
+    quint64 m_version = 0;             ///< 场景版本（每次过期递增）
+    quint64 m_generation = 0;          ///< 缩放倍数改变时递增，旧结果作废
+    std::atomic<quint64> m_liveGeneration{0}; ///< 供工作线程跳过已作废的排队分块
+    SceneSnapshot m_snapshot;          ///< 当前版本的快照（没有分块在绘制时释放）
+    quint64 m_snapshotVersion = 0;
+    int m_pending = 0;
+};
@@ -0,0 +1,150 @@
+#include "tracing.h"
+#include <QCoreApplication>
+#include <QMutex>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct Event {
+    const char* name;
+    qint64 start; ///< 纳秒
+    qint64 end;
+};
+
+// 单个线程的事件缓冲区；锁只在导出/清空与记录并发时才会发生竞争
+struct ThreadBuffer {
+    QMutex mutex;
+    QVector<Event> events;
+    quint32 threadId = 0;
+    bool mainThread = false; ///< 是否为应用程序的主（界面）线程
+};
+
+// 每个线程最多保留的事件数，超出后丢弃（避免长时间记录耗尽内存）
+const int MAX_EVENTS_PER_THREAD = 1 << 20;
+
+QMutex registryMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> registry; // 所有线程的缓冲区（线程退出后保留）
+
+ThreadBuffer* currentBuffer()
+{
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer) {
+        buffer = std::make_shared<ThreadBuffer>();
+        // 第一个记录事件的线程不一定是主线程，按线程身份判断
+        const QCoreApplication* app = QCoreApplication::instance();
+        buffer->mainThread = app && QThread::currentThread() == app->thread();
+        QMutexLocker locker(&registryMutex);
+        buffer->threadId = quint32(registry.size() + 1);
+        registry.push_back(buffer);
+    }
+    return buffer.get();
+}
+
+} // namespace
+
+std::atomic_bool Tracing::Detail::enabled{false};
+
+qint64 Tracing::Detail::now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracing::Detail::record(const char* name, qint64 start, qint64 end)
+{
+    ThreadBuffer* buffer = currentBuffer();
+    QMutexLocker locker(&buffer->mutex);
+    if (buffer->events.size() < MAX_EVENTS_PER_THREAD) {
+        buffer->events.append(Event{name, start, end});
+    }
+}
+
+void Tracing::setEnabled(bool enabled)
+{
+    Detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracing::clear()
+{
+    QMutexLocker locker(&registryMutex);
+    for (const auto& buffer : registry) {
+        QMutexLocker bufferLocker(&buffer->mutex);
+        buffer->events.clear();
+    }
+}
+
+int Tracing::eventCount()
+{
+    QMutexLocker locker(&registryMutex);
+    int count = 0;
+    for (const auto& buffer : registry) {
+        QMutexLocker bufferLocker(&buffer->mutex);
+        count += buffer->events.size();
+    }
+    return count;
+}
+
+bool Tracing::writeChromeTrace(const QString& path, QString* error)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (error) *error = QStringLiteral("无法写入文件 %1").arg(path);
+        return false;
+    }
+
+    // 先复制各线程的事件，写文件时不阻塞记录
+    struct ThreadEvents {
+        quint32 threadId;
+        bool mainThread;
+        QVector<Event> events;
+    };
+    QVector<ThreadEvents> snapshot;
+    {
+        QMutexLocker locker(&registryMutex);
+        for (const auto& buffer : registry) {
+            QMutexLocker bufferLocker(&buffer->mutex);
+            snapshot.append({buffer->threadId, buffer->mainThread, buffer->events});
+        }
+    }
+
+    // 时间戳以最早的事件为零点，单位为微秒（trace_event 格式要求）
+    qint64 origin = std::numeric_limits<qint64>::max();
+    for (const auto& thread : qAsConst(snapshot)) {
+        for (const Event& event : thread.events) {
+            origin = qMin(origin, event.start);
+        }
+    }
+
+    QTextStream out(&file);
+    out.setRealNumberNotation(QTextStream::FixedNotation);
+    out.setRealNumberPrecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& thread : qAsConst(snapshot)) {
+        if (!first) out << ',';
+        first = false;
+        out << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.threadId
+            << ",\"args\":{\"name\":\"" << (thread.mainThread ? "main" : "worker") << ' '
+            << thread.threadId << "\"}}";
+        for (const Event& event : thread.events) {
+            out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"treemap\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << thread.threadId << ",\"ts\":" << (event.start - origin) / 1000.0
+                << ",\"dur\":" << (event.end - event.start) / 1000.0 << '}';
+        }
+    }
+    out << "\n]}\n";
+
+    out.flush();
+    if (out.status() != QTextStream::Ok || !file.commit()) {
+        if (error) *error = QStringLiteral("无法写入文件 %1").arg(path);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QString>
+#include <atomic>
+
+/**
+ * @brief 轻量级性能跟踪
+ *
+ * 用 TRACE_SCOPE("名称") 在作用域开始和结束时记录一个耗时事件，事件写入
+ * 各线程自己的缓冲区，可导出为 Chrome trace_event JSON（chrome://tracing
+ * 或 Perfetto 打开）。
+ *
+ * 未启用时每个作用域只有一次原子读和一次分支，可以常驻在发布版本中；
+ * 定义 TREEMAP_NO_TRACING 时宏展开为空，完全不参与编译。
+ * 名称必须是字符串字面量（只保存指针）。
+ */
+namespace Tracing
+{
+    namespace Detail {
+        extern std::atomic_bool enabled;
+        qint64 now();                                          ///< 单调时钟（纳秒）
+        void record(const char* name, qint64 start, qint64 end); ///< 写入当前线程的缓冲区
+    }
+
+    inline bool isEnabled() { return Detail::enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled);
+
+    void clear();       ///< 丢弃已记录的事件
+    int eventCount();   ///< 已记录的事件数
+
+    /**
+     * @brief 导出为 Chrome trace_event JSON
+     * @return 是否成功，失败时写入 error
+     */
+    bool writeChromeTrace(const QString& path, QString* error = nullptr);
+
+    /// 作用域计时器（通常通过 TRACE_SCOPE 使用）
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name)
+            : m_name(isEnabled() ? name : nullptr), m_start(m_name ? Detail::now() : 0) {}
+        ~Scope()
+        {
+            if (m_name) Detail::record(m_name, m_start, Detail::now());
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_name; ///< 为空表示开始时未启用
+        qint64 m_start;
+    };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef TREEMAP_NO_TRACING
+#define TRACE_SCOPE(name) do {} while (false)
+#else
+#define TRACE_SCOPE(name) const Tracing::Scope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#endif
@@ -0,0 +1,477 @@
+#include "treemaplayout.h"
+#include "scenefile.h"
+#include <QFile>
+#include <QHash>
+#include <QTextStream>
+#include <QVarLengthArray>
+#include <QtMath>
+#include <algorithm>
+
+namespace {
+
+void setError(QString* error, const QString& message)
+{
+    if (error) *error = message;
+}
+
+// 按边取整：共享边的两个矩形取整后仍然共享同一条边
+QRect snapped(const QRectF& r)
+{
+    const int left = qRound(r.left());
+    const int top = qRound(r.top());
+    return QRect(left, top, qRound(r.right()) - left, qRound(r.bottom()) - top);
+}
+
+// 一行（或一列）矩形中最差的长宽比：side 为行的长度，sum/min/max 为行内面积统计
+inline double worstRatio(double sum, double minArea, double maxArea, double side)
+{
+    const double s2 = sum * sum;
+    const double w2 = side * side;
+    return qMax(w2 * maxArea / s2, s2 / (w2 * minArea));
+}
+
+} // namespace
+
+// === TreemapHierarchy ===
+void TreemapHierarchy::reserve(int nodes)
+{
+    parent.reserve(nodes);
+    weight.reserve(nodes);
+    labels.reserve(nodes);
+}
+
+int TreemapHierarchy::addNode(int parentIndex, double nodeWeight, const QString& label)
+{
+    parent.append(parentIndex);
+    weight.append(nodeWeight);
+    labels.append(label);
+    return parent.size() - 1;
+}
+
+void TreemapHierarchy::clear()
+{
+    parent.clear();
+    weight.clear();
+    labels.clear();
+}
+
+bool TreemapHierarchy::load(const QString& path, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        setError(error, QStringLiteral("无法打开文件"));
+        return false;
+    }
+
+    clear();
+    QHash<qint64, int> idToIndex;  // 文件中的节点ID -> 下标
+    QVector<qint64> parentIds;     // 先记录父节点ID，读完后再解析（父节点可能在后面）
+
+    QTextStream in(&file);
+    int lineCount = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        lineCount++;
+        if (line.isEmpty() || line.startsWith('#')) continue;
+
+        // 解析: ID,父节点ID,权重,文本
+        const QStringList parts = line.split(',');
+        bool idOk = false, parentOk = false, weightOk = false;
+        const qint64 id = parts.size() >= 3 ? parts[0].toLongLong(&idOk) : 0;
+        const qint64 parentId = parts.size() >= 3 ? parts[1].toLongLong(&parentOk) : 0;
+        const double value = parts.size() >= 3 ? parts[2].toDouble(&weightOk) : 0;
+        if (!idOk || !parentOk || !weightOk || !qIsFinite(value) || idToIndex.contains(id)) {
+            setError(error, QStringLiteral("第 %1 行格式无效").arg(lineCount));
+            return false;
+        }
+
+        idToIndex.insert(id, addNode(-1, value, parts.mid(3).join(',')));
+        parentIds.append(parentId);
+    }
+
+    for (int i = 0; i < parentIds.size(); ++i) {
+        if (parentIds[i] < 0) continue;
+        const auto it = idToIndex.constFind(parentIds[i]);
+        if (it == idToIndex.constEnd()) {
+            setError(error, QStringLiteral("父节点 %1 不存在").arg(parentIds[i]));
+            return false;
+        }
+        parent[i] = it.value();
+    }
+    return true;
+}
+
+// === TreemapLayout ===
+bool TreemapLayout::setHierarchy(const TreemapHierarchy& hierarchy, QString* error)
+{
+    const int n = hierarchy.count();
+    if (hierarchy.weight.size() != n) {
+        setError(error, QStringLiteral("权重数量与节点数量不一致"));
+        return false;
+    }
+    for (int i = 0; i < n; ++i) {
+        if (hierarchy.parent[i] < -1 || hierarchy.parent[i] >= n) {
+            setError(error, QStringLiteral("节点 %1 的父节点无效").arg(i));
+            return false;
+        }
+        // NaN 会穿过 qMax(w, 0.0) 并污染整条祖先路径的总权重
+        if (!qIsFinite(hierarchy.weight[i])) {
+            setError(error, QStringLiteral("节点 %1 的权重无效").arg(i));
+            return false;
+        }
+    }
+
+    m_parent = hierarchy.parent;
+    m_labels = hierarchy.labels;
+    buildChildren();
+
+    // 广度优先遍历：未被访问到的节点一定位于环上
+    m_order.clear();
+    m_order.reserve(n);
+    m_depth.resize(n);
+    for (int root : qAsConst(m_roots)) {
+        m_order.append(root);
+        m_depth[root] = 0;
+    }
+    for (int i = 0; i < m_order.size(); ++i) {
+        const int node = m_order[i];
+        for (int c = m_childStart[node]; c < m_childStart[node + 1]; ++c) {
+            m_order.append(m_children[c]);
+            m_depth[m_children[c]] = m_depth[node] + 1;
+        }
+    }
+    if (m_order.size() != n) {
+        setError(error, QStringLiteral("层次结构中存在环"));
+        m_parent.clear();
+        m_labels.clear();
+        m_order.clear();
+        m_depth.clear();
+        m_total.clear();
+        m_rects.clear();
+        m_laidOut = false;
+        buildChildren();
+        return false;
+    }
+
+    // 自底向上累加子树权重
+    m_total.resize(n);
+    for (int i = 0; i < n; ++i) {
+        const bool leaf = m_childStart[i] == m_childStart[i + 1];
+        m_total[i] = leaf ? qMax(hierarchy.weight[i], 0.0) : 0.0;
+    }
+    for (int i = n - 1; i > 0; --i) {
+        const int node = m_order[i];
+        if (m_parent[node] >= 0) m_total[m_parent[node]] += m_total[node];
+    }
+
+    m_rects.fill(QRectF(), n);
+    m_laidOut = false;
+    return true;
+}
+
+void TreemapLayout::setOptions(const Options& options)
+{
+    m_options = options;
+}
+
+void TreemapLayout::buildChildren()
+{
+    // 计数排序建立 CSR 子节点表，保持输入顺序
+    const int n = m_parent.size();
+    m_childStart.fill(0, n + 1);
+    m_roots.clear();
+    for (int i = 0; i < n; ++i) {
+        if (m_parent[i] >= 0) m_childStart[m_parent[i] + 1]++;
+        else m_roots.append(i);
+    }
+    for (int i = 0; i < n; ++i) {
+        m_childStart[i + 1] += m_childStart[i];
+    }
+
+    m_children.resize(m_childStart[n]);
+    QVector<int> fill(m_childStart.constBegin(), m_childStart.constEnd() - 1);
+    for (int i = 0; i < n; ++i) {
+        if (m_parent[i] >= 0) m_children[fill[m_parent[i]]++] = i;
+    }
+    m_sorted = false;
+}
+
+void TreemapLayout::sortChildren()
+{
+    // 权重降序，相同权重保持输入顺序（布局结果稳定）
+    const auto heavier = [this](int a, int b) { return m_total[a] > m_total[b]; };
+    std::stable_sort(m_roots.begin(), m_roots.end(), heavier);
+    for (int i = 0; i + 1 < m_childStart.size(); ++i) {
+        std::stable_sort(m_children.begin() + m_childStart[i],
+                         m_children.begin() + m_childStart[i + 1], heavier);
+    }
+    m_sorted = true;
+}
+
+void TreemapLayout::layout(const QRectF& bounds)
+{
+    // 只有 Squarified 需要按权重排序，其他算法保持输入顺序
+    if (m_options.algorithm == Squarified && !m_sorted) {
+        sortChildren();
+    } else if (m_options.algorithm != Squarified && m_sorted) {
+        buildChildren();
+    }
+
+    layoutChildren(m_roots.constData(), m_roots.size(), bounds, 0);
+
+    // 广度优先顺序保证处理子节点时父节点矩形已确定
+    for (int node : qAsConst(m_order)) {
+        const int begin = m_childStart[node];
+        const int end = m_childStart[node + 1];
+        if (begin == end) continue;
+        layoutChildren(m_children.constData() + begin, end - begin, contentRect(node),
+                       m_depth[node] + 1);
+    }
+    m_bounds = bounds;
+    m_laidOut = true;
+}
+
+QRectF TreemapLayout::contentRect(int node) const
+{
+    const QRectF& r = m_rects[node];
+    const qreal p = m_options.padding;
+
+    // 空间不足时依次放弃标题栏和内边距
+    QRectF content = r.adjusted(p, p + m_options.headerHeight, -p, -p);
+    if (content.width() <= 0 || content.height() <= 0) {
+        content = r.adjusted(p, p, -p, -p);
+    }
+    if (content.width() <= 0 || content.height() <= 0) {
+        content = r;
+    }
+    return content;
+}
+
+void TreemapLayout::layoutChildren(const int* ids, int count, const QRectF& rect, int depth)
+{
+    double total = 0;
+    for (int i = 0; i < count; ++i) {
+        total += m_total[ids[i]];
+    }
+
+    // 没有面积可分时所有子节点退化为父区域左上角的空矩形（总权重溢出为无穷大时同样处理）
+    if (total <= 0 || !qIsFinite(total) || rect.isEmpty()) {
+        for (int i = 0; i < count; ++i) {
+            m_rects[ids[i]] = QRectF(rect.topLeft(), QSizeF(0, 0));
+        }
+        return;
+    }
+
+    switch (m_options.algorithm) {
+    case Squarified:
+        layoutRows(ids, count, rect, total, false);
+        break;
+    case SliceAndDice:
+        layoutSlices(ids, count, rect, total, depth % 2 == 0);
+        break;
+    case Strip:
+        layoutRows(ids, count, rect, total, true);
+        break;
+    }
+}
+
+void TreemapLayout::layoutRows(const int* ids, int count, QRectF rect, double total,
+                               bool horizontalStrips)
+{
+    // 权重 -> 面积
+    const double scale = rect.width() * rect.height() / total;
+
+    int i = 0;
+    while (i < count) {
+        // 浮点误差可能使剩余条带在最后一行之前就没有面积，此时 sum / side 会除以 0，
+        // 剩余节点退化为空矩形
+        if (rect.width() <= 0 || rect.height() <= 0) {
+            for (; i < count; ++i) m_rects[ids[i]] = QRectF(rect.topLeft(), QSizeF(0, 0));
+            break;
+        }
+        if (m_total[ids[i]] <= 0) {
+            m_rects[ids[i]] = QRectF(rect.topLeft(), QSizeF(0, 0));
+            ++i;
+            continue;
+        }
+
+        // Squarified 沿较短边排一行；Strip 固定为横跨宽度的水平条带
+        const bool horizontal = horizontalStrips || rect.width() < rect.height();
+        const double side = horizontal ? rect.width() : rect.height();
+
+        // 贪心地向当前行追加节点，直到最差长宽比开始变差
+        // （Strip 同样使用最差长宽比，可以 O(1) 增量计算）
+        double sum = m_total[ids[i]] * scale;
+        double minArea = sum, maxArea = sum;
+        double worst = worstRatio(sum, minArea, maxArea, side);
+        int j = i + 1;
+        for (; j < count; ++j) {
+            const double area = m_total[ids[j]] * scale;
+            if (area <= 0) continue; // 空节点不影响当前行
+            const double newMin = qMin(minArea, area);
+            const double newMax = qMax(maxArea, area);
+            const double newWorst = worstRatio(sum + area, newMin, newMax, side);
+            if (newWorst > worst) break;
+            sum += area;
+            minArea = newMin;
+            maxArea = newMax;
+            worst = newWorst;
+        }
+
+        // 放置该行；最后一行和行末节点吸收累计误差，保证铺满
+        const bool lastRow = j == count;
+        if (horizontal) {
+            const double h = lastRow ? rect.height() : sum / side;
+            double x = rect.left();
+            for (int k = i; k < j; ++k) {
+                const double area = m_total[ids[k]] * scale;
+                const double w = k == j - 1 ? rect.right() - x : (area > 0 ? area / h : 0.0);
+                m_rects[ids[k]] = QRectF(x, rect.top(), w, area > 0 ? h : 0.0);
+                x += w;
+            }
+            rect.setTop(rect.top() + h);
+        } else {
+            const double w = lastRow ? rect.width() : sum / side;
+            double y = rect.top();
+            for (int k = i; k < j; ++k) {
+                const double area = m_total[ids[k]] * scale;
+                const double h = k == j - 1 ? rect.bottom() - y : (area > 0 ? area / w : 0.0);
+                m_rects[ids[k]] = QRectF(rect.left(), y, area > 0 ? w : 0.0, h);
+                y += h;
+            }
+            rect.setLeft(rect.left() + w);
+        }
+        i = j;
+    }
+}
+
+void TreemapLayout::layoutSlices(const int* ids, int count, const QRectF& rect, double total,
+                                 bool horizontal)
+{
+    // 按权重比例依次切分，最后一个节点占满剩余部分
+    const double extent = horizontal ? rect.width() : rect.height();
+    double pos = horizontal ? rect.left() : rect.top();
+    const double end = pos + extent;
+    for (int i = 0; i < count; ++i) {
+        const double size = i == count - 1 ? end - pos : extent * m_total[ids[i]] / total;
+        m_rects[ids[i]] = horizontal ? QRectF(pos, rect.top(), size, rect.height())
+                                     : QRectF(rect.left(), pos, rect.width(), size);
+        pos += size;
+    }
+}
+
+QRect TreemapLayout::snappedRect(int node) const
+{
+    return snapped(m_rects[node]);
+}
+
+void TreemapLayout::writeTo(SceneData* scene) const
+{
+    const int n = m_rects.size();
+    scene->reserve(scene->nodeCount() + n, scene->edgeCount());
+    for (int i = 0; i < n; ++i) {
+        scene->addNode(snapped(m_rects[i]), m_labels.value(i));
+    }
+}
+
+// === 增量更新 ===
+QVector<int> TreemapLayout::setWeight(int node, double weight)
+{
+    QVector<int> moved;
+    if (node < 0 || node >= m_parent.size() || !isLeaf(node) || !qIsFinite(weight)) return moved;
+
+    const double delta = qMax(weight, 0.0) - m_total[node];
+    if (delta == 0) return moved;
+
+    // 沿祖先路径更新子树权重（path 自叶节点向上）
+    QVector<int> path;
+    for (int n = node; n >= 0; n = m_parent[n]) {
+        m_total[n] += delta;
+        path.append(n);
+    }
+
+    // 保持 Squarified 的兄弟节点降序：路径上每个节点只需在兄弟表中移动到新位置
+    if (m_sorted && m_options.algorithm == Squarified) {
+        for (int n : qAsConst(path)) {
+            reorderSibling(n);
+        }
+    }
+    if (!m_laidOut) return moved;
+
+    // 自顶向下：路径上每一层重新分配兄弟节点，尺寸变化的兄弟子树留待之后重排
+    std::reverse(path.begin(), path.end());
+    QVector<int> pending;
+    relayoutGroup(m_roots.constData(), m_roots.size(), m_bounds, 0, path.first(), &moved, &pending);
+    for (int i = 0; i + 1 < path.size(); ++i) {
+        const int parent = path[i];
+        relayoutGroup(m_children.constData() + m_childStart[parent],
+                      m_childStart[parent + 1] - m_childStart[parent],
+                      contentRect(parent), m_depth[parent] + 1, path[i + 1], &moved, &pending);
+    }
+    while (!pending.isEmpty()) {
+        const int parent = pending.takeLast();
+        relayoutGroup(m_children.constData() + m_childStart[parent],
+                      m_childStart[parent + 1] - m_childStart[parent],
+                      contentRect(parent), m_depth[parent] + 1, -1, &moved, &pending);
+    }
+    return moved;
+}
+
+void TreemapLayout::reorderSibling(int node)
+{
+    const int parent = m_parent[node];
+    int* siblings = parent < 0 ? m_roots.data() : m_children.data() + m_childStart[parent];
+    const int count = parent < 0 ? m_roots.size() : m_childStart[parent + 1] - m_childStart[parent];
+
+    int pos = int(std::find(siblings, siblings + count, node) - siblings);
+    while (pos > 0 && m_total[siblings[pos - 1]] < m_total[node]) {
+        std::swap(siblings[pos - 1], siblings[pos]);
+        --pos;
+    }
+    while (pos + 1 < count && m_total[siblings[pos + 1]] > m_total[node]) {
+        std::swap(siblings[pos + 1], siblings[pos]);
+        ++pos;
+    }
+}
+
+void TreemapLayout::relayoutGroup(const int* ids, int count, const QRectF& rect, int depth,
+                                  int pathChild, QVector<int>* moved, QVector<int>* pending)
+{
+    QVarLengthArray<QRectF, 64> before(count);
+    for (int i = 0; i < count; ++i) {
+        before[i] = m_rects[ids[i]];
+    }
+
+    layoutChildren(ids, count, rect, depth);
+
+    for (int i = 0; i < count; ++i) {
+        const int id = ids[i];
+        const QRectF& after = m_rects[id];
+        if (id != pathChild && after == before[i]) continue; // 整棵子树原样复用
+
+        if (snapped(after) != snapped(before[i])) moved->append(id);
+
+        // 路径上的节点由调用者继续向下处理
+        if (id == pathChild || isLeaf(id)) continue;
+        if (after.size() == before[i].size()) {
+            translateSubtree(id, after.topLeft() - before[i].topLeft(), moved);
+        } else {
+            pending->append(id);
+        }
+    }
+}
+
+void TreemapLayout::translateSubtree(int node, const QPointF& offset, QVector<int>* moved)
+{
+    QVector<int> stack{node};
+    while (!stack.isEmpty()) {
+        const int parent = stack.takeLast();
+        for (int c = m_childStart[parent]; c < m_childStart[parent + 1]; ++c) {
+            const int child = m_children[c];
+            const QRectF before = m_rects[child];
+            m_rects[child].translate(offset);
+            if (snapped(m_rects[child]) != snapped(before)) moved->append(child);
+            stack.append(child);
+        }
+    }
+}
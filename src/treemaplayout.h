@@ -0,0 +1,137 @@
+#pragma once
+
+#include <QRect>
+#include <QRectF>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct SceneData; // 前向声明
+
+/**
+ * @brief 带权层次结构（扁平存储）
+ *
+ * 第 i 个节点的父节点为 parent[i]（-1 表示根，允许多个根）。
+ * 叶节点的面积与 weight[i] 成正比；内部节点的 weight 被忽略，
+ * 其面积为所有子节点之和。
+ */
+struct TreemapHierarchy
+{
+    QVector<int> parent;    ///< 父节点下标
+    QVector<double> weight; ///< 叶节点权重（负数按 0 处理，不能为 NaN 或无穷大）
+    QStringList labels;     ///< 节点文本
+
+    int count() const { return parent.size(); }
+
+    void reserve(int nodes);
+    int addNode(int parentIndex, double nodeWeight, const QString& label); ///< 返回新节点下标
+    void clear();
+
+    /**
+     * @brief 读取层次数据文件
+     *
+     * 每行一条记录：ID,父节点ID,权重,文本（父节点ID 为 -1 表示根节点，
+     * 文本可包含逗号）；以 # 开头的行为注释。父节点可以出现在子节点之后。
+     */
+    bool load(const QString& path, QString* error = nullptr);
+};
+
+/**
+ * @brief 矩形树图布局引擎
+ *
+ * 根据权重把层次结构的每个节点映射为矩形：子节点铺满父节点的内容区域
+ * （去掉内边距和标题栏），面积与权重成正比。支持三种算法：
+ * - Squarified：按权重降序分行，使每行最差长宽比最小（Bruls 等）
+ * - SliceAndDice：按深度交替横向/纵向切分，保持输入顺序
+ * - Strip：保持输入顺序的水平条带，条带在长宽比变差前换行
+ *
+ * 子节点表以 CSR 形式存放，每个父节点只在 Squarified 时排序一次，
+ * 整体复杂度 O(n log n)。结果可以通过 writeTo 直接写入 SceneData 的
+ * 几何列，再由 CanvasWidget::setScene 一次性构建画布。
+ *
+ * 单个叶节点权重变化时 setWeight 只沿祖先路径重新分配各层兄弟节点，
+ * 矩形未变的兄弟子树直接复用，只平移的子树整体平移，
+ * 只有尺寸改变的子树才重新布局。
+ */
+class TreemapLayout
+{
+public:
+    enum Algorithm {
+        Squarified,   ///< 正方化（默认）
+        SliceAndDice, ///< 切片
+        Strip         ///< 条带
+    };
+
+    struct Options {
+        Algorithm algorithm = Squarified;
+        qreal padding = 4;       ///< 内部节点四周的内边距
+        qreal headerHeight = 0;  ///< 内部节点顶部留给文本的高度
+    };
+
+    TreemapLayout() = default;
+
+    /**
+     * @brief 设置层次结构（建立子节点表并累加权重）
+     * @return 层次结构无效（父节点越界、存在环或权重不是有限值）时返回 false
+     */
+    bool setHierarchy(const TreemapHierarchy& hierarchy, QString* error = nullptr);
+
+    void setOptions(const Options& options); ///< 修改后需重新调用 layout()
+    const Options& options() const { return m_options; }
+
+    /**
+     * @brief 在指定区域内计算所有节点的矩形
+     * @param bounds 根节点铺满的区域
+     */
+    void layout(const QRectF& bounds);
+
+    int count() const { return m_rects.size(); }
+    const QVector<QRectF>& rects() const { return m_rects; } ///< 节点矩形（与层次结构下标一致）
+    double totalWeight(int node) const { return m_total[node]; }
+    bool isLeaf(int node) const { return m_childStart[node] == m_childStart[node + 1]; }
+    QRect snappedRect(int node) const; ///< 按边取整后的矩形（与 writeTo 写入的一致）
+
+    /**
+     * @brief 修改叶节点权重并增量更新布局
+     * @param node 叶节点下标（内部节点的权重由子节点决定，调用被忽略）
+     * @param weight 新权重（NaN 或无穷大时调用被忽略）
+     * @return 取整后几何发生变化的节点下标（尚未调用 layout 时为空）
+     */
+    QVector<int> setWeight(int node, double weight);
+
+    /**
+     * @brief 把布局结果整体写入场景数据（按下标顺序追加节点）
+     *
+     * 坐标按边取整，相邻矩形之间不会出现缝隙或重叠。
+     * 层次结构中父节点在前时，子节点绘制在父节点之上。
+     */
+    void writeTo(SceneData* scene) const;
+
+private:
+    void buildChildren();
+    void sortChildren();
+    void layoutChildren(const int* ids, int count, const QRectF& rect, int depth);
+    void layoutRows(const int* ids, int count, QRectF rect, double total, bool horizontalStrips);
+    void layoutSlices(const int* ids, int count, const QRectF& rect, double total, bool horizontal);
+    QRectF contentRect(int node) const;
+
+    // 增量更新辅助
+    void reorderSibling(int node);
+    void relayoutGroup(const int* ids, int count, const QRectF& rect, int depth, int pathChild,
+                       QVector<int>* moved, QVector<int>* pending);
+    void translateSubtree(int node, const QPointF& offset, QVector<int>* moved);
+
+    Options m_options;
+    QStringList m_labels;
+    QVector<int> m_parent;
+    QVector<double> m_total;     ///< 子树总权重
+    QVector<int> m_childStart;   ///< CSR：节点 i 的子节点为 m_children[m_childStart[i] .. m_childStart[i+1])
+    QVector<int> m_children;
+    QVector<int> m_roots;        ///< 根节点（视为一个虚拟父节点的子节点）
+    QVector<int> m_order;        ///< 广度优先顺序（父节点在子节点之前）
+    QVector<int> m_depth;
+    QVector<QRectF> m_rects;
+    bool m_sorted = false;       ///< 子节点表是否已按权重降序排列
+    QRectF m_bounds;             ///< 最近一次 layout 的区域
+    bool m_laidOut = false;      ///< 是否已有可供增量更新的布局
+};
@@ -0,0 +1,88 @@
+// 矩形树图布局基准测试（CMake 选项 TREEMAP_BUILD_BENCHMARKS 开启时构建）
+//
+// 用法：treemaplayout_bench [叶节点数...]
+// 默认测试 10^5、3*10^5 和 10^6 个叶节点，每个内部节点有 2-32 个子节点，
+// 叶节点权重服从长尾分布。分别统计三种算法的布局时间和写入 SceneData 的时间。
+
+#include "treemaplayout.h"
+#include "scenefile.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTextStream>
+#include <QtMath>
+
+namespace {
+
+// 自顶向下随机生成层次结构，直到叶节点数达到 leafCount
+TreemapHierarchy makeHierarchy(int leafCount, quint32 seed)
+{
+    QRandomGenerator random(seed);
+    TreemapHierarchy hierarchy;
+    hierarchy.reserve(leafCount + leafCount / 2);
+
+    QVector<int> leaves{hierarchy.addNode(-1, 0, QStringLiteral("root"))};
+    int head = 0;
+    while (leaves.size() - head < leafCount) {
+        const int parent = leaves[head++];
+        const int children = qMin(2 + int(random.bounded(31)), leafCount - (leaves.size() - head));
+        for (int c = 0; c < qMax(children, 1); ++c) {
+            const double weight = 1.0 / qPow(1.0 - random.generateDouble() * 0.999, 1.5);
+            leaves.append(hierarchy.addNode(parent, weight, QString::number(hierarchy.count())));
+        }
+    }
+    return hierarchy;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QVector<int> sizes;
+    for (const QString &arg : app.arguments().mid(1)) {
+        const int n = arg.toInt();
+        if (n > 0) sizes.append(n);
+    }
+    if (sizes.isEmpty()) sizes = {100000, 300000, 1000000};
+
+    const QRectF bounds(0, 0, 3840, 2160);
+    const struct { TreemapLayout::Algorithm algorithm; const char *name; } algorithms[] = {
+        {TreemapLayout::Squarified, "squarified"},
+        {TreemapLayout::SliceAndDice, "slice-and-dice"},
+        {TreemapLayout::Strip, "strip"},
+    };
+
+    for (int leafCount : qAsConst(sizes)) {
+        const TreemapHierarchy hierarchy = makeHierarchy(leafCount, 42);
+        out << "leaves=" << leafCount << " nodes=" << hierarchy.count() << Qt::endl;
+
+        for (const auto &entry : algorithms) {
+            QElapsedTimer timer;
+            timer.start();
+            TreemapLayout layout;
+            TreemapLayout::Options options;
+            options.algorithm = entry.algorithm;
+            layout.setOptions(options);
+            layout.setHierarchy(hierarchy);
+            const qint64 setupNs = timer.nsecsElapsed();
+
+            timer.restart();
+            layout.layout(bounds);
+            const qint64 layoutNs = timer.nsecsElapsed();
+
+            timer.restart();
+            SceneData scene;
+            layout.writeTo(&scene);
+            const qint64 writeNs = timer.nsecsElapsed();
+
+            out << "  " << qSetFieldWidth(15) << Qt::left << entry.name << qSetFieldWidth(0)
+                << " setup " << setupNs / 1000000.0 << " ms"
+                << ", layout " << layoutNs / 1000000.0 << " ms"
+                << ", write " << writeNs / 1000000.0 << " ms" << Qt::endl;
+        }
+    }
+    return 0;
+}
@@ -1,67 +1,131 @@
 #include "treenode.h"
-#include "canvaswidget.h"
+#include "tracing.h"
 #include <QPainter>
 #include <QFontMetrics>
+#include <QHash>
 
 // 样式常量初始化
 const QColor TreeNode::FILL_COLOR = QColor(245, 245, 245);    // 浅灰色填充
+const QColor TreeNode::AGGREGATE_COLOR = QColor(222, 228, 238); // 浅蓝灰色填充
 const QColor TreeNode::BORDER_COLOR = Qt::darkGray;           // 深灰边框
 const QColor TreeNode::TEXT_COLOR = Qt::black;                 // 黑色文本
 
-TreeNode::TreeNode(CanvasWidget* canvas, const QRect& rect, const QString& text)
-    : m_canvas(canvas), m_rect(rect), m_text(text)
+TreeNode::DetailLevel TreeNode::detailFor(const QRect& sceneRect, qreal scale)
 {
+    // 按节点在屏幕上的像素尺寸选择细节层次
+    const qreal w = sceneRect.width() * scale;
+    const qreal h = sceneRect.height() * scale;
+    if (qMax(w, h) < LOD_FILLED_RECT_PIXELS) return FilledRect;
+    if (qMin(w, h) < LOD_DETAIL_PIXELS) return ShapeOnly;
+    return FullDetail;
 }
 
-QPoint TreeNode::center() const
+QRect TreeNode::textEditArea(const QRect& rect)
 {
-    return m_rect.center();
+    int delta1 = rect.height()/4;
+    int delta2 = rect.width()/4;
+    return rect.adjusted(delta2,delta1,-delta2,-delta1);
 }
 
-bool TreeNode::containsPoint(const QPoint& point) const
+QFont TreeNode::fontForSize(const QFont& baseFont, int pointSize)
 {
-    return m_rect.contains(point);
+    // 相同字号的节点共用同一个 QFont，从而共享字体引擎和字形缓存
+    // （按线程缓存，离屏导出线程之间互不干扰）
+    thread_local QHash<QString, QFont> cache;
+    const QString key = baseFont.key() + QLatin1Char('@') + QString::number(pointSize);
+    auto it = cache.constFind(key);
+    if (it != cache.constEnd()) {
+        return *it;
+    }
+    QFont font = baseFont;
+    font.setPointSize(pointSize);
+    cache.insert(key, font);
+    return font;
 }
 
-void TreeNode::draw(QPainter* painter, int controlSize, int plusSize) const
+QFont TreeNode::fittedFont(const QFont& baseFont, const QRect& textRect)
 {
+    // 自动调整字体大小以适应矩形
+    QFont font = baseFont;
+    int fontSize = 12;
+    QFontMetrics metrics(font);
+    while (fontSize > 8 && metrics.height() > textRect.height()/2) {
+        fontSize--;
+        font = fontForSize(baseFont, fontSize);
+        metrics = QFontMetrics(font);
+    }
+    return font;
+}
+
+void TreeNode::updateTextLayout(TextLayout* layout, QStringView text, const QFont& baseFont,
+                                const QRect& textRect)
+{
+    const QFont font = fittedFont(baseFont, textRect);
+    const QFontMetrics metrics(font);
+
+    // 省略号截断并预先塑形（宽度内自动换行、水平居中）
+    const int width = qMax(0, textRect.width());
+    QStaticText staticText(metrics.elidedText(text.toString(), Qt::ElideRight, width));
+    staticText.setTextFormat(Qt::PlainText);
+    staticText.setTextWidth(width);
+    QTextOption option(Qt::AlignHCenter);
+    option.setWrapMode(QTextOption::WordWrap);
+    staticText.setTextOption(option);
+    staticText.prepare(QTransform(), font);
+
+    layout->baseFont = baseFont;
+    layout->font = font;
+    layout->staticText = staticText;
+    layout->valid = true;
+}
+
+void TreeNode::draw(QPainter* painter, const QRect& rect, QStringView text, bool hovered,
+                    TextLayout* layout, int controlSize, int plusSize, DetailLevel detail)
+{
+    TRACE_SCOPE("TreeNode::draw");
+    // 几个像素宽的节点以边框为主，直接填充边框色，无需保存画笔状态
+    if (detail == FilledRect) {
+        painter->fillRect(rect, BORDER_COLOR);
+        return;
+    }
+
     // === 绘制主体矩形 ===
     painter->save();
 
     // 设置填充和边框
     painter->setBrush(FILL_COLOR);
     painter->setPen(QPen(BORDER_COLOR, 1));
-    painter->drawRect(m_rect);
+    painter->drawRect(rect);
+
+    if (detail == ShapeOnly) {
+        painter->restore();
+        return;
+    }
 
     // === 绘制文本 ===
     painter->setPen(TEXT_COLOR);
-    QFont font = painter->font();
 
     // 计算可用的文本区域（考虑边距）
-    QRect textRect = m_rect.adjusted(TEXT_MARGIN, TEXT_MARGIN, -TEXT_MARGIN, -TEXT_MARGIN);
+    QRect textRect = rect.adjusted(TEXT_MARGIN, TEXT_MARGIN, -TEXT_MARGIN, -TEXT_MARGIN);
 
-    // 自动调整字体大小以适应矩形
-    int fontSize = 12;
-    QFontMetrics metrics(font);
-    while (fontSize > 8 && metrics.height() > textRect.height()/2) {
-        fontSize--;
-        font.setPointSize(fontSize);
-        metrics = QFontMetrics(font);
+    // 文本或尺寸未变化时直接复用缓存的排版结果
+    if (!layout->valid || layout->baseFont != painter->font()) {
+        updateTextLayout(layout, text, painter->font(), textRect);
     }
-    painter->setFont(font);
+    painter->setFont(layout->font);
 
     // === 绘制交互元素 ===
-    if (m_hovered) {
+    if (hovered) {
         // 绘制右下角调整控制点
-        QRect resizeHandle(m_rect.right() - controlSize,
-                           m_rect.bottom() - controlSize,
+        QRect resizeHandle(rect.right() - controlSize,
+                           rect.bottom() - controlSize,
                            controlSize * 2, controlSize * 2);
         painter->setBrush(Qt::white);
         painter->drawRect(resizeHandle);
 
         // 绘制右侧加号图标
-        QRect plusIcon(m_rect.right() - plusSize,
-                       m_rect.center().y() - plusSize/2,
+        QRect plusIcon(rect.right() - plusSize,
+                       rect.center().y() - plusSize/2,
                        plusSize, plusSize);
         painter->setPen(QPen(Qt::darkGray, 1.5));
         painter->drawLine(plusIcon.left() + 2, plusIcon.center().y(),
@@ -70,21 +134,53 @@ void TreeNode::draw(QPainter* painter, int controlSize, int plusSize) const
                           plusIcon.center().x(), plusIcon.bottom() - 2);
 
         // 绘制中心文本编辑框
-        int delta1 = m_rect.height()/4;
-        int delta2 = m_rect.width()/4;
-        QRect textIcon = m_rect.adjusted(delta2,delta1,-delta2,-delta1);
+        QRect textIcon = textEditArea(rect);
         painter->setBrush(Qt::white);
         painter->drawRect(textIcon);
     }
 
-    // 绘制居中文本（自动换行+省略号）
-    painter->drawText(textRect, Qt::AlignCenter | Qt::TextWordWrap,
-                      metrics.elidedText(m_text, Qt::ElideRight, textRect.width()));
+    // 绘制居中文本（自动换行+省略号），垂直方向按塑形后的高度居中
+    // 最小字号仍放不下（或单词宽于文本区域）时裁剪到文本区域，不画到边框和相邻节点上
+    const QSizeF textSize = layout->staticText.size();
+    const QPointF textPos(textRect.left(),
+                          textRect.top() + (textRect.height() - textSize.height()) / 2);
+    if (textSize.width() > textRect.width() || textSize.height() > textRect.height()) {
+        painter->setClipRect(textRect, Qt::IntersectClip);
+    }
+    painter->drawStaticText(textPos, layout->staticText);
 
     painter->restore();
 }
 
-void TreeNode::moveTo(const QPoint& topLeft)
+void TreeNode::drawAggregate(QPainter* painter, const QRect& rect, QStringView summary,
+                             TextLayout* layout, DetailLevel detail)
 {
-    m_rect.moveTo(topLeft);
+    TRACE_SCOPE("TreeNode::drawAggregate");
+    if (detail == FilledRect) {
+        painter->fillRect(rect, BORDER_COLOR);
+        return;
+    }
+
+    // 与普通节点相同的边框，填充色不同以示区别；聚合矩形没有交互元素
+    painter->save();
+    painter->setBrush(AGGREGATE_COLOR);
+    painter->setPen(QPen(BORDER_COLOR, 1));
+    painter->drawRect(rect);
+
+    if (detail == FullDetail) {
+        const QRect textRect = rect.adjusted(TEXT_MARGIN, TEXT_MARGIN, -TEXT_MARGIN, -TEXT_MARGIN);
+        if (!layout->valid || layout->baseFont != painter->font()) {
+            updateTextLayout(layout, summary, painter->font(), textRect);
+        }
+        painter->setPen(TEXT_COLOR);
+        painter->setFont(layout->font);
+        const QSizeF textSize = layout->staticText.size();
+        const QPointF textPos(textRect.left(),
+                              textRect.top() + (textRect.height() - textSize.height()) / 2);
+        if (textSize.width() > textRect.width() || textSize.height() > textRect.height()) {
+            painter->setClipRect(textRect, Qt::IntersectClip); // 同 draw
+        }
+        painter->drawStaticText(textPos, layout->staticText);
+    }
+    painter->restore();
 }
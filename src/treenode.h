@@ -2,75 +2,94 @@
 
 #include <QRect>
 #include <QString>
+#include <QStringView>
 #include <QPoint>
 #include <QPainter>
 #include <QColor>
+#include <QFont>
+#include <QStaticText>
 
 static const int TEXT_MARGIN = 8;
 
 /**
- * @brief 表示单个矩形树图节点
+ * @brief 矩形树图节点的绘制逻辑
  *
- * 封装节点的几何属性、文本内容和绘制逻辑
- * 提供对节点状态（悬停/调整大小）的检测支持
+ * 节点数据（几何、文本、状态）按列存放在 SceneStore 中，
+ * 本类只提供无状态的绘制函数和文本排版缓存的结构
  */
-class CanvasWidget;
-
 class TreeNode
 {
 public:
-    /**
-     * @brief 构造函数
-     * @param rect 初始几何位置和尺寸
-     * @param text 显示文本内容
-     */
-    // 修改构造函数以接收 CanvasWidget 指针
-    explicit TreeNode(CanvasWidget* canvas, const QRect& rect, const QString& text = "");
-
-    // 添加 canvas() 访问器
-    CanvasWidget* canvas() const { return m_canvas; }
-
-    // 基础属性访问器
-    QRect geometry() const    { return m_rect; }      ///< 获取节点几何属性
-    QString text() const      { return m_text; }      ///< 获取显示文本
-    QPoint center() const;                            ///< 计算矩形中心点
-
-    // 状态设置
-    void setGeometry(const QRect& rect) { m_rect = rect; } ///< 设置节点位置和尺寸
-    void setText(const QString& text)   { m_text = text; } ///< 设置显示文本
-    void setHovered(bool hovered)       { m_hovered = hovered; } ///< 设置悬停状态
+    /// 细节层次（由画布根据节点在屏幕上的尺寸选择）
+    enum DetailLevel {
+        FullDetail, ///< 完整绘制：文本和交互元素
+        ShapeOnly,  ///< 只绘制填充和边框，省略文本与控制点
+        FilledRect  ///< 节点只有几个像素宽，绘制为实心矩形
+    };
 
     /**
-     * @brief 检测点是否在节点区域内
-     * @param point 检测坐标点
-     * @return 是否包含该点
+     * @brief 文本排版缓存
+     *
+     * 字号适配、省略号截断和文本塑形只在文本或尺寸变化后重新计算，
+     * 平时绘制直接复用缓存的 QStaticText。
      */
-    bool containsPoint(const QPoint& point) const;
+    struct TextLayout {
+        bool valid = false;      ///< 缓存是否有效
+        QFont baseFont;          ///< 生成缓存时画笔的基础字体
+        QFont font;              ///< 适配后的字体
+        QStaticText staticText;  ///< 已塑形的省略文本
+    };
 
     /**
      * @brief 执行节点绘制
      * @param painter 绘图设备
+     * @param rect 节点几何
+     * @param text 显示文本
+     * @param hovered 是否处于悬停状态（绘制控制点、加号和编辑框）
+     * @param layout 文本排版缓存（FullDetail 时不可为 nullptr，失效时重新生成）
      * @param controlSize 调整控制点尺寸（像素）
      * @param plusSize 加号图标尺寸（像素）
+     * @param detail 细节层次
      */
-    void draw(QPainter* painter, int controlSize, int plusSize) const;
+    static void draw(QPainter* painter, const QRect& rect, QStringView text, bool hovered,
+                     TextLayout* layout, int controlSize, int plusSize,
+                     DetailLevel detail = FullDetail);
 
     /**
-     * @brief 移动节点到指定位置（保持尺寸不变）
-     * @param topLeft 新的左上角坐标
+     * @brief 绘制代表整棵子树的聚合矩形（层次细节）
+     * @param summary 汇总文本（排版缓存有效时可为空）
+     * @param layout 汇总文本的排版缓存（FullDetail 时不可为 nullptr）
      */
-    void moveTo(const QPoint& topLeft);
+    static void drawAggregate(QPainter* painter, const QRect& rect, QStringView summary,
+                              TextLayout* layout, DetailLevel detail);
 
-private:
-    CanvasWidget* m_canvas;
-    QRect m_rect;        ///< 节点几何属性（位置+尺寸）
-    QString m_text;      ///< 显示文本内容
-    bool m_hovered = false; ///< 是否处于悬停状态
+    // 交互元素尺寸（画布与导出绘制节点时使用）
+    static const int CONTROL_POINT_SIZE = 8; ///< 调整大小控制点边长
+    static const int PLUS_ICON_SIZE = 12;    ///< 加号图标边长
 
-    // 样式常量（可在实现中修改）
+    // 细节层次阈值（节点在屏幕上的像素尺寸）
+    static const int LOD_DETAIL_PIXELS = 24;     ///< 小于此尺寸不绘制文本和控制点
+    static const int LOD_FILLED_RECT_PIXELS = 4; ///< 小于此尺寸只绘制实心矩形
+
+    /// 按节点在屏幕上的尺寸选择细节层次（画布绘制和导出位图时使用）
+    static DetailLevel detailFor(const QRect& sceneRect, qreal scale);
+
+    /// 节点中央的文本编辑框区域
+    static QRect textEditArea(const QRect& rect);
+
+    /// 文本区域使用的字体：行高超过区域高度一半时逐级缩小（最小 8 pt），SVG 导出同样使用
+    static QFont fittedFont(const QFont& baseFont, const QRect& textRect);
+
+    // 样式常量（可在实现中修改；SVG 导出按同样的样式生成）
     static const QColor FILL_COLOR;      ///< 默认填充色
+    static const QColor AGGREGATE_COLOR; ///< 聚合矩形的填充色
     static const QColor BORDER_COLOR;    ///< 边框颜色
     static const QColor TEXT_COLOR;      ///< 文本颜色
 
-    friend class CanvasWidget;
+private:
+    TreeNode() = delete;
+
+    static void updateTextLayout(TextLayout* layout, QStringView text, const QFont& baseFont,
+                                 const QRect& textRect);
+    static QFont fontForSize(const QFont& baseFont, int pointSize);
 };
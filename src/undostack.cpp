@@ -0,0 +1,165 @@
+#include "undostack.h"
+
+// 组合命令：按加入顺序重做，按相反顺序撤销
+class UndoStack::GroupCommand : public UndoCommand
+{
+public:
+    ~GroupCommand() override { qDeleteAll(m_children); }
+
+    void undo() override
+    {
+        for (int i = m_children.size() - 1; i >= 0; --i) m_children[i]->undo();
+    }
+    void redo() override
+    {
+        for (UndoCommand* child : qAsConst(m_children)) child->redo();
+    }
+    qsizetype memoryCost() const override
+    {
+        qsizetype cost = sizeof(*this) + m_children.capacity() * sizeof(UndoCommand*);
+        for (const UndoCommand* child : m_children) cost += child->memoryCost();
+        return cost;
+    }
+
+    QVector<UndoCommand*> m_children;
+};
+
+UndoStack::UndoStack(QObject* parent)
+    : QObject(parent)
+{
+}
+
+UndoStack::~UndoStack()
+{
+    qDeleteAll(m_commands);
+    delete m_group;
+}
+
+void UndoStack::push(UndoCommand* command)
+{
+    if (m_group) {
+        m_group->m_children.append(command);
+        return;
+    }
+    append(command);
+}
+
+void UndoStack::beginGroup()
+{
+    if (m_groupDepth++ == 0) {
+        m_group = new GroupCommand;
+    }
+}
+
+void UndoStack::endGroup()
+{
+    Q_ASSERT(m_groupDepth > 0);
+    if (--m_groupDepth > 0) return;
+
+    GroupCommand* group = m_group;
+    m_group = nullptr;
+    if (group->m_children.isEmpty()) {
+        delete group;
+    } else if (group->m_children.size() == 1) {
+        // 只有一条命令时不必包装
+        append(group->m_children.takeFirst());
+        delete group;
+    } else {
+        append(group);
+    }
+}
+
+void UndoStack::append(UndoCommand* command)
+{
+    // 新命令使所有可重做的命令失效
+    while (m_commands.size() > m_index) {
+        UndoCommand* dropped = m_commands.takeLast();
+        m_memoryUsage -= dropped->memoryCost();
+        delete dropped;
+    }
+
+    // 与栈顶同类型的命令尝试合并
+    UndoCommand* top = m_index > 0 ? m_commands[m_index - 1] : nullptr;
+    if (top && command->id() != -1 && top->id() == command->id()) {
+        const qsizetype before = top->memoryCost();
+        if (top->mergeWith(command)) {
+            m_memoryUsage += top->memoryCost() - before;
+            delete command;
+            emit changed();
+            return;
+        }
+    }
+
+    m_commands.append(command);
+    m_index = m_commands.size();
+    m_memoryUsage += command->memoryCost();
+    trim();
+    emit changed();
+}
+
+void UndoStack::trim()
+{
+    // 先从最早的可撤销命令开始丢弃。最近执行的命令即使单独超过上限也保留，
+    // 否则清空大场景后立即无法撤销
+    int dropCount = 0;
+    while (dropCount < m_index - 1 && m_memoryUsage > m_memoryLimit) {
+        m_memoryUsage -= m_commands[dropCount]->memoryCost();
+        delete m_commands[dropCount];
+        ++dropCount;
+    }
+    if (dropCount > 0) {
+        m_commands.remove(0, dropCount);
+        m_index -= dropCount;
+    }
+
+    // 仍然超过时从最后的可重做命令开始丢弃，保证剩余的命令仍然连续
+    while (m_commands.size() > m_index && m_memoryUsage > m_memoryLimit) {
+        UndoCommand* dropped = m_commands.takeLast();
+        m_memoryUsage -= dropped->memoryCost();
+        delete dropped;
+    }
+}
+
+void UndoStack::undo()
+{
+    if (!canUndo()) return;
+
+    // 命令的内存占用可能随撤销变化（如清空操作交还场景数据）
+    UndoCommand* command = m_commands[--m_index];
+    const qsizetype before = command->memoryCost();
+    command->undo();
+    m_memoryUsage += command->memoryCost() - before;
+    emit changed();
+}
+
+void UndoStack::redo()
+{
+    if (!canRedo()) return;
+
+    UndoCommand* command = m_commands[m_index++];
+    const qsizetype before = command->memoryCost();
+    command->redo();
+    m_memoryUsage += command->memoryCost() - before;
+    trim();
+    emit changed();
+}
+
+void UndoStack::clear()
+{
+    qDeleteAll(m_commands);
+    m_commands.clear();
+    m_index = 0;
+    m_memoryUsage = 0;
+    if (m_group) {
+        qDeleteAll(m_group->m_children);
+        m_group->m_children.clear();
+    }
+    emit changed();
+}
+
+void UndoStack::setMemoryLimit(qsizetype bytes)
+{
+    m_memoryLimit = bytes;
+    trim();
+    emit changed();
+}
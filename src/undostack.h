@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+
+/**
+ * @brief 可撤销的编辑命令
+ *
+ * 命令只保存修改前后的增量（如节点几何、文本），不保存整个场景。
+ * 命令在加入 UndoStack 之前已经执行过一次，之后由栈调用 undo/redo。
+ */
+class UndoCommand
+{
+public:
+    virtual ~UndoCommand() = default;
+
+    virtual void undo() = 0;
+    virtual void redo() = 0;
+
+    /**
+     * @brief 命令类型（-1 表示不参与合并）
+     *
+     * 只有类型相同的相邻命令才会调用 mergeWith。
+     */
+    virtual int id() const { return -1; }
+
+    /**
+     * @brief 尝试把紧随其后的命令合并到本命令中
+     * @return 合并成功时返回 true，next 随后被丢弃
+     */
+    virtual bool mergeWith(const UndoCommand* next) { Q_UNUSED(next) return false; }
+
+    /// 命令占用的内存（字节，估算值，用于限制历史记录总大小）
+    virtual qsizetype memoryCost() const = 0;
+};
+
+/**
+ * @brief 撤销/重做栈
+ *
+ * - push 接管已执行命令的所有权，并丢弃所有可重做的命令
+ * - 同类型的相邻命令可以合并（如一次拖拽中的多次移动）
+ * - beginGroup/endGroup 之间加入的命令组成一步撤销，可以嵌套
+ * - 所有命令占用的内存超过上限时从最早的命令开始丢弃，
+ *   历史记录的内存只与编辑量相关，与场景大小无关；
+ *   最近执行的一条命令总是保留（可能单独超过上限，如清空大场景）
+ */
+class UndoStack : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const qsizetype DEFAULT_MEMORY_LIMIT = qsizetype(64) << 20; ///< 默认上限 64MB
+
+    explicit UndoStack(QObject* parent = nullptr);
+    ~UndoStack() override;
+
+    void push(UndoCommand* command); ///< 加入已执行的命令（接管所有权）
+    void beginGroup();               ///< 开始组合命令
+    void endGroup();                 ///< 结束组合命令（最外层结束时作为一步加入）
+
+    void undo();
+    void redo();
+    void clear(); ///< 丢弃全部历史记录（包括正在组合的命令）
+
+    bool canUndo() const { return m_index > 0; }
+    bool canRedo() const { return m_index < m_commands.size(); }
+    int count() const { return m_commands.size(); }
+
+    void setMemoryLimit(qsizetype bytes); ///< 修改上限（立即按新上限裁剪）
+    qsizetype memoryLimit() const { return m_memoryLimit; }
+    qsizetype memoryUsage() const { return m_memoryUsage; }
+
+signals:
+    void changed(); ///< 可撤销/可重做状态可能发生变化
+
+private:
+    class GroupCommand;
+
+    void append(UndoCommand* command); ///< 加入栈顶并裁剪
+    void trim();                       ///< 超过内存上限时丢弃最早的命令（保留最近执行的一条）
+
+    QVector<UndoCommand*> m_commands; ///< [0, m_index) 可撤销，[m_index, count) 可重做
+    int m_index = 0;
+    qsizetype m_memoryUsage = 0;
+    qsizetype m_memoryLimit = DEFAULT_MEMORY_LIMIT;
+
+    int m_groupDepth = 0;
+    GroupCommand* m_group = nullptr; ///< 正在组合的命令
+};